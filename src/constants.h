@@ -29,19 +29,44 @@
 // DEBUG
 #define PRINT_MEMORY_SIZES
 // #define PRINT_FRAME_TIMES
+// #define PRINT_WORK_QUEUE_STATS
+// #define PRINT_AUDIO_LATENCY_STATS
 // #define INPUT_TEST_MOUSE
 // #define INPUT_TEST_AXES
 // #define INPUT_TEST_PRESSES
 #define INPUT_TEST_DOWNS
 #define MULTI_THREADING_TEST
+// #define WORK_QUEUE_LATENCY_TEST
+// #define THREAD_POOL_RESTART_TEST
+// #define PIXEL_KERNEL_BENCHMARK
+// #define SAMPLE_KERNEL_BENCHMARK
+
+// MEMORY
+#define PERMANENT_MEMORY_SIZE Megabytes(48)
+#define TRANSIENT_MEMORY_SIZE Gigabytes(2) // only reserved, pages get committed when touched
+#define FRAME_ARENA_SIZE Megabytes(64) // part of transient memory
+#define SCRATCH_ARENA_SIZE Megabytes(8) // per thread, part of transient memory
+// per present buffer, part of transient memory, only the part used by the window is committed
+#define GAMEBUFFER_ARENA_SIZE (  (uint64_t)GAMEBUFFER_PITCH_ALIGNMENT + WINDOW_MAX_HEIGHT \
+                               * ((uint64_t)GAMEBUFFER_BYTES_PER_PIXEL*WINDOW_MAX_WIDTH   \
+                                  + GAMEBUFFER_PITCH_ALIGNMENT)                          )
+#define MEMORY_DEFAULT_ALIGNMENT 16
 
 // WINDOW & GAMEBUFFER
 #define WINDOW_TITLE "xbEngine_Window_Title"
 #define WINDOW_INIT_WIDTH 1920
 #define WINDOW_INIT_HEIGHT 1080
-#define WINDOW_MAX_WIDTH 3840
-#define WINDOW_MAX_HEIGHT 2160
+#define WINDOW_MAX_WIDTH 7680 // larger windows get the GameBuffer stretched to fit
+#define WINDOW_MAX_HEIGHT 4320
 #define GAMEBUFFER_BYTES_PER_PIXEL 4
+#define GAMEBUFFER_PITCH_ALIGNMENT 64 // cache line and widest SIMD register
+// backbuffers in the present ring, each has a texture of its own, so with locked textures the
+// game never renders into the texture that is on screen
+#define PRESENT_BUFFERS_DEFAULT 2
+#define PRESENT_BUFFERS_MAX 3
+// headless runs have no window and render as fast as possible
+#define HEADLESS_FRAMES_DEFAULT 600
+#define HEADLESS_REFRESH_RATE 60 // only sets the target frame time, frames are not waited for
 
 // CONTROLLERS
 #define MAX_CONTROLLERS 4
@@ -60,11 +85,66 @@
 #define AUDIO_MAX_LATENCY_SECONDS 2
 // game targets at least 30fps, so audio should target the minimum to avoid missing target
 #define AUDIO_REFRESH_RATE 30
+#define AUDIO_VOICES_MAX 64 // playing at the same time, further sounds are dropped
+#define AUDIO_COMMANDS_MAX 256 // between two mixes, has to be a power of 2
+#define AUDIO_MIX_FRAMES 256 // mixed at once, voice gains ramp over this many frames
+#define AUDIO_RATE_MAX 8.0f // fastest playback rate of a voice
+#define AUDIO_THREAD_WAIT_MS 2 // the audio thread tops up the queue this often
+#define AUDIO_VOICE_BUFFERS_MAX 4 // queued behind the buffer a streaming voice plays
+#define AUDIO_EVENTS_MAX 256 // between two reads by the game, has to be a power of 2
+#define AUDIO_STREAM_CHUNKS 4 // decoded ahead per stream, at most AUDIO_VOICE_BUFFERS_MAX + 1
+#define AUDIO_STREAM_CHUNK_FRAMES 8192 // ~170ms at 48kHz, 4 chunks are ~680ms of music ahead
+// the latency controller of the audio thread moves the queued audio target between a floor
+// (device buffer plus top up interval and its jitter) and AUDIO_MAX_LATENCY_SECONDS
+#define AUDIO_LATENCY_WINDOW_MS 1000 // the target only shrinks after a window without underruns
+#define AUDIO_LATENCY_HOLD_MS 10000 // and not for this long after an underrun
+#define AUDIO_LATENCY_GROWTH 1.5f // the target grows by this factor on every underrun
+#define AUDIO_LATENCY_SHRINK_MS 2.0f // per window at most
+#define AUDIO_LATENCY_JITTER_SIGMAS 4.0f // standard deviations of the interval kept as margin
+#define AUDIO_LATENCY_SMOOTHING 0.01f // of the moving average and variance of the interval
+#define AUDIO_LATENCY_BUCKET_MS 2 // histogram resolution
+#define AUDIO_LATENCY_BUCKETS 64 // the last bucket also counts everything above it
+#define AUDIO_CLOCK_SMOOTHING 0.02f // of the measured device position per top up
+#define AUDIO_CLOCK_RESYNC_MS 20.0f // the clock snaps to the measured position when this far off
+#define AUDIO_CLOCK_STALE_MS 100 // frames are paced by the performance counter without updates
+#define AUDIO_SCHEDULE_MARGIN_MS 4 // from the start of a frame until its sounds are pushed
 
 // ENGINE CONSTANTS
 #define MINIMIZED_WAIT_TIME 100
-#define THREAD_COUNT 3 // excluding main thread
+#define THREAD_COUNT_MAX 64 // excluding main thread, default is one thread per physical core
+#define CPU_COUNT_MAX 1024 // logical cores considered for the thread topology
 #define THREAD_NAME "xbThread"
-#define WORK_QUEUE_ENTRIES 256
+#define WORK_QUEUE_ENTRIES 256 // per thread, has to be a power of 2
+#define LOGICAL_THREAD_ID_INVALID 0xFFFFFFFF
+#define CACHE_LINE_SIZE 64
+#define WORK_COUNTERS 32
+#define WORK_COUNTER_CONTINUATIONS 16 // entries that can wait on a single counter
+#define WORK_COUNTER_NONE 0xFFFFFFFF
+// idle worker threads spin, then yield, then park until new work arrives
+#define WORKER_SPIN_ROUNDS 256
+#define WORKER_YIELD_ROUNDS 16
+
+// RENDERING
+// tiles are rasterized on their own, 128x128 pixels are 64KB, which stays in L2 cache
+#define RENDER_TILE_SIZE 128
+#define RENDER_COMMANDS_MAX 4096 // per frame, further commands get dropped
+#define RENDER_TILE_COUNT_MAX (  ((WINDOW_MAX_WIDTH  + RENDER_TILE_SIZE - 1) / RENDER_TILE_SIZE) \
+                               * ((WINDOW_MAX_HEIGHT + RENDER_TILE_SIZE - 1) / RENDER_TILE_SIZE))
+#define DIRTY_RECTS_MAX 32 // more changed regions are merged into their bounding rectangle
+#define RENDER_SCALE_MIN 0.25f // of the window size, lowest internal render resolution
+// dynamic resolution: every DYNAMIC_RESOLUTION_FRAMES frames the render scale is set so that the
+// cpu time of a frame ends up at DYNAMIC_RESOLUTION_TARGET of the target time per frame
+#define DYNAMIC_RESOLUTION_FRAMES 30
+#define DYNAMIC_RESOLUTION_TARGET 0.8f
+#define DYNAMIC_RESOLUTION_MAX_STEP 0.1f // largest change of the scale at once
+#define DYNAMIC_RESOLUTION_MIN_STEP 0.02f // smaller changes are ignored (no full re-render)
+#define TEST_BITMAP_SIZE 128
+#define ASSET_TEST_BITMAPS_MAX 16 // bitmaps of the asset pack that get drawn
+#define AUDIO_TEST_TONE_FRAMES 256 // one period, 187.5Hz at the original rate
+#define AUDIO_TEST_BLIP_FRAMES 7200 // 150ms
+
+// ASSETS
+#define ASSET_PACK_DEFAULT "../build/assets.pack" // built by `make assets`, relative to src
+#define MUSIC_DEFAULT "../assets/music.wav" // streamed, PCM or IMA ADPCM, relative to src
 
 #endif // include guard end
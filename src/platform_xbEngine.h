@@ -30,7 +30,8 @@ uint32_t platformGetRefreshRate(PlatformWindow *platformWindow);
 
 void platformWait(uint32_t waitTimeMilliSeconds);
 
-PlatformWindow *platformOpenWindow(char *windowTitle, int createWidth, int createHeight);
+PlatformWindow *platformOpenWindow(MemoryArena *arena, char *windowTitle,
+                                   int createWidth, int createHeight      );
 void platformCloseWindow(PlatformWindow *platformWindow);
 void platformGetWindowSize(PlatformWindow *platformWindow, int *width, int *height);
 void platformOpenBackBuffer(GameBuffer *gameBuffer);
@@ -43,9 +44,19 @@ void platformResizeTexture(PlatformWindow *platformWindow, PlatformTexture *plat
 void platformOpenSoundDevice(uint32_t targetAudioFrameLatency, uint32_t targetRefreshRate,
                              GameSound *gameSound                                         );
 void platformCloseSoundDevice();
-void platformQueueAudio(GameSound *gameSound);
-
-void platformInitializeControllers(GameInput *gameInput);
+void platformQueueAudio(GameSound *gameSound, int16_t *audioToQueue, uint32_t audioToQueueBytes);
+
+PlatformAudio *platformCreateAudio(MemoryArena *arena, GameSound *gameSound);
+int32_t platformPushAudioCommand(PlatformAudio *platformAudio, AudioCommand *command);
+int32_t platformPopAudioEvent(PlatformAudio *platformAudio, AudioEvent *event);
+void platformMixAudio(PlatformAudio *platformAudio);
+void platformStartAudioThread(MemoryArena *arena, PlatformAudio *platformAudio);
+void platformStopAudioThread(PlatformAudio *platformAudio);
+void platformGetAudioClock(PlatformAudio *platformAudio, AudioClock *audioClock);
+void platformGetAudioLatencyStats(PlatformAudio *platformAudio, AudioLatencyStats *stats);
+void printAudioLatencyStats(AudioLatencyStats *stats, int32_t printHistograms);
+
+void platformInitializeControllers(MemoryArena *arena, GameInput *gameInput);
 void platformResetControllers(GameInput *gameInput);
 void platformCloseControllers(GameInput *gameInput);
 
@@ -53,6 +64,12 @@ FileReadResultDEBUG platformReadEntireFileDEBUG(char *fileName);
 void platformFreeFileMemoryDEBUG(void *memory);
 int32_t platformWriteEntireFileDEBUG(char *fileName, void *memory, uint32_t memorySize);
 
+int32_t platformMapFile(const char *fileName, MemoryArena *arena, PlatformMappedFile *mappedFile);
+void platformUnmapFile(PlatformMappedFile *mappedFile);
+int32_t platformOpenFile(const char *fileName, PlatformFile *file);
+uint32_t platformReadFile(PlatformFile *file, uint64_t offset, void *memory, uint32_t size);
+void platformCloseFile(PlatformFile *file);
+
 typedef int32_t PlatformThreadFunction(void *data);
 
 void platformHandleEvents(GameInput *gameInput, GameGlobal *gameGlobal);
@@ -1,7 +1,13 @@
 #include "constants.h"
 #include "xbEngine.h"
 #include "xbMath.h"
+#include "xbMemory.h"
+#include "xbPixel.h"
 #include "platform_xbEngine.h"
+#include "xbAsset.h"
+#include "xbAudio.h"
+#include "xbSample.h"
+#include "xbStream.h"
 
 #include <SDL.h>
 #include <SDL_audio.h>
@@ -9,7 +15,18 @@
 #include <SDL_gamecontroller.h>
 #include <cstdio> // for printf
 #include <cstring> // for memset
+#include <math.h> // for sqrtf
 #include <immintrin.h> // for __rdtsc (should work on all x86 compilers)
+#ifdef __linux__
+#include <cerrno> // for errno
+#include <fcntl.h> // for open
+#include <linux/futex.h> // for FUTEX_WAIT_PRIVATE, FUTEX_WAKE_PRIVATE
+#include <sched.h> // for sched_yield, sched_getaffinity, sched_setaffinity
+#include <sys/mman.h> // for mmap, munmap, madvise
+#include <sys/stat.h> // for fstat
+#include <sys/syscall.h> // for SYS_futex
+#include <unistd.h> // for syscall, pread, close
+#endif
 
 //NOTE[ALEX]: platform dependent code should stay in this file,
 //            all other files should be independent of the platform
@@ -21,6 +38,8 @@ struct PlatformWindow {
 
 struct PlatformTexture {
     SDL_Texture *textureHandle;
+    int          width;
+    int          height;
 };
 
 struct PlatformController {
@@ -30,9 +49,19 @@ struct PlatformController {
                                //            -1 is an invalid ID and should be the initialized value
 };
 
+struct PlatformThreadPool;
+
+//NOTE[ALEX]: the lifetime stats are only written by the thread itself and read after joining it
 struct PlatformThreadInfo {
-    uint32_t           logicalThreadID;
-    PlatformWorkQueue *platformWorkQueue;
+    uint32_t            logicalThreadID;
+    int32_t             pinnedCPU; // -1 if the thread may run on any cpu
+    PlatformThreadPool *threadPool;
+    PlatformWorkQueue  *highPriorityQueue; // always drained first
+    PlatformWorkQueue  *lowPriorityQueue;
+    uint64_t            startCounter;
+    uint64_t            endCounter;
+    uint64_t            parkedCounterTotal;
+    uint32_t            parkCount;
 };
 
 struct PlatformThread {
@@ -40,6 +69,20 @@ struct PlatformThread {
     PlatformThreadInfo *platformThreadInfo;
 };
 
+//NOTE[ALEX]: cpuOrder lists the cpus this process may run on, one cpu of every physical core
+//            first and their SMT siblings after that, so that the first threads do not end up
+//            sharing a core
+struct PlatformCPUTopology {
+    uint32_t logicalCoreCount;
+    uint32_t physicalCoreCount;
+    uint16_t cpuOrder[CPU_COUNT_MAX];
+};
+
+struct PlatformThreadConfig {
+    uint32_t threadCount; // worker threads, excluding the main thread
+    int32_t  pinThreads;
+};
+
 struct PlatformSemaphore {
     SDL_sem *semaphoreHandle;
 };
@@ -48,23 +91,171 @@ struct PlatformAtomicInt {
     SDL_atomic_t atomic;
 };
 
+struct PlatformSpinLock {
+    SDL_SpinLock lock;
+};
+
 struct PlatformWorkQueueEntry {
     PlatformWorkQueueCallback *callback;
     void                      *data;
+    uint32_t                   signalCounter;  // lowered after the callback returns
+    uint64_t                   enqueueCounter; // performance counter when the entry got queued
+};
+
+//NOTE[ALEX]: entries that wait on a counter are held here until the counter reaches zero,
+//            the spin lock orders adding a held entry against the counter reaching zero
+struct PlatformWorkCounter {
+    PlatformAtomicInt value;
+    PlatformSpinLock  spinLock;
+    uint32_t          continuationCount;
+    PlatformWorkQueueEntry continuations[WORK_COUNTER_CONTINUATIONS];
+};
+
+//NOTE[ALEX]: every thread that processes work owns one of these (indexed by logicalThreadID),
+//            the owner pushes and pops at the bottom, all other threads steal from the top;
+//            top and bottom are written by different threads, so they get their own cache lines
+struct PlatformWorkDeque {
+    PlatformAtomicInt top;
+    uint8_t           paddingTop[CACHE_LINE_SIZE - sizeof(PlatformAtomicInt)];
+    PlatformAtomicInt bottom;
+    uint8_t           paddingBottom[CACHE_LINE_SIZE - sizeof(PlatformAtomicInt)];
+    PlatformWorkQueueEntry entries[WORK_QUEUE_ENTRIES];
+};
+
+//NOTE[ALEX]: threads that do not own a deque (not created by the engine) add their work here
+struct PlatformWorkInjectRing {
+    PlatformSpinLock  spinLock;
+    PlatformAtomicInt entryCount; // allows checking for work without taking the lock
+    uint32_t          nextEntryToWrite;
+    uint32_t          nextEntryToRead;
+    uint8_t           padding[CACHE_LINE_SIZE - sizeof(PlatformSpinLock)
+                              - sizeof(PlatformAtomicInt) - 2*sizeof(uint32_t)];
+    PlatformWorkQueueEntry entries[WORK_QUEUE_ENTRIES];
+};
+
+//NOTE[ALEX]: idle worker threads park here, shared between all queues they serve;
+//            wakeSequence is bumped before every wake, so a thread that is about to park
+//            notices that it missed a wake and does not go to sleep;
+//            sleepingThreads only counts threads that have not been picked to be woken yet,
+//            so adding many entries at once never wakes more threads than are sleeping
+struct PlatformParkingLot {
+    PlatformAtomicInt  wakeSequence;
+    uint8_t            paddingSequence[CACHE_LINE_SIZE - sizeof(PlatformAtomicInt)];
+    PlatformAtomicInt  sleepingThreads;
+    uint8_t            paddingSleeping[CACHE_LINE_SIZE - sizeof(PlatformAtomicInt)];
+#ifndef __linux__
+    PlatformSemaphore *platformSemaphore; // fallback where there is no futex
+#endif
+};
+
+//NOTE[ALEX]: every thread only writes its own stats, they get summed up when they are read
+struct PlatformWorkQueueThreadStats {
+    uint64_t entriesCompleted;
+    uint64_t waitCounterTotal;      // from queuing an entry until it starts
+    uint64_t waitCounterMax;
+    uint64_t executionCounterTotal;
+    uint8_t  padding[CACHE_LINE_SIZE - 4*sizeof(uint64_t)];
 };
 
 struct PlatformWorkQueue {
-    PlatformSemaphore *platformSemaphore;
-    PlatformAtomicInt  nextEntryToWrite;
-    PlatformAtomicInt  nextEntryToRead;
+    PlatformParkingLot *parkingLot; // shared between all queues, not owned by the queue
+    uint32_t           dequeCount; // one per thread including the main thread
+    PlatformWorkDeque *deques;
+    uint8_t            paddingHead[CACHE_LINE_SIZE - sizeof(PlatformParkingLot *)
+                                   - sizeof(uint32_t) - sizeof(PlatformWorkDeque *)];
     PlatformAtomicInt  entryCompletionGoal;
+    uint8_t            paddingGoal[CACHE_LINE_SIZE - sizeof(PlatformAtomicInt)];
     PlatformAtomicInt  entryCompletionCount;
-    PlatformWorkQueueEntry entries[WORK_QUEUE_ENTRIES];
+    uint8_t            paddingCount[CACHE_LINE_SIZE - sizeof(PlatformAtomicInt)];
+    PlatformWorkInjectRing injectRing;
+    PlatformWorkCounter    counters[WORK_COUNTERS];
+    PlatformWorkQueueThreadStats *threadStats; // one per deque
+    PlatformWorkQueueThreadStats  lastReadStats; // totals at the last platformGetWorkQueueStats
+    ScratchArena                 *scratchArenas; // one per deque, shared between all queues
+};
+
+enum PlatformShutdownMode {
+    PLATFORM_SHUTDOWN_DRAIN,  // all queued and held work runs before the threads exit
+    PLATFORM_SHUTDOWN_CANCEL, // threads exit after their current entry, the rest is dropped
+};
+
+//NOTE[ALEX]: owns the worker threads and everything they share, so the whole thing can be
+//            created and destroyed any number of times in one process
+struct PlatformThreadPool {
+    uint32_t             threadCount; // excluding the main thread
+    PlatformParkingLot  *parkingLot;
+    PlatformWorkQueue   *highPriorityQueue;
+    PlatformWorkQueue   *lowPriorityQueue;
+    PlatformThreadInfo  *threadInfos;
+    PlatformThread     **threads;
+    ScratchArena        *scratchArenas; // threadCount + 1, includes the main thread
+    PlatformAtomicInt    shutdownRequested;
+};
+
+//NOTE[ALEX]: commands for the mixer go through a single producer (the game thread) single
+//            consumer (the audio thread) ring, each side only writes its own index, so no lock
+//            is needed; the indices get their own cache lines like the work deques
+//NOTE[ALEX]: the queue of the audio device has to bridge the device buffer and the time until
+//            the audio thread tops it up again, how long that takes depends on the machine and its
+//            load; the controller grows the target whenever the queue ran dry and shrinks it
+//            while the lowest queued audio of a window shows unused headroom, but never below
+//            the device buffer plus the average top up interval and a few deviations of it
+struct PlatformAudioLatency {
+    int32_t           adaptive;           // otherwise the target stays where it was opened
+    uint32_t          targetFrames;
+    uint64_t          lastCounter;        // of the previous top up
+    uint64_t          windowStartCounter;
+    uint64_t          holdUntilCounter;   // no shrinking before this (set by underruns)
+    uint32_t          windowMinFrames;    // lowest queued audio in the window
+    uint32_t          windowUnderruns;
+    int32_t           queuedBefore;       // the queue is empty before the first top up
+    float             msIntervalVariance;
+    AudioLatencyStats stats;
+};
+
+struct PlatformAudio {
+    PlatformAtomicInt writeIndex;
+    uint8_t           paddingWrite[CACHE_LINE_SIZE - sizeof(PlatformAtomicInt)];
+    PlatformAtomicInt readIndex;
+    uint8_t           paddingRead[CACHE_LINE_SIZE - sizeof(PlatformAtomicInt)];
+    AudioCommand      commands[AUDIO_COMMANDS_MAX];
+    //NOTE[ALEX]: events go the other way, from the mixing thread to the game thread
+    PlatformAtomicInt eventWriteIndex;
+    uint8_t           paddingEventWrite[CACHE_LINE_SIZE - sizeof(PlatformAtomicInt)];
+    PlatformAtomicInt eventReadIndex;
+    uint8_t           paddingEventRead[CACHE_LINE_SIZE - sizeof(PlatformAtomicInt)];
+    AudioEvent        events[AUDIO_EVENTS_MAX];
+    //NOTE[ALEX]: published by the audio thread at every top up, copied out by the game thread
+    PlatformSpinLock  clockLock;
+    AudioClock        clock;
+    PlatformAtomicInt quitRequested;
+    PlatformThread   *thread;    // 0 if the audio gets mixed on the main thread (headless)
+    GameSound        *gameSound;
+    AudioMixer        audioMixer;
+    PlatformAudioLatency latency; // audio thread only
+};
+
+//NOTE[ALEX]: frames end on a grid of the audio clock instead of the performance counter, so the
+//            frame rate follows the rate the device really plays at and the game never drifts
+//            against its audio; the next boundary is kept in audio frames times the refresh rate,
+//            so refresh rates that do not divide AUDIO_SAMPLES_PER_SECOND stay exact
+struct PlatformAudioPacing {
+    int32_t  enabled;
+    uint64_t nextBoundary; // audio frame * refresh rate, 0 until the first frame
 };
 
-PlatformSemaphore *platformCreateSemaphore(uint32_t initialValue)
+//NOTE[ALEX]: set once at the start of every thread that processes work (0 for the main thread),
+//            all other threads keep the invalid ID and add their work through the inject ring
+static thread_local uint32_t threadLogicalID = LOGICAL_THREAD_ID_INVALID;
+
+void platformSetLogicalThreadID(uint32_t logicalThreadID)
+{
+    threadLogicalID = logicalThreadID;
+}
+
+PlatformSemaphore *platformCreateSemaphore(MemoryArena *arena, uint32_t initialValue)
 {
-    PlatformSemaphore *platformSemaphore = (PlatformSemaphore *)malloc(sizeof(PlatformSemaphore));
+    PlatformSemaphore *platformSemaphore = pushStruct(arena, PlatformSemaphore);
     platformSemaphore->semaphoreHandle = 0;
 
     platformSemaphore->semaphoreHandle = SDL_CreateSemaphore(initialValue);
@@ -86,8 +277,6 @@ void platformDestroySemaphore(PlatformSemaphore *platformSemaphore)
     } else {
         printf("%s no semaphoreHandle to destroy\n", __FUNCTION__);
     }
-    
-    free(platformSemaphore);
 }
 
 int32_t platformWaitOnSemaphore(PlatformSemaphore *platformSemaphore, uint32_t timeoutMs)
@@ -132,107 +321,454 @@ int32_t platformAtomicCompareAndSwap(PlatformAtomicInt *platformAtomicInt,
     return atomicVariableWasSet;
 }
 
-PlatformWorkQueue *platformCreateWorkQueue()
+void platformLockSpinLock(PlatformSpinLock *platformSpinLock)
+{
+    SDL_AtomicLock(&platformSpinLock->lock);
+}
+
+void platformUnlockSpinLock(PlatformSpinLock *platformSpinLock)
+{
+    SDL_AtomicUnlock(&platformSpinLock->lock);
+}
+
+PlatformParkingLot *platformCreateParkingLot(MemoryArena *arena)
+{
+    PlatformParkingLot *parkingLot = pushStruct(arena, PlatformParkingLot, CACHE_LINE_SIZE);
+    memset(parkingLot, 0, sizeof(PlatformParkingLot));
+    platformAtomicSet(&parkingLot->wakeSequence, 0);
+    platformAtomicSet(&parkingLot->sleepingThreads, 0);
+#ifndef __linux__
+    parkingLot->platformSemaphore = platformCreateSemaphore(arena, 0);
+#endif
+
+    return parkingLot;
+}
+
+void platformDestroyParkingLot(PlatformParkingLot *parkingLot)
+{
+    if (!parkingLot) {
+        printf("%s received NULL handle\n", __FUNCTION__);
+    }
+
+#ifndef __linux__
+    platformDestroySemaphore(parkingLot->platformSemaphore);
+#endif
+}
+
+// wakes up to threadsToWake parked threads, costs no system call if no thread is parked
+void platformWakeParkedThreads(PlatformParkingLot *parkingLot, uint32_t threadsToWake)
+{
+    //NOTE[ALEX]: the new work has already been published with a full memory barrier,
+    //            a thread that parks after this read will see it when it checks the queues
+    int32_t sleepingThreads = platformAtomicGet(&parkingLot->sleepingThreads);
+    if (sleepingThreads <= 0 || threadsToWake == 0) {
+        return;
+    }
+    if ((uint32_t)sleepingThreads < threadsToWake) {
+        threadsToWake = sleepingThreads;
+    }
+
+    platformAtomicAdd(&parkingLot->wakeSequence, 1);
+#ifdef __linux__
+    int32_t threadsWoken = syscall(SYS_futex, &parkingLot->wakeSequence.atomic.value,
+                                   FUTEX_WAKE_PRIVATE, threadsToWake, 0, 0, 0        );
+    if (threadsWoken > 0) {
+        platformAtomicAdd(&parkingLot->sleepingThreads, -threadsWoken);
+    }
+#else
+    for (uint32_t i = 0; i < threadsToWake; i++) {
+        platformPostSemaphore(parkingLot->platformSemaphore);
+    }
+#endif
+}
+
+// threadCount excludes the main thread, every thread gets its own deque
+//NOTE[ALEX]: all queues served by the same threads share one parking lot to wake them up
+//NOTE[ALEX]: everything is cache line aligned, so the padding actually separates the cache lines
+PlatformWorkQueue *platformCreateWorkQueue(MemoryArena *arena, uint32_t threadCount,
+                                           PlatformParkingLot *parkingLot           )
 {
-    PlatformWorkQueue *platformWorkQueue = (PlatformWorkQueue *)malloc(sizeof(PlatformWorkQueue));
-    platformWorkQueue->platformSemaphore = platformCreateSemaphore(0);
-    platformAtomicSet(&platformWorkQueue->nextEntryToWrite, 0);
-    platformAtomicSet(&platformWorkQueue->nextEntryToRead, 0);
+    xbAssert((WORK_QUEUE_ENTRIES & (WORK_QUEUE_ENTRIES - 1)) == 0); // indices wrap with a mask
+
+    PlatformWorkQueue *platformWorkQueue = pushStruct(arena, PlatformWorkQueue, CACHE_LINE_SIZE);
+    memset(platformWorkQueue, 0, sizeof(PlatformWorkQueue));
+    platformWorkQueue->parkingLot = parkingLot;
+    platformWorkQueue->dequeCount = threadCount + 1;
+    platformWorkQueue->deques     = pushArray(arena, platformWorkQueue->dequeCount,
+                                              PlatformWorkDeque, CACHE_LINE_SIZE   );
+    platformWorkQueue->threadStats = pushArray(arena, platformWorkQueue->dequeCount,
+                                               PlatformWorkQueueThreadStats, CACHE_LINE_SIZE);
+    memset(platformWorkQueue->threadStats, 0,
+           platformWorkQueue->dequeCount * sizeof(PlatformWorkQueueThreadStats));
+    for (uint32_t i = 0; i < platformWorkQueue->dequeCount; i++) {
+        platformAtomicSet(&platformWorkQueue->deques[i].top, 0);
+        platformAtomicSet(&platformWorkQueue->deques[i].bottom, 0);
+    }
     platformAtomicSet(&platformWorkQueue->entryCompletionCount, 0);
     platformAtomicSet(&platformWorkQueue->entryCompletionGoal, 0);
+    platformAtomicSet(&platformWorkQueue->injectRing.entryCount, 0);
+    for (uint32_t i = 0; i < WORK_COUNTERS; i++) {
+        platformAtomicSet(&platformWorkQueue->counters[i].value, 0);
+    }
 
     return platformWorkQueue;
 }
 
-void platformDestroyWorkQueue(PlatformWorkQueue *platformWorkQueue)
+//NOTE[ALEX]: indices only ever grow (and wrap around as integers),
+//            so the number of entries is the difference between them
+inline int32_t workDequeSize(uint32_t top, uint32_t bottom)
 {
-    if (!platformWorkQueue) {
-        printf("%s received NULL handle\n", __FUNCTION__);
+    return (int32_t)(bottom - top);
+}
+
+// only the owning thread pushes to its deque
+int32_t platformPushWorkDeque(PlatformWorkDeque *workDeque, PlatformWorkQueueEntry entry)
+{
+    uint32_t bottom = platformAtomicGet(&workDeque->bottom);
+    uint32_t top    = platformAtomicGet(&workDeque->top);
+    if (workDequeSize(top, bottom) >= WORK_QUEUE_ENTRIES) {
+        return 0;
     }
 
-    if (platformWorkQueue->platformSemaphore) {
-        platformDestroySemaphore(platformWorkQueue->platformSemaphore);
+    workDeque->entries[bottom & (WORK_QUEUE_ENTRIES - 1)] = entry;
+    //NOTE[ALEX]: atomics include full memory barrier
+    platformAtomicSet(&workDeque->bottom, bottom + 1);
+
+    return 1;
+}
+
+// only the owning thread pops from its deque (last in, first out, so the data is still in cache)
+int32_t platformPopWorkDeque(PlatformWorkDeque *workDeque, PlatformWorkQueueEntry *entry)
+{
+    int32_t gotEntry = 0;
+
+    uint32_t bottom = platformAtomicGet(&workDeque->bottom) - 1;
+    //NOTE[ALEX]: reserve the bottom entry before looking at top,
+    //            so that a concurrent thief can see that it is taken
+    platformAtomicSet(&workDeque->bottom, bottom);
+    uint32_t top = platformAtomicGet(&workDeque->top);
+
+    if (workDequeSize(top, bottom) < 0) { // deque was empty, restore it
+        platformAtomicSet(&workDeque->bottom, bottom + 1);
     } else {
-        printf("%s no platformSempahore to destroy\n", __FUNCTION__);
+        *entry = workDeque->entries[bottom & (WORK_QUEUE_ENTRIES - 1)];
+        gotEntry = 1;
+        if (top == bottom) {
+            //NOTE[ALEX]: this is the last entry, race against thieves for it via top
+            gotEntry = platformAtomicCompareAndSwap(&workDeque->top, top, top + 1);
+            platformAtomicSet(&workDeque->bottom, bottom + 1);
+        }
     }
 
-    free(platformWorkQueue);
+    return gotEntry;
 }
 
-// this is for a single producer, only the main thread adds work
-int32_t platformAddWorkQueueEntry(PlatformWorkQueue *workQueue,
-                                  PlatformWorkQueueCallback *callback, void *data)
+// any thread may steal from the top of another thread's deque (first in, first out)
+// returns 1 on success, 0 if the deque is empty and -1 if another thread was faster
+int32_t platformStealWorkDeque(PlatformWorkDeque *workDeque, PlatformWorkQueueEntry *entry)
+{
+    uint32_t top    = platformAtomicGet(&workDeque->top);
+    uint32_t bottom = platformAtomicGet(&workDeque->bottom);
+    if (workDequeSize(top, bottom) <= 0) {
+        return 0;
+    }
+
+    *entry = workDeque->entries[top & (WORK_QUEUE_ENTRIES - 1)];
+    if (!platformAtomicCompareAndSwap(&workDeque->top, top, top + 1)) {
+        return -1;
+    }
+
+    return 1;
+}
+
+int32_t platformPushWorkInjectRing(PlatformWorkQueue *workQueue, PlatformWorkQueueEntry entry)
 {
     int32_t couldAddEntry = 0;
-    //NOTE[ALEX]: currently only one thread can write
-    uint32_t nextEntryToWrite = platformAtomicGet(&workQueue->nextEntryToWrite);
-    uint32_t nextEntryToRead  = platformAtomicGet(&workQueue->nextEntryToRead);
-    uint32_t entryCount = sizeof(workQueue->entries)/sizeof(workQueue->entries[0]);
-    //NOTE[ALEX]: prevent both pointers from pointing to the same entry,
-    //            so that the queue can never overtake itself and become invalid
-    if ( ((nextEntryToWrite + 1) %entryCount) != nextEntryToRead) {
-        PlatformWorkQueueEntry *entry = &workQueue->entries[nextEntryToWrite];
-        entry->callback = callback;
-        entry->data     = data;
-        platformAtomicAdd(&workQueue->entryCompletionGoal, 1);
-        //NOTE[ALEX]: atomics include full memory barrier
-        if (nextEntryToWrite == entryCount - 1) {
-            platformAtomicSet(&workQueue->nextEntryToWrite, 0);
-        } else {
-            platformAtomicAdd(&workQueue->nextEntryToWrite, 1);
-        }
-        platformPostSemaphore(workQueue->platformSemaphore);
+    PlatformWorkInjectRing *injectRing = &workQueue->injectRing;
+
+    platformLockSpinLock(&injectRing->spinLock);
+    if (injectRing->nextEntryToWrite - injectRing->nextEntryToRead < WORK_QUEUE_ENTRIES) {
+        injectRing->entries[injectRing->nextEntryToWrite & (WORK_QUEUE_ENTRIES - 1)] = entry;
+        injectRing->nextEntryToWrite++;
+        platformAtomicAdd(&injectRing->entryCount, 1);
         couldAddEntry = 1;
-    } else {
+    }
+    platformUnlockSpinLock(&injectRing->spinLock);
+
+    return couldAddEntry;
+}
+
+int32_t platformPopWorkInjectRing(PlatformWorkInjectRing *injectRing,
+                                  PlatformWorkQueueEntry *entry      )
+{
+    int32_t gotEntry = 0;
+
+    if (platformAtomicGet(&injectRing->entryCount) > 0) {
+        platformLockSpinLock(&injectRing->spinLock);
+        if (injectRing->nextEntryToRead != injectRing->nextEntryToWrite) {
+            *entry = injectRing->entries[injectRing->nextEntryToRead & (WORK_QUEUE_ENTRIES - 1)];
+            injectRing->nextEntryToRead++;
+            platformAtomicAdd(&injectRing->entryCount, -1);
+            gotEntry = 1;
+        }
+        platformUnlockSpinLock(&injectRing->spinLock);
+    }
+
+    return gotEntry;
+}
+
+// pushes an entry whose completion is already part of entryCompletionGoal
+int32_t platformPushWorkQueueEntry(PlatformWorkQueue *workQueue, PlatformWorkQueueEntry entry)
+{
+    int32_t couldAddEntry = 0;
+    entry.enqueueCounter = SDL_GetPerformanceCounter();
+
+    if (threadLogicalID < workQueue->dequeCount) {
+        couldAddEntry = platformPushWorkDeque(&workQueue->deques[threadLogicalID], entry);
+    }
+    if (!couldAddEntry) { // no own deque or own deque is full
+        couldAddEntry = platformPushWorkInjectRing(workQueue, entry);
+    }
+
+    if (!couldAddEntry) {
         printf("%s could not add entry, queue is full!\n", __FUNCTION__);
-        couldAddEntry = 0;
     }
 
     return couldAddEntry;
 }
 
+// any thread can add work, including callbacks that are currently executed by the queue;
+// threads that own a deque push to it, all others go through the shared inject ring
+//NOTE[ALEX]: work waiting on waitCounter is held back until that counter reaches zero,
+//            signalCounter is raised immediately and lowered once the work has completed,
+//            either counter can be WORK_COUNTER_NONE
+int32_t platformAddDependentWork(PlatformWorkQueue *workQueue, uint32_t waitCounter,
+                                 uint32_t signalCounter,
+                                 PlatformWorkQueueCallback *callback, void *data    )
+{
+    xbAssert(waitCounter   < WORK_COUNTERS || waitCounter   == WORK_COUNTER_NONE);
+    xbAssert(signalCounter < WORK_COUNTERS || signalCounter == WORK_COUNTER_NONE);
+    xbAssert(waitCounter != signalCounter || waitCounter == WORK_COUNTER_NONE);
+
+    PlatformWorkQueueEntry entry = {};
+    entry.callback      = callback;
+    entry.data          = data;
+    entry.signalCounter = signalCounter;
+
+    //NOTE[ALEX]: the goal has to be raised before the entry becomes visible, otherwise another
+    //            thread could complete it first and the completion count could match the goal
+    //            too early; the same goes for the signal counter and anyone waiting on it
+    platformAtomicAdd(&workQueue->entryCompletionGoal, 1);
+    if (signalCounter != WORK_COUNTER_NONE) {
+        platformAtomicAdd(&workQueue->counters[signalCounter].value, 1);
+    }
+
+    int32_t couldAddEntry = 0;
+    int32_t entryIsHeld   = 0;
+    if (waitCounter != WORK_COUNTER_NONE) {
+        PlatformWorkCounter *counter = &workQueue->counters[waitCounter];
+        platformLockSpinLock(&counter->spinLock);
+        if (platformAtomicGet(&counter->value) != 0) {
+            if (counter->continuationCount < WORK_COUNTER_CONTINUATIONS) {
+                counter->continuations[counter->continuationCount++] = entry;
+                couldAddEntry = 1;
+            } else {
+                printf("%s could not hold entry, counter %u has too many continuations!\n",
+                       __FUNCTION__, waitCounter                                           );
+            }
+            entryIsHeld = 1;
+        }
+        platformUnlockSpinLock(&counter->spinLock);
+    }
+    if (!entryIsHeld) {
+        couldAddEntry = platformPushWorkQueueEntry(workQueue, entry);
+        if (couldAddEntry) {
+            platformWakeParkedThreads(workQueue->parkingLot, 1);
+        }
+    }
+
+    if (!couldAddEntry) {
+        if (signalCounter != WORK_COUNTER_NONE) {
+            platformAtomicAdd(&workQueue->counters[signalCounter].value, -1);
+        }
+        platformAtomicAdd(&workQueue->entryCompletionGoal, -1);
+    }
+
+    return couldAddEntry;
+}
+
+int32_t platformAddWorkQueueEntry(PlatformWorkQueue *workQueue,
+                                  PlatformWorkQueueCallback *callback, void *data)
+{
+    return platformAddDependentWork(workQueue, WORK_COUNTER_NONE, WORK_COUNTER_NONE,
+                                    callback, data                                  );
+}
+
+// adds the same entry entryCount times and wakes all needed threads at once,
+// returns how many entries could be added
+uint32_t platformAddWorkQueueEntries(PlatformWorkQueue *workQueue, uint32_t entryCount,
+                                     PlatformWorkQueueCallback *callback, void *data   )
+{
+    PlatformWorkQueueEntry entry = {};
+    entry.callback      = callback;
+    entry.data          = data;
+    entry.signalCounter = WORK_COUNTER_NONE;
+
+    platformAtomicAdd(&workQueue->entryCompletionGoal, entryCount);
+    uint32_t entriesAdded = 0;
+    while (entriesAdded < entryCount && platformPushWorkQueueEntry(workQueue, entry)) {
+        entriesAdded++;
+    }
+    if (entriesAdded < entryCount) {
+        platformAtomicAdd(&workQueue->entryCompletionGoal, -(int32_t)(entryCount - entriesAdded));
+    }
+    platformWakeParkedThreads(workQueue->parkingLot, entriesAdded);
+
+    return entriesAdded;
+}
+
+// lowers the counter and releases all held entries if it reached zero
+void platformSignalWorkCounter(PlatformWorkQueue *workQueue, uint32_t counterIndex)
+{
+    PlatformWorkCounter *counter = &workQueue->counters[counterIndex];
+    int32_t prevValue = platformAtomicAdd(&counter->value, -1);
+    xbAssert(prevValue > 0);
+
+    if (prevValue == 1) {
+        PlatformWorkQueueEntry continuations[WORK_COUNTER_CONTINUATIONS];
+        platformLockSpinLock(&counter->spinLock);
+        uint32_t continuationCount = counter->continuationCount;
+        for (uint32_t i = 0; i < continuationCount; i++) {
+            continuations[i] = counter->continuations[i];
+        }
+        counter->continuationCount = 0;
+        platformUnlockSpinLock(&counter->spinLock);
+
+        uint32_t continuationsPushed = 0;
+        for (uint32_t i = 0; i < continuationCount; i++) {
+            if (platformPushWorkQueueEntry(workQueue, continuations[i])) {
+                continuationsPushed++;
+            } else {
+                //NOTE[ALEX]: its completion is already accounted for, so it has to run,
+                //            run it right here instead of dropping it
+                continuations[i].callback(continuations[i].data, threadLogicalID);
+                if (continuations[i].signalCounter != WORK_COUNTER_NONE) {
+                    platformSignalWorkCounter(workQueue, continuations[i].signalCounter);
+                }
+                platformAtomicAdd(&workQueue->entryCompletionCount, 1);
+            }
+        }
+        platformWakeParkedThreads(workQueue->parkingLot, continuationsPushed);
+    }
+}
+
+// whether there is an entry that could be picked up right now (held entries do not count)
+int32_t platformWorkQueueHasQueuedEntries(PlatformWorkQueue *workQueue)
+{
+    if (platformAtomicGet(&workQueue->injectRing.entryCount) > 0) {
+        return 1;
+    }
+    for (uint32_t i = 0; i < workQueue->dequeCount; i++) {
+        if (workDequeSize(platformAtomicGet(&workQueue->deques[i].top),
+                          platformAtomicGet(&workQueue->deques[i].bottom)) > 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 int32_t platformDoNextWorkQueueEntry(PlatformWorkQueue *workQueue, uint32_t logicalThreadID)
 {
     int32_t threadShouldWait = 0;
 
-    //NOTE[ALEX]: assume that acquiring work succeeds, then check afterwards
-    uint32_t nextEntryToWrite = platformAtomicGet(&workQueue->nextEntryToWrite);
-    uint32_t nextEntryToRead  = platformAtomicGet(&workQueue->nextEntryToRead);
-    if (nextEntryToWrite != nextEntryToRead) {
-        //NOTE[ALEX]: if there were only one consumer, then an atomic add would be sufficient
-        uint32_t entryCount         = sizeof(workQueue->entries)/sizeof(workQueue->entries[0]);
-        uint32_t newNextEntryToRead = (nextEntryToRead + 1) % entryCount;
-        int32_t  gotEntry = platformAtomicCompareAndSwap(&workQueue->nextEntryToRead,
-                                                         nextEntryToRead, newNextEntryToRead);
-        if (gotEntry) {
-            PlatformWorkQueueEntry entry = workQueue->entries[nextEntryToRead];
-            entry.callback(entry.data, logicalThreadID);
-            //NOTE[ALEX]: atomics include full memory barrier
-            platformAtomicAdd(&workQueue->entryCompletionCount, 1);
+    PlatformWorkQueueEntry entry = {};
+    int32_t gotEntry    = 0;
+    int32_t missedSteal = 0;
+    if (logicalThreadID < workQueue->dequeCount) {
+        gotEntry = platformPopWorkDeque(&workQueue->deques[logicalThreadID], &entry);
+    }
+    if (!gotEntry) {
+        gotEntry = platformPopWorkInjectRing(&workQueue->injectRing, &entry);
+    }
+    //NOTE[ALEX]: start stealing from the next thread over, so that thieves spread out
+    //            instead of all hitting the same deque
+    for (uint32_t i = 1; i <= workQueue->dequeCount && !gotEntry; i++) {
+        uint32_t victim = (logicalThreadID + i) % workQueue->dequeCount;
+        if (victim == logicalThreadID) { continue; }
+        int32_t stealResult = platformStealWorkDeque(&workQueue->deques[victim], &entry);
+        if (stealResult == 1) {
+            gotEntry = 1;
+        } else if (stealResult == -1) {
+            missedSteal = 1;
         }
-    } else {
+    }
+
+    if (gotEntry) {
+        //NOTE[ALEX]: a scope instead of a reset, as this can run inside another callback
+        //            on the same thread (while waiting for a counter or in parallelFor)
+        TemporaryMemory scratchMemory = {};
+        if (logicalThreadID < workQueue->dequeCount && workQueue->scratchArenas) {
+            scratchMemory = beginTemporaryMemory(&workQueue->scratchArenas[logicalThreadID].arena);
+        }
+        uint64_t startCounter = SDL_GetPerformanceCounter();
+        entry.callback(entry.data, logicalThreadID);
+        uint64_t endCounter   = SDL_GetPerformanceCounter();
+        if (logicalThreadID < workQueue->dequeCount) {
+            PlatformWorkQueueThreadStats *threadStats = &workQueue->threadStats[logicalThreadID];
+            uint64_t waitCounter = startCounter - entry.enqueueCounter;
+            threadStats->entriesCompleted++;
+            threadStats->waitCounterTotal      += waitCounter;
+            threadStats->executionCounterTotal += endCounter - startCounter;
+            if (waitCounter > threadStats->waitCounterMax) {
+                threadStats->waitCounterMax = waitCounter;
+            }
+        }
+        //NOTE[ALEX]: continuations get queued before this entry counts as completed,
+        //            so that platformCompleteAllWork cannot finish while they are in flight
+        if (entry.signalCounter != WORK_COUNTER_NONE) {
+            platformSignalWorkCounter(workQueue, entry.signalCounter);
+        }
+        if (scratchMemory.arena) {
+            endTemporaryMemory(scratchMemory);
+        }
+        //NOTE[ALEX]: atomics include full memory barrier
+        platformAtomicAdd(&workQueue->entryCompletionCount, 1);
+    } else if (!missedSteal) { // only wait if every deque was seen empty
         threadShouldWait = 1;
     }
     
     return threadShouldWait;
 }
 
-void platformResetWorkQueue(PlatformWorkQueue *workQueue)
-{
-    platformAtomicSet(&workQueue->entryCompletionGoal, 0);
-    platformAtomicSet(&workQueue->entryCompletionCount, 0);
-}
-
 // this makes the thread that is calling this participate in processing the queue
 // until all queued work is completed
+//NOTE[ALEX]: the counters are not reset afterwards, as other threads could be adding work at
+//            the same time, both counters wrap around in lockstep, so comparing them stays valid
 void platformCompleteAllWork(PlatformWorkQueue *workQueue, uint32_t logicalThreadID)
 {
     while (   platformAtomicGet(&workQueue->entryCompletionGoal)
            != platformAtomicGet(&workQueue->entryCompletionCount)) {
         platformDoNextWorkQueueEntry(workQueue, logicalThreadID);
     }
+}
+
+// this makes the thread that is calling this participate in processing the queue
+// until all work signaling the given counter (and the work held back by that) is completed,
+// other work keeps running and is not waited on
+void platformWaitForCounter(PlatformWorkQueue *workQueue, uint32_t counterIndex,
+                            uint32_t logicalThreadID                            )
+{
+    xbAssert(counterIndex < WORK_COUNTERS);
+    while (platformAtomicGet(&workQueue->counters[counterIndex].value) != 0) {
+        platformDoNextWorkQueueEntry(workQueue, logicalThreadID);
+    }
+}
 
-    platformResetWorkQueue(workQueue);
+// does not wait, for polling work that spans several frames
+uint32_t platformGetWorkCounter(PlatformWorkQueue *workQueue, uint32_t counterIndex)
+{
+    xbAssert(counterIndex < WORK_COUNTERS);
+    return (uint32_t)platformAtomicGet(&workQueue->counters[counterIndex].value);
 }
 
 void doQueueWorkPrint(void *data, uint32_t logicalThreadID)
@@ -241,104 +777,852 @@ void doQueueWorkPrint(void *data, uint32_t logicalThreadID)
     printf("Thread %u: %s\n", logicalThreadID, (char *)data);
 }
 
-int32_t threadProc(void *data) {
-    PlatformThreadInfo *threadInfo = (PlatformThreadInfo *)data;
-    printf("%s started for thread: %u\n", __FUNCTION__, threadInfo->logicalThreadID);
+// does nothing, for measuring the overhead of the queue itself
+void doQueueWorkNothing(void *data, uint32_t logicalThreadID)
+{
+}
+
+// adds more work from inside a callback to test that workers can spawn jobs themselves
+void doQueueWorkSpawn(void *data, uint32_t logicalThreadID)
+{
+    xbAssert(data != NULL);
+    PlatformWorkQueue *workQueue = (PlatformWorkQueue *)data;
+    platformAddWorkQueueEntry(workQueue, doQueueWorkPrint, (char *)"testC00 (spawned)");
+    platformAddWorkQueueEntry(workQueue, doQueueWorkPrint, (char *)"testC01 (spawned)");
+    platformAddWorkQueueEntry(workQueue, doQueueWorkPrint, (char *)"testC02 (spawned)");
+    printf("Thread %u: spawned 3 entries\n", logicalThreadID);
+}
+
+//NOTE[ALEX]: lives on the stack of the thread calling platformParallelFor,
+//            which does not return before every helper entry has finished
+struct PlatformParallelForJob {
+    ParallelForCallback *callback;
+    void                *data;
+    int32_t              end;
+    int32_t              grainSize;
+    uint8_t              paddingHead[CACHE_LINE_SIZE - sizeof(ParallelForCallback *)
+                                     - sizeof(void *) - 2*sizeof(int32_t)       ];
+    PlatformAtomicInt    nextBegin;
+    uint8_t              paddingNext[CACHE_LINE_SIZE - sizeof(PlatformAtomicInt)];
+    PlatformAtomicInt    helpersRunning;
+};
 
+//NOTE[ALEX]: chunks are claimed one at a time instead of being split up front,
+//            so threads that start late or run into slower chunks balance out on their own
+void platformRunParallelForChunks(PlatformParallelForJob *parallelFor, uint32_t logicalThreadID)
+{
     while (true) {
-        if (platformDoNextWorkQueueEntry(threadInfo->platformWorkQueue,
-                                         threadInfo->logicalThreadID)) {
-            printf("%s Thread %u goes to wait on semaphore\n",
-                   __FUNCTION__, threadInfo->logicalThreadID);
-            platformWaitOnSemaphore(threadInfo->platformWorkQueue->platformSemaphore, 0);
+        int32_t begin = platformAtomicAdd(&parallelFor->nextBegin, parallelFor->grainSize);
+        if (begin >= parallelFor->end) {
+            break;
         }
+        int32_t end = minI32(begin + parallelFor->grainSize, parallelFor->end);
+        parallelFor->callback(parallelFor->data, begin, end, logicalThreadID);
     }
 }
 
-//NOTE[ALEX]: threadName has different lengths on different platforms, SDL will try to munge the
-//            string but try to stick to < 8 bytes for the name (excluding \0), so 31 characters
-//NOTE[ALEX]: stackSize of 0 will initialize with system default stack size
-PlatformThread *platformCreateThread(PlatformThreadFunction platformThreadFunction,
-                                     char *threadName, void *threadData, size_t stackSize)
+void doParallelForHelper(void *data, uint32_t logicalThreadID)
 {
-    PlatformThread *platformThread = (PlatformThread *)malloc(sizeof(PlatformThread));
-    platformThread->threadHandle       = 0;
-    platformThread->platformThreadInfo = 0;
+    PlatformParallelForJob *parallelFor = (PlatformParallelForJob *)data;
+    platformRunParallelForChunks(parallelFor, logicalThreadID);
+    platformAtomicAdd(&parallelFor->helpersRunning, -1);
+}
 
-    //NOTE[ALEX]: in SDL2.1 stack size may be folded into SDL_CreateThread()
-    platformThread->threadHandle = SDL_CreateThreadWithStackSize(platformThreadFunction,
-                                                                 threadName, stackSize, threadData);
-    if (platformThread->threadHandle) {
-        platformThread->platformThreadInfo = (PlatformThreadInfo *)threadData;
-    } else {
-        printf("%s SDL_CreateThreadWithStackSize failed\n", __FUNCTION__);
+// calls callback for chunks of grainSize covering [begin, end) on all threads of the queue,
+// the calling thread works on chunks as well and returns once the whole range is done
+//NOTE[ALEX]: can be called from any thread, including from inside another callback
+void platformParallelFor(PlatformWorkQueue *workQueue, int32_t begin, int32_t end,
+                         int32_t grainSize, ParallelForCallback *callback, void *data)
+{
+    if (end <= begin) {
+        return;
+    }
+    grainSize = maxI32(grainSize, 1);
+    xbAssert(end <= 0x7FFFFFFF - grainSize*(int32_t)workQueue->dequeCount); // no overflow
+
+    PlatformParallelForJob parallelFor = {};
+    parallelFor.callback  = callback;
+    parallelFor.data      = data;
+    parallelFor.end       = end;
+    parallelFor.grainSize = grainSize;
+    platformAtomicSet(&parallelFor.nextBegin, begin);
+
+    uint32_t chunkCount  = (uint32_t)((end - begin + grainSize - 1) / grainSize);
+    uint32_t helperCount = chunkCount - 1; // the calling thread takes one chunk itself
+    if (helperCount > workQueue->dequeCount - 1) {
+        helperCount = workQueue->dequeCount - 1;
+    }
+    platformAtomicSet(&parallelFor.helpersRunning, helperCount);
+    if (helperCount > 0) {
+        uint32_t helpersAdded = platformAddWorkQueueEntries(workQueue, helperCount,
+                                                            doParallelForHelper, &parallelFor);
+        platformAtomicAdd(&parallelFor.helpersRunning, -(int32_t)(helperCount - helpersAdded));
     }
 
-    return platformThread;
+    platformRunParallelForChunks(&parallelFor, threadLogicalID);
+
+    //NOTE[ALEX]: helpers that have not started yet still point at parallelFor,
+    //            so keep processing the queue (which includes them) until all have returned
+    while (platformAtomicGet(&parallelFor.helpersRunning) > 0) {
+        platformDoNextWorkQueueEntry(workQueue, threadLogicalID);
+    }
 }
 
-void platformCleanupThread(PlatformThread *platformThread)
+// averages are over the entries completed since the previous call,
+// so this should only be called from one thread (usually once per frame or second)
+//NOTE[ALEX]: the per thread stats are read without synchronization, so they can be off by
+//            an entry that is completing right now, which is fine for statistics
+void platformGetWorkQueueStats(PlatformWorkQueue *workQueue, WorkQueueStats *stats)
 {
-    if (!platformThread) {
-        printf("%s received NULL handle\n", __FUNCTION__);
+    PlatformWorkQueueThreadStats totals = {};
+    for (uint32_t i = 0; i < workQueue->dequeCount; i++) {
+        PlatformWorkQueueThreadStats *threadStats = &workQueue->threadStats[i];
+        totals.entriesCompleted      += threadStats->entriesCompleted;
+        totals.waitCounterTotal      += threadStats->waitCounterTotal;
+        totals.executionCounterTotal += threadStats->executionCounterTotal;
+        if (threadStats->waitCounterMax > totals.waitCounterMax) {
+            totals.waitCounterMax = threadStats->waitCounterMax;
+        }
     }
-
-    if (platformThread->threadHandle) {
-        SDL_DetachThread(platformThread->threadHandle);
+    PlatformWorkQueueThreadStats *last = &workQueue->lastReadStats;
+    uint64_t entriesCompleted = totals.entriesCompleted - last->entriesCompleted;
+
+    float msPerCounter = 1000.0f / (float)SDL_GetPerformanceFrequency();
+    stats->depth = (uint32_t)(  platformAtomicGet(&workQueue->entryCompletionGoal)
+                              - platformAtomicGet(&workQueue->entryCompletionCount));
+    stats->entriesCompleted = entriesCompleted;
+    stats->msWaitMax        = msPerCounter * (float)totals.waitCounterMax;
+    if (entriesCompleted > 0) {
+        stats->msWaitAverage      = msPerCounter * (float)(totals.waitCounterTotal
+                                                           - last->waitCounterTotal)
+                                                  / (float)entriesCompleted;
+        stats->msExecutionAverage = msPerCounter * (float)(totals.executionCounterTotal
+                                                           - last->executionCounterTotal)
+                                                  / (float)entriesCompleted;
     } else {
-        printf("%s no threadHandle to clean up\n", __FUNCTION__);
+        stats->msWaitAverage      = 0.0f;
+        stats->msExecutionAverage = 0.0f;
     }
 
-    free(platformThread);
+    *last = totals;
 }
 
-void platformInit()
+void printWorkQueueStats(char *queueName, WorkQueueStats *stats)
 {
-    int sdlInitCode = SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER | SDL_INIT_AUDIO);
-    if (sdlInitCode != 0) {
-        printf("%s SDL_Init failed with code %i\n", __FUNCTION__, sdlInitCode);
-    }
+    printf("%s: depth %u, completed %lu, wait avg %.04fms max %.04fms, execution avg %.04fms\n",
+           queueName, stats->depth, stats->entriesCompleted, stats->msWaitAverage,
+           stats->msWaitMax, stats->msExecutionAverage                                      );
 }
 
-void platformInitClocks(GameClocks *gameClocks)
+// prints once all work on the counter it waited on has completed
+void doQueueWorkContinuation(void *data, uint32_t logicalThreadID)
 {
-    gameClocks->perfCountFrequency = SDL_GetPerformanceFrequency();
-    platformGetClocks(gameClocks);
+    xbAssert(data != NULL);
+    printf("Thread %u: %s (continuation)\n", logicalThreadID, (char *)data);
 }
 
-uint64_t platformGetPerformanceCounter()
+void platformYieldThread()
 {
-    return SDL_GetPerformanceCounter();
+#ifdef __linux__
+    sched_yield();
+#else
+    SDL_Delay(0);
+#endif
 }
 
-void platformGetClocks(GameClocks *gameClocks)
+// blocks until work gets added to one of the queues the thread serves
+void platformParkThread(PlatformThreadInfo *threadInfo)
 {
-    gameClocks->endPerfCounter     = platformGetPerformanceCounter();
-    gameClocks->elapsedPerfCounter = gameClocks->endPerfCounter - gameClocks->lastPerfCounter;
-    gameClocks->lastPerfCounter    = gameClocks->endPerfCounter;
+    PlatformParkingLot *parkingLot = threadInfo->highPriorityQueue->parkingLot;
+
+    int32_t wakeSequence = platformAtomicGet(&parkingLot->wakeSequence);
+    platformAtomicAdd(&parkingLot->sleepingThreads, 1);
+    //NOTE[ALEX]: work added before the thread announced itself as sleeping has to be seen here,
+    //            work added after that will find the thread when waking
+    if (   platformWorkQueueHasQueuedEntries(threadInfo->highPriorityQueue)
+        || platformWorkQueueHasQueuedEntries(threadInfo->lowPriorityQueue )
+        || platformAtomicGet(&threadInfo->threadPool->shutdownRequested)     ) {
+        platformAtomicAdd(&parkingLot->sleepingThreads, -1);
+        return;
+    }
 
-    gameClocks->msLastFrame =   (float)(gameClocks->elapsedPerfCounter)
-                              / (float)(gameClocks->perfCountFrequency);
-    // printf("Final: %0.4fms/f, %0.2ff/s   |   CPU only: %0.4fms/f, %0.2ff/s\n",
-    //        gameClocks->msLastFrame, 1.0f/gameClocks->msLastFrame,
-    //        gameClocks->msLastFrameCPU, 1.0f/gameClocks->msLastFrameCPU        );
+    uint64_t parkCounter = SDL_GetPerformanceCounter();
 
-    gameClocks->endCycleCount     = __rdtsc();
-    gameClocks->elapsedCycleCount = gameClocks->endCycleCount - gameClocks->lastCycleCount;
-    gameClocks->lastCycleCount    = gameClocks->endCycleCount;
+#ifdef __linux__
+    //NOTE[ALEX]: returns immediately if wakeSequence changed in the meantime,
+    //            only a successful wake (result 0) has been taken off sleepingThreads by the waker
+    int32_t result = syscall(SYS_futex, &parkingLot->wakeSequence.atomic.value,
+                             FUTEX_WAIT_PRIVATE, wakeSequence, 0, 0, 0          );
+    if (result != 0) {
+        platformAtomicAdd(&parkingLot->sleepingThreads, -1);
+    }
+#else
+    platformWaitOnSemaphore(parkingLot->platformSemaphore, 0);
+    platformAtomicAdd(&parkingLot->sleepingThreads, -1);
+#endif
+    threadInfo->parkedCounterTotal += SDL_GetPerformanceCounter() - parkCounter;
+    threadInfo->parkCount++;
 }
 
-void platformGetElapsedCPU(GameClocks *gameClocks)
+void platformGetCPUTopology(PlatformCPUTopology *topology)
 {
-    uint64_t elapsed = platformGetPerformanceCounter() - gameClocks->lastPerfCounter;
-    gameClocks->msLastFrameCPU = (float)elapsed / (float)(gameClocks->perfCountFrequency);
-}
+    topology->logicalCoreCount  = 0;
+    topology->physicalCoreCount = 0;
+
+#ifdef __linux__
+    //NOTE[ALEX]: only cpus in the affinity mask count (taskset, cgroups, containers),
+    //            cores are identified by package and core id from sysfs
+    cpu_set_t affinity;
+    CPU_ZERO(&affinity);
+    if (sched_getaffinity(0, sizeof(affinity), &affinity) == 0) {
+        int32_t  coreKeys[CPU_COUNT_MAX];
+        uint16_t siblings[CPU_COUNT_MAX];
+        uint32_t siblingCount = 0;
+        for (uint32_t cpu = 0; cpu < CPU_SETSIZE && cpu < CPU_COUNT_MAX; cpu++) {
+            if (!CPU_ISSET(cpu, &affinity)) { continue; }
+
+            int32_t ids[2] = { -1, -1 }; // package id, core id
+            const char *idFiles[2] = { "physical_package_id", "core_id" };
+            for (uint32_t i = 0; i < 2; i++) {
+                char path[128];
+                snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/%s",
+                         cpu, idFiles[i]                                               );
+                FILE *idFile = fopen(path, "r");
+                if (idFile) {
+                    if (fscanf(idFile, "%d", &ids[i]) != 1) { ids[i] = -1; }
+                    fclose(idFile);
+                }
+            }
+            int32_t coreKey = (ids[0] < 0 || ids[1] < 0) ? -(int32_t)cpu - 1 // unknown: own core
+                                                         : (ids[0] << 16) | ids[1];
 
-float platformGetSecondsElapsed(uint64_t lastCounter, uint64_t thisCounter,
-                                uint64_t perfCountFrequency                )
-{
-    return ((float)(thisCounter - lastCounter) / (float)perfCountFrequency);
-}
+            int32_t isSibling = 0;
+            for (uint32_t i = 0; i < topology->physicalCoreCount; i++) {
+                if (coreKeys[i] == coreKey) { isSibling = 1; break; }
+            }
+            if (isSibling) {
+                siblings[siblingCount++] = cpu;
+            } else {
+                coreKeys[topology->physicalCoreCount] = coreKey;
+                topology->cpuOrder[topology->physicalCoreCount++] = cpu;
+            }
+            topology->logicalCoreCount++;
+        }
+        for (uint32_t i = 0; i < siblingCount; i++) {
+            topology->cpuOrder[topology->physicalCoreCount + i] = siblings[i];
+        }
+    }
+#endif
+
+    if (topology->logicalCoreCount == 0) { // fallback, SMT siblings cannot be told apart
+        topology->logicalCoreCount  = maxI32(SDL_GetCPUCount(), 1);
+        if (topology->logicalCoreCount > CPU_COUNT_MAX) {
+            topology->logicalCoreCount = CPU_COUNT_MAX;
+        }
+        topology->physicalCoreCount = topology->logicalCoreCount;
+        for (uint32_t i = 0; i < topology->logicalCoreCount; i++) {
+            topology->cpuOrder[i] = i;
+        }
+    }
+
+    printf("%s logical cores: %u, physical cores: %u\n",
+           __FUNCTION__, topology->logicalCoreCount, topology->physicalCoreCount);
+}
+
+// whether a flag was given on the command line or the environment variable is set to non zero
+int32_t platformHasOption(int argc, char **argv, const char *flag, const char *environmentVariable)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], flag) == 0) { return 1; }
+    }
+    char *environmentValue = SDL_getenv(environmentVariable);
+    return environmentValue && SDL_atoi(environmentValue) != 0;
+}
+
+// value following a flag on the command line, otherwise the value of the environment variable,
+// otherwise defaultValue; the command line wins over the environment
+// a whole decimal number with an optional sign, anything else (including an empty value or one
+// that does not fit) is rejected and leaves value alone
+int32_t platformParseInt32(const char *text, int32_t *value)
+{
+    const char *character = text;
+    int32_t     negative  = *character == '-';
+    if (*character == '-' || *character == '+') { character++; }
+    if (!*character) { return 0; }
+    int64_t result = 0;
+    for (; *character; character++) {
+        if (*character < '0' || *character > '9') { return 0; }
+        result = result * 10 + (*character - '0');
+        if (result > (int64_t)INT32_MAX + 1) { return 0; }
+    }
+    if (negative) { result = -result; }
+    if (result > INT32_MAX) { return 0; }
+    *value = (int32_t)result;
+    return 1;
+}
+
+int32_t platformGetOptionValue(int argc, char **argv, const char *flag,
+                               const char *environmentVariable, int32_t defaultValue)
+{
+    int32_t value = defaultValue;
+    char *environmentValue = SDL_getenv(environmentVariable);
+    if (environmentValue && !platformParseInt32(environmentValue, &value)) {
+        printf("%s %s=\"%s\" is not a number, ignored\n",
+               __FUNCTION__, environmentVariable, environmentValue);
+    }
+    for (int i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], flag) == 0 && !platformParseInt32(argv[i + 1], &value)) {
+            printf("%s %s %s is not a number, ignored\n", __FUNCTION__, flag, argv[i + 1]);
+        }
+    }
+    return value;
+}
+
+// string following a flag on the command line, otherwise the value of the environment variable,
+// otherwise defaultValue
+const char *platformGetOptionString(int argc, char **argv, const char *flag,
+                                    const char *environmentVariable, const char *defaultValue)
+{
+    const char *value = defaultValue;
+    char *environmentValue = SDL_getenv(environmentVariable);
+    if (environmentValue) { value = environmentValue; }
+    for (int i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], flag) == 0) { value = argv[i + 1]; }
+    }
+    return value;
+}
+
+// by default there is one thread per physical core (the main thread takes one of them),
+// this can be overridden with --threads N / XB_THREAD_COUNT (workers excluding the main thread)
+// and threads get pinned to their own core with --pin-threads / XB_PIN_THREADS=1
+void platformGetThreadConfig(int argc, char **argv, PlatformCPUTopology *topology,
+                             PlatformThreadConfig *config                         )
+{
+    int32_t threadCount = platformGetOptionValue(argc, argv, "--threads", "XB_THREAD_COUNT",
+                                                 (int32_t)topology->physicalCoreCount - 1 );
+    config->pinThreads  = platformHasOption(argc, argv, "--pin-threads", "XB_PIN_THREADS");
+
+    if (threadCount < 0) {
+        threadCount = 0;
+    } else if (threadCount > THREAD_COUNT_MAX) {
+        printf("%s %i threads requested, only %u supported\n",
+               __FUNCTION__, threadCount, THREAD_COUNT_MAX      );
+        threadCount = THREAD_COUNT_MAX;
+    }
+    config->threadCount = (uint32_t)threadCount;
+
+    printf("%s worker threads: %u (plus main thread), pinned: %i\n",
+           __FUNCTION__, config->threadCount, config->pinThreads    );
+}
+
+//NOTE[ALEX]: the game renders at --render-scale P percent of the window size
+//            (XB_RENDER_SCALE) or at a fixed --render-width W and --render-height H
+//            (XB_RENDER_WIDTH, XB_RENDER_HEIGHT) and gets upscaled with --upscale-filter N
+//            (XB_UPSCALE_FILTER, 0 nearest, 1 integer, 2 bilinear); --dynamic-resolution
+//            (XB_DYNAMIC_RESOLUTION) lowers the scale while frames take too long
+void platformGetRenderTargetConfig(int argc, char **argv, RenderTarget *renderTarget,
+                                   MemoryArena *transientArena                       )
+{
+    subArena(&renderTarget->arena, transientArena, GAMEBUFFER_ARENA_SIZE,
+             GAMEBUFFER_PITCH_ALIGNMENT                                 );
+    int32_t renderScale = platformGetOptionValue(argc, argv, "--render-scale", "XB_RENDER_SCALE",
+                                                 100                                              );
+    renderTarget->scale       = clampF32((float)renderScale / 100.0f, RENDER_SCALE_MIN, 1.0f);
+    renderTarget->fixedWidth  = maxI32(platformGetOptionValue(argc, argv, "--render-width",
+                                                              "XB_RENDER_WIDTH", 0         ), 0);
+    renderTarget->fixedHeight = maxI32(platformGetOptionValue(argc, argv, "--render-height",
+                                                              "XB_RENDER_HEIGHT", 0         ), 0);
+    int32_t upscaleFilter = platformGetOptionValue(argc, argv, "--upscale-filter",
+                                                   "XB_UPSCALE_FILTER", UPSCALE_FILTER_BILINEAR);
+    upscaleFilter = minI32(maxI32(upscaleFilter, 0), UPSCALE_FILTER_COUNT - 1);
+    renderTarget->filter = (UpscaleFilter)upscaleFilter;
+    renderTarget->dynamicResolution = platformHasOption(argc, argv, "--dynamic-resolution",
+                                                        "XB_DYNAMIC_RESOLUTION"          );
+    printf("%s render scale: %.02f, fixed resolution: %ix%i, upscale filter: %i, dynamic: %i\n",
+           __FUNCTION__, renderTarget->scale, renderTarget->fixedWidth,
+           renderTarget->fixedHeight, renderTarget->filter, renderTarget->dynamicResolution);
+}
+
+// the logical thread ID picks the cpu, so low IDs get a physical core of their own
+int32_t platformGetThreadCPU(PlatformCPUTopology *topology, uint32_t logicalThreadID)
+{
+    return topology->cpuOrder[logicalThreadID % topology->logicalCoreCount];
+}
+
+//NOTE[ALEX]: pins the calling thread, pinning from inside the thread works without the
+//            native thread handle, which SDL does not expose
+void platformPinThread(uint32_t logicalThreadID, int32_t cpu)
+{
+#ifdef __linux__
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+    if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) != 0) { // 0 is the calling thread
+        printf("%s could not pin thread %u to cpu %i\n", __FUNCTION__, logicalThreadID, cpu);
+    }
+#else
+    printf("%s pinning threads is not supported on this platform\n", __FUNCTION__);
+#endif
+}
+
+int32_t threadProc(void *data) {
+    PlatformThreadInfo *threadInfo = (PlatformThreadInfo *)data;
+    platformSetLogicalThreadID(threadInfo->logicalThreadID);
+    if (threadInfo->pinnedCPU >= 0) {
+        platformPinThread(threadInfo->logicalThreadID, threadInfo->pinnedCPU);
+    }
+    threadInfo->startCounter = SDL_GetPerformanceCounter();
+    printf("%s started for thread: %u\n", __FUNCTION__, threadInfo->logicalThreadID);
+
+    //NOTE[ALEX]: the high priority queue is always checked first, low priority work only gets
+    //            picked up one entry at a time while there is no high priority work left
+    //NOTE[ALEX]: when there is no work, the thread spins for a short while (work usually comes
+    //            in bursts during a frame), then yields its time slice and only then parks
+    //NOTE[ALEX]: the shutdown request is checked before every entry, when draining the queues
+    //            the pool only requests it once there is no work left
+    uint32_t idleRounds = 0;
+    while (!platformAtomicGet(&threadInfo->threadPool->shutdownRequested)) {
+        if (!platformDoNextWorkQueueEntry(threadInfo->highPriorityQueue,
+                                          threadInfo->logicalThreadID  )) {
+            idleRounds = 0;
+            continue;
+        }
+        if (!platformDoNextWorkQueueEntry(threadInfo->lowPriorityQueue,
+                                          threadInfo->logicalThreadID )) {
+            idleRounds = 0;
+            continue;
+        }
+
+        idleRounds++;
+        if (idleRounds <= WORKER_SPIN_ROUNDS) {
+            _mm_pause();
+        } else if (idleRounds <= WORKER_SPIN_ROUNDS + WORKER_YIELD_ROUNDS) {
+            platformYieldThread();
+        } else {
+            platformParkThread(threadInfo);
+            idleRounds = 0;
+        }
+    }
+
+    threadInfo->endCounter = SDL_GetPerformanceCounter();
+    return 0;
+}
+
+#ifdef WORK_QUEUE_LATENCY_TEST
+struct SemaphoreLatencyTest {
+    PlatformSemaphore *platformSemaphore;
+    PlatformAtomicInt  rounds;
+    uint64_t           postCounter;
+    uint64_t           latencyCounterTotal;
+    uint64_t           latencyCounterMax;
+};
+
+int32_t semaphoreLatencyTestProc(void *data)
+{
+    SemaphoreLatencyTest *test = (SemaphoreLatencyTest *)data;
+    while (platformAtomicGet(&test->rounds) > 0) {
+        platformWaitOnSemaphore(test->platformSemaphore, 0);
+        uint64_t latency = SDL_GetPerformanceCounter() - test->postCounter;
+        test->latencyCounterTotal += latency;
+        if (latency > test->latencyCounterMax) { test->latencyCounterMax = latency; }
+        platformAtomicAdd(&test->rounds, -1);
+    }
+    return 0;
+}
+
+// waits for the workers without participating, so only their latency gets measured
+void latencyTestWaitForWorkers(PlatformWorkQueue *workQueue)
+{
+    while (   platformAtomicGet(&workQueue->entryCompletionGoal)
+           != platformAtomicGet(&workQueue->entryCompletionCount)) {
+        platformYieldThread(); //NOTE[ALEX]: lets the workers run on machines with few cores
+    }
+}
+
+// measures the time from adding an entry until a worker starts it, once with parked workers
+// and once with spinning workers, and compares it to the previous semaphore based wake
+void platformRunWorkQueueLatencyTest(PlatformWorkQueue *workQueue, MemoryArena *arena)
+{
+    const uint32_t rounds = 200;
+    float msPerCounter = 1000.0f / (float)SDL_GetPerformanceFrequency();
+    WorkQueueStats stats = {};
+    platformGetWorkQueueStats(workQueue, &stats); // reset the averages
+
+    SemaphoreLatencyTest semaphoreTest = {};
+    TemporaryMemory semaphoreMemory = beginTemporaryMemory(arena);
+    semaphoreTest.platformSemaphore = platformCreateSemaphore(arena, 0);
+    platformAtomicSet(&semaphoreTest.rounds, rounds);
+    SDL_Thread *semaphoreThread = SDL_CreateThread(semaphoreLatencyTestProc,
+                                                   "xbLatency", &semaphoreTest);
+    for (uint32_t i = 0; i < rounds; i++) {
+        SDL_Delay(1);
+        semaphoreTest.postCounter = SDL_GetPerformanceCounter();
+        platformPostSemaphore(semaphoreTest.platformSemaphore);
+        while (platformAtomicGet(&semaphoreTest.rounds) > (int32_t)(rounds - i - 1)) {
+            platformYieldThread();
+        }
+    }
+    SDL_WaitThread(semaphoreThread, 0);
+    platformDestroySemaphore(semaphoreTest.platformSemaphore);
+    endTemporaryMemory(semaphoreMemory);
+    printf("%s semaphore wake:  avg %.04fms, max %.04fms\n", __FUNCTION__,
+           msPerCounter * (float)semaphoreTest.latencyCounterTotal / (float)rounds,
+           msPerCounter * (float)semaphoreTest.latencyCounterMax                  );
+
+    for (uint32_t i = 0; i < rounds; i++) {
+        SDL_Delay(1); // long enough for all workers to park
+        platformAddWorkQueueEntry(workQueue, doQueueWorkNothing, 0);
+        latencyTestWaitForWorkers(workQueue);
+    }
+    platformGetWorkQueueStats(workQueue, &stats);
+    printf("%s parked workers:  avg %.04fms, max %.04fms\n", __FUNCTION__,
+           stats.msWaitAverage, stats.msWaitMax                             );
+
+    for (uint32_t i = 0; i < rounds; i++) {
+        platformAddWorkQueueEntry(workQueue, doQueueWorkNothing, 0);
+        latencyTestWaitForWorkers(workQueue);
+    }
+    platformGetWorkQueueStats(workQueue, &stats);
+    printf("%s spinning workers: avg %.04fms (max is since startup)\n", __FUNCTION__,
+           stats.msWaitAverage                                                        );
+}
+#endif
+
+#ifdef PIXEL_KERNEL_BENCHMARK
+// gigabytes written per second by fill over a whole buffer (best of rounds, single thread)
+float platformBenchmarkPixelFill(PixelFillFunction *fill, uint32_t *buffer,
+                                 uint32_t width, uint32_t height, uint32_t pitch)
+{
+    const uint32_t rounds = 16;
+    uint64_t bestCounter = 0xFFFFFFFFFFFFFFFF;
+    for (uint32_t i = 0; i < rounds; i++) {
+        uint64_t startCounter = SDL_GetPerformanceCounter();
+        uint8_t *row = (uint8_t *)buffer;
+        for (uint32_t y = 0; y < height; y++) {
+            fill((uint32_t *)row, width, 0x80000000 | i);
+            row += pitch;
+        }
+        uint64_t elapsedCounter = SDL_GetPerformanceCounter() - startCounter;
+        if (elapsedCounter < bestCounter) { bestCounter = elapsedCounter; }
+    }
+    float seconds = (float)bestCounter / (float)SDL_GetPerformanceFrequency();
+    return (float)width * height * sizeof(uint32_t) / (float)Gigabytes(1) / seconds;
+}
+
+float platformBenchmarkPixelCopy(PixelCopyFunction *copy, uint32_t *destination,
+                                 uint32_t *source, uint32_t width, uint32_t height, uint32_t pitch)
+{
+    const uint32_t rounds = 16;
+    uint64_t bestCounter = 0xFFFFFFFFFFFFFFFF;
+    for (uint32_t i = 0; i < rounds; i++) {
+        uint64_t startCounter = SDL_GetPerformanceCounter();
+        for (uint32_t y = 0; y < height; y++) {
+            copy((uint32_t *)((uint8_t *)destination + y * pitch),
+                 (uint32_t *)((uint8_t *)source      + y * pitch), width);
+        }
+        uint64_t elapsedCounter = SDL_GetPerformanceCounter() - startCounter;
+        if (elapsedCounter < bestCounter) { bestCounter = elapsedCounter; }
+    }
+    float seconds = (float)bestCounter / (float)SDL_GetPerformanceFrequency();
+    return (float)width * height * sizeof(uint32_t) / (float)Gigabytes(1) / seconds;
+}
+
+// compares every supported kernel level at 1080p and 4K, the scalar level is the reference
+void platformRunPixelKernelBenchmark(MemoryArena *arena)
+{
+    const uint32_t sizes[][2] = { { 1920, 1080 }, { 3840, 2160 } };
+    PixelKernelLevel supportedLevel = getSupportedPixelKernelLevel();
+
+    for (uint32_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        uint32_t width  = sizes[i][0];
+        uint32_t height = sizes[i][1];
+        uint32_t pitch  = alignPow2U32(width * sizeof(uint32_t), GAMEBUFFER_PITCH_ALIGNMENT);
+        TemporaryMemory benchmarkMemory = beginTemporaryMemory(arena);
+        uint32_t *source      = (uint32_t *)pushSize(arena, (uint64_t)pitch * height,
+                                                     GAMEBUFFER_PITCH_ALIGNMENT       );
+        uint32_t *destination = (uint32_t *)pushSize(arena, (uint64_t)pitch * height,
+                                                     GAMEBUFFER_PITCH_ALIGNMENT       );
+        for (int32_t level = 0; level <= supportedLevel; level++) {
+            PixelKernels pixelKernels = {};
+            getPixelKernels(&pixelKernels, (PixelKernelLevel)level);
+            float fill      = platformBenchmarkPixelFill(pixelKernels.fillSpan, destination,
+                                                         width, height, pitch               );
+            float streaming = platformBenchmarkPixelFill(pixelKernels.fillSpanStreaming,
+                                                         destination, width, height, pitch);
+            float copy      = platformBenchmarkPixelCopy(pixelKernels.copySpan, destination,
+                                                         source, width, height, pitch       );
+            float blend     = platformBenchmarkPixelFill(pixelKernels.blendSpan, destination,
+                                                         width, height, pitch                );
+            float blendCopy = platformBenchmarkPixelCopy(pixelKernels.blendCopySpan,
+                                                         destination, source,
+                                                         width, height, pitch       );
+            printf("%s %ux%u %-6s fill %6.02fGB/s, streaming fill %6.02fGB/s, "
+                   "copy %6.02fGB/s, blend %6.02fGB/s, blend copy %6.02fGB/s\n",
+                   __FUNCTION__, width, height, getPixelKernelLevelName((PixelKernelLevel)level),
+                   fill, streaming, copy, blend, blendCopy                                      );
+        }
+        endTemporaryMemory(benchmarkMemory);
+    }
+}
+#endif
+
+#ifdef SAMPLE_KERNEL_BENCHMARK
+//NOTE[ALEX]: mixes one second with every voice playing a looping sound at a different rate and
+//            pan (best of rounds, single thread); voices per ms is how many voices one millisecond
+//            of mixing keeps up with, so it has to stay well above AUDIO_VOICES_MAX
+void platformRunSampleKernelBenchmark(MemoryArena *arena, PixelKernelLevel activeLevel)
+{
+    const uint32_t rounds      = 8;
+    const uint32_t frameCount  = AUDIO_SAMPLES_PER_SECOND;
+    const uint32_t soundFrames = 4096;
+    TemporaryMemory benchmarkMemory = beginTemporaryMemory(arena);
+    AudioMixer *audioMixer = pushStruct(arena, AudioMixer);
+    int16_t    *output     = pushArray(arena, frameCount * AUDIO_CHANNELS, int16_t);
+    float      *converted  = pushArray(arena, frameCount * AUDIO_CHANNELS, float);
+    int16_t    *samples    = pushArray(arena, soundFrames * 2, int16_t);
+    for (uint32_t i = 0; i < soundFrames * 2; i++) {
+        samples[i] = (int16_t)((i * 7919) % 16384) - 8192; // the content does not matter
+    }
+    AudioSound sounds[2] = { { samples, soundFrames, 1 }, { samples, soundFrames, 2 } };
+    float audioMs = 1000.0f * (float)frameCount / (float)AUDIO_SAMPLES_PER_SECOND;
+
+    PixelKernelLevel supportedLevel = getSupportedPixelKernelLevel();
+    for (int32_t level = 0; level <= supportedLevel; level++) {
+        initializeSampleKernels((PixelKernelLevel)level);
+        uint64_t bestMixCounter     = 0xFFFFFFFFFFFFFFFF;
+        uint64_t bestConvertCounter = 0xFFFFFFFFFFFFFFFF;
+        for (uint32_t round = 0; round < rounds; round++) {
+            *audioMixer = {};
+            for (uint32_t i = 0; i < AUDIO_VOICES_MAX; i++) {
+                float voiceMult = (float)i / (float)(AUDIO_VOICES_MAX - 1);
+                AudioCommand command = {};
+                command.type    = AUDIO_COMMAND_PLAY;
+                command.voiceID = i + 1;
+                command.sound   = &sounds[i % 2];
+                command.volume  = 0.01f;
+                command.pan     = 2.0f * voiceMult - 1.0f;
+                command.rate    = 0.5f + 1.5f * voiceMult;
+                command.loop    = true;
+                applyAudioCommand(audioMixer, &command);
+            }
+            uint64_t startCounter = SDL_GetPerformanceCounter();
+            mixAudio(audioMixer, output, frameCount);
+            uint64_t elapsedCounter = SDL_GetPerformanceCounter() - startCounter;
+            if (elapsedCounter < bestMixCounter) { bestMixCounter = elapsedCounter; }
+
+            startCounter = SDL_GetPerformanceCounter();
+            convertSamplesFromS16(converted, output, frameCount * AUDIO_CHANNELS);
+            convertSamplesToS16(output, converted, frameCount * AUDIO_CHANNELS);
+            elapsedCounter = SDL_GetPerformanceCounter() - startCounter;
+            if (elapsedCounter < bestConvertCounter) { bestConvertCounter = elapsedCounter; }
+        }
+        float frequency = (float)SDL_GetPerformanceFrequency();
+        float mixMs     = 1000.0f * (float)bestMixCounter / frequency;
+        float convertMs = 1000.0f * (float)bestConvertCounter / frequency;
+        printf("%s %-6s %u voices %.03fms per second of audio, %.0f voices per ms, "
+               "s16 to float and back %.03fms\n",
+               __FUNCTION__, getPixelKernelLevelName((PixelKernelLevel)level), AUDIO_VOICES_MAX,
+               mixMs, (float)AUDIO_VOICES_MAX * audioMs / mixMs, convertMs                     );
+    }
+    initializeSampleKernels(activeLevel);
+    endTemporaryMemory(benchmarkMemory);
+}
+#endif
+
+//NOTE[ALEX]: threadName has different lengths on different platforms, SDL will try to munge the
+//            string but try to stick to < 8 bytes for the name (excluding \0), so 31 characters
+//NOTE[ALEX]: stackSize of 0 will initialize with system default stack size
+PlatformThread *platformCreateThread(MemoryArena *arena,
+                                     PlatformThreadFunction platformThreadFunction,
+                                     char *threadName, void *threadData, size_t stackSize)
+{
+    PlatformThread *platformThread = pushStruct(arena, PlatformThread);
+    platformThread->threadHandle       = 0;
+    platformThread->platformThreadInfo = 0;
+
+    //NOTE[ALEX]: in SDL2.1 stack size may be folded into SDL_CreateThread()
+    platformThread->threadHandle = SDL_CreateThreadWithStackSize(platformThreadFunction,
+                                                                 threadName, stackSize, threadData);
+    if (platformThread->threadHandle) {
+        platformThread->platformThreadInfo = (PlatformThreadInfo *)threadData;
+    } else {
+        printf("%s SDL_CreateThreadWithStackSize failed\n", __FUNCTION__);
+    }
+
+    return platformThread;
+}
+
+// blocks until the thread function has returned
+void platformCleanupThread(PlatformThread *platformThread)
+{
+    if (!platformThread) {
+        printf("%s received NULL handle\n", __FUNCTION__);
+    }
+
+    if (platformThread->threadHandle) {
+        SDL_WaitThread(platformThread->threadHandle, 0);
+    } else {
+        printf("%s no threadHandle to clean up\n", __FUNCTION__);
+    }
+}
+
+//NOTE[ALEX]: all memory of the pool comes from arena (the scratch arenas from scratchMemory)
+//            and is not given back when destroying it,
+//            pools that are created repeatedly should be put in a temporary memory scope
+PlatformThreadPool *platformCreateThreadPool(MemoryArena *arena, MemoryArena *scratchMemory,
+                                             PlatformThreadConfig *threadConfig,
+                                             PlatformCPUTopology *cpuTopology              )
+{
+    PlatformThreadPool *threadPool = pushStruct(arena, PlatformThreadPool, CACHE_LINE_SIZE);
+    memset(threadPool, 0, sizeof(PlatformThreadPool));
+    uint32_t threadCount = threadConfig->threadCount;
+    threadPool->threadCount       = threadCount;
+    threadPool->parkingLot        = platformCreateParkingLot(arena);
+    threadPool->highPriorityQueue = platformCreateWorkQueue(arena, threadCount,
+                                                            threadPool->parkingLot);
+    threadPool->lowPriorityQueue  = platformCreateWorkQueue(arena, threadCount,
+                                                            threadPool->parkingLot);
+    //NOTE[ALEX]: every thread writes its own lifetime stats, so keep them on separate cache lines
+    threadPool->threadInfos = pushArray(arena, threadCount, PlatformThreadInfo, CACHE_LINE_SIZE);
+    threadPool->threads     = pushArray(arena, threadCount, PlatformThread *);
+    threadPool->scratchArenas = pushArray(arena, threadCount + 1, ScratchArena, CACHE_LINE_SIZE);
+    for (uint32_t i = 0; i < threadCount + 1; i++) {
+        subArena(&threadPool->scratchArenas[i].arena, scratchMemory, SCRATCH_ARENA_SIZE,
+                 CACHE_LINE_SIZE                                                         );
+    }
+    threadPool->highPriorityQueue->scratchArenas = threadPool->scratchArenas;
+    threadPool->lowPriorityQueue->scratchArenas  = threadPool->scratchArenas;
+    platformAtomicSet(&threadPool->shutdownRequested, 0);
+
+    char *threadName = (char *)THREAD_NAME;
+    size_t threadStackSize = 0;
+    for (uint32_t i = 0; i < threadCount; i++) {
+        PlatformThreadInfo *threadInfo = &threadPool->threadInfos[i];
+        *threadInfo = {};
+        threadInfo->logicalThreadID   = i + 1; //NOTE[ALEX]: 0 is reserverd for main thread
+        threadInfo->pinnedCPU         = threadConfig->pinThreads
+                                      ? platformGetThreadCPU(cpuTopology, i + 1) : -1;
+        threadInfo->threadPool        = threadPool;
+        threadInfo->highPriorityQueue = threadPool->highPriorityQueue;
+        threadInfo->lowPriorityQueue  = threadPool->lowPriorityQueue;
+        threadPool->threads[i] = platformCreateThread(arena, threadProc, threadName,
+                                                      (void *)threadInfo, threadStackSize);
+    }
+
+    return threadPool;
+}
+
+void printThreadPoolStats(PlatformThreadPool *threadPool)
+{
+    float secondsPerCounter = 1.0f / (float)SDL_GetPerformanceFrequency();
+    for (uint32_t i = 0; i < threadPool->threadCount + 1; i++) {
+        PlatformWorkQueueThreadStats *highStats = &threadPool->highPriorityQueue->threadStats[i];
+        PlatformWorkQueueThreadStats *lowStats  = &threadPool->lowPriorityQueue->threadStats[i];
+        float secondsBusy = secondsPerCounter * (float)(  highStats->executionCounterTotal
+                                                        + lowStats->executionCounterTotal );
+        if (i == 0) { // the main thread has no lifetime of its own in the pool
+            printf("thread 0: entries high %lu low %lu, busy %.03fs\n",
+                   highStats->entriesCompleted, lowStats->entriesCompleted, secondsBusy);
+            continue;
+        }
+        PlatformThreadInfo *threadInfo = &threadPool->threadInfos[i - 1];
+        float secondsAlive  = secondsPerCounter * (float)(  threadInfo->endCounter
+                                                          - threadInfo->startCounter);
+        float secondsParked = secondsPerCounter * (float)threadInfo->parkedCounterTotal;
+        printf("thread %u: entries high %lu low %lu, busy %.03fs, parked %.03fs (%u times), "
+               "alive %.03fs\n", threadInfo->logicalThreadID, highStats->entriesCompleted,
+               lowStats->entriesCompleted, secondsBusy, secondsParked, threadInfo->parkCount,
+               secondsAlive                                                                 );
+    }
+}
+
+// stops all worker threads and joins them,
+// must be called from the thread that created the pool
+void platformDestroyThreadPool(PlatformThreadPool *threadPool, PlatformShutdownMode shutdownMode)
+{
+    if (!threadPool) {
+        printf("%s received NULL handle\n", __FUNCTION__);
+    }
+
+    if (shutdownMode == PLATFORM_SHUTDOWN_DRAIN) {
+        //NOTE[ALEX]: low priority work can add high priority work and the other way round,
+        //            so repeat until both are done at the same time
+        do {
+            platformCompleteAllWork(threadPool->highPriorityQueue, threadLogicalID);
+            platformCompleteAllWork(threadPool->lowPriorityQueue, threadLogicalID);
+        } while (   platformAtomicGet(&threadPool->highPriorityQueue->entryCompletionGoal)
+                 != platformAtomicGet(&threadPool->highPriorityQueue->entryCompletionCount)
+                 ||    platformAtomicGet(&threadPool->lowPriorityQueue->entryCompletionGoal)
+                    != platformAtomicGet(&threadPool->lowPriorityQueue->entryCompletionCount));
+    }
+
+    //NOTE[ALEX]: parked threads check the request before going to sleep,
+    //            so waking every sleeping thread after setting it cannot miss one
+    platformAtomicSet(&threadPool->shutdownRequested, 1);
+    platformWakeParkedThreads(threadPool->parkingLot, threadPool->threadCount);
+    for (uint32_t i = 0; i < threadPool->threadCount; i++) {
+        platformCleanupThread(threadPool->threads[i]);
+    }
+
+    uint32_t entriesDropped =
+        (uint32_t)(  platformAtomicGet(&threadPool->highPriorityQueue->entryCompletionGoal)
+                   - platformAtomicGet(&threadPool->highPriorityQueue->entryCompletionCount))
+      + (uint32_t)(  platformAtomicGet(&threadPool->lowPriorityQueue->entryCompletionGoal)
+                   - platformAtomicGet(&threadPool->lowPriorityQueue->entryCompletionCount) );
+    printf("%s joined %u threads, dropped %u entries\n",
+           __FUNCTION__, threadPool->threadCount, entriesDropped);
+    printThreadPoolStats(threadPool);
+
+    platformDestroyParkingLot(threadPool->parkingLot);
+}
+
+void platformInit()
+{
+    int sdlInitCode = SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER | SDL_INIT_AUDIO);
+    if (sdlInitCode != 0) {
+        printf("%s SDL_Init failed with code %i\n", __FUNCTION__, sdlInitCode);
+    }
+}
+
+void platformInitClocks(GameClocks *gameClocks)
+{
+    gameClocks->perfCountFrequency = SDL_GetPerformanceFrequency();
+    platformGetClocks(gameClocks);
+}
+
+uint64_t platformGetPerformanceCounter()
+{
+    return SDL_GetPerformanceCounter();
+}
+
+void platformGetClocks(GameClocks *gameClocks)
+{
+    gameClocks->endPerfCounter     = platformGetPerformanceCounter();
+    gameClocks->elapsedPerfCounter = gameClocks->endPerfCounter - gameClocks->lastPerfCounter;
+    gameClocks->lastPerfCounter    = gameClocks->endPerfCounter;
+
+    gameClocks->msLastFrame =   (float)(gameClocks->elapsedPerfCounter)
+                              / (float)(gameClocks->perfCountFrequency);
+    // printf("Final: %0.4fms/f, %0.2ff/s   |   CPU only: %0.4fms/f, %0.2ff/s\n",
+    //        gameClocks->msLastFrame, 1.0f/gameClocks->msLastFrame,
+    //        gameClocks->msLastFrameCPU, 1.0f/gameClocks->msLastFrameCPU        );
+
+    gameClocks->endCycleCount     = __rdtsc();
+    gameClocks->elapsedCycleCount = gameClocks->endCycleCount - gameClocks->lastCycleCount;
+    gameClocks->lastCycleCount    = gameClocks->endCycleCount;
+}
+
+void platformGetElapsedCPU(GameClocks *gameClocks)
+{
+    uint64_t elapsed = platformGetPerformanceCounter() - gameClocks->lastPerfCounter;
+    gameClocks->msLastFrameCPU = (float)elapsed / (float)(gameClocks->perfCountFrequency);
+}
+
+float platformGetSecondsElapsed(uint64_t lastCounter, uint64_t thisCounter,
+                                uint64_t perfCountFrequency                )
+{
+    return ((float)(thisCounter - lastCounter) / (float)perfCountFrequency);
+}
 
 uint32_t platformGetRefreshRate(PlatformWindow *platformWindow)
 {
@@ -361,9 +1645,75 @@ void platformWait(uint32_t waitTimeMilliSeconds)
     SDL_Delay(timeToWait);
 }
 
-PlatformWindow *platformOpenWindow(char *windowTitle, int createWidth, int createHeight)
+//NOTE[ALEX]: the memory is only reserved as address space, pages get backed by physical memory
+//            (and zeroed by the os) the first time they are touched, so large pools cost
+//            nothing up front; MAP_NORESERVE keeps the reservation from counting against
+//            overcommit limits; huge pages reduce tlb misses on large pools if the system has
+//            transparent huge pages enabled
+void *platformAllocateMemory(uint64_t size, int32_t useHugePages)
 {
-    PlatformWindow *platformWindow = (PlatformWindow *)malloc(sizeof(PlatformWindow));
+#ifdef __linux__
+    void *memory = mmap(0, size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED) {
+        printf("%s mmap of %lu bytes failed\n", __FUNCTION__, size);
+        return 0;
+    }
+    if (useHugePages && madvise(memory, size, MADV_HUGEPAGE) != 0) {
+        printf("%s huge pages not available\n", __FUNCTION__);
+    }
+    return memory;
+#else
+    //NOTE[ALEX]: large callocs get fresh pages from the os as well, which are already zero
+    return calloc(1, size);
+#endif
+}
+
+void platformFreeMemory(void *memory, uint64_t size)
+{
+#ifdef __linux__
+    munmap(memory, size);
+#else
+    free(memory);
+#endif
+}
+
+// gives the physical pages of a block back to the os, the address space stays reserved and
+// reads as zero again once touched
+void platformDecommitMemory(void *memory, uint64_t size)
+{
+#ifdef __linux__
+    uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t begin    = ((uint64_t)memory + pageSize - 1) & ~(pageSize - 1);
+    uint64_t end      = ((uint64_t)memory + size) & ~(pageSize - 1);
+    if (end > begin) {
+        madvise((void *)begin, end - begin, MADV_DONTNEED);
+    }
+#endif
+}
+
+// resident set size of the process in bytes, 0 if unknown
+uint64_t platformGetResidentMemory()
+{
+    uint64_t residentBytes = 0;
+#ifdef __linux__
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm) {
+        uint64_t totalPages    = 0;
+        uint64_t residentPages = 0;
+        if (fscanf(statm, "%lu %lu", &totalPages, &residentPages) == 2) {
+            residentBytes = residentPages * (uint64_t)sysconf(_SC_PAGESIZE);
+        }
+        fclose(statm);
+    }
+#endif
+    return residentBytes;
+}
+
+PlatformWindow *platformOpenWindow(MemoryArena *arena, char *windowTitle,
+                                   int createWidth, int createHeight      )
+{
+    PlatformWindow *platformWindow = pushStruct(arena, PlatformWindow);
     platformWindow->window   = 0;
     platformWindow->renderer = 0;
 
@@ -374,14 +1724,33 @@ PlatformWindow *platformOpenWindow(char *windowTitle, int createWidth, int creat
                                               SDL_WINDOW_RESIZABLE      );
     if (!platformWindow->window) {
         printf("%s SDL_CreateWindow failed\n", __FUNCTION__);
-    } else {
+    }
+    
+    return platformWindow;
+}
+
+//NOTE[ALEX]: SDL only supports rendering on the thread that created the window, so the
+//            renderer (and everything created from it) is only used by the main thread
+void platformCreateRenderer(PlatformWindow *platformWindow)
+{
+    if (platformWindow->window) {
         platformWindow->renderer = SDL_CreateRenderer(platformWindow->window, -1, 0);
         if (!platformWindow->renderer) {
             printf("%s SDL_CreateRenderer failed\n", __FUNCTION__);
         }
+    } else {
+        printf("%s no window to create a renderer for\n", __FUNCTION__);
+    }
+}
+
+void platformDestroyRenderer(PlatformWindow *platformWindow)
+{
+    if (platformWindow->renderer) {
+        SDL_DestroyRenderer(platformWindow->renderer);
+        platformWindow->renderer = 0;
+    } else {
+        printf("%s no renderer to destroy\n", __FUNCTION__);
     }
-    
-    return platformWindow;
 }
 
 void platformCloseWindow(PlatformWindow *platformWindow)
@@ -390,55 +1759,44 @@ void platformCloseWindow(PlatformWindow *platformWindow)
         printf("%s received NULL handle\n", __FUNCTION__);
     }
 
+    //NOTE[ALEX]: the renderer has to be destroyed by platformDestroyPresenter before this
     if (platformWindow->window) {
         SDL_DestroyWindow(platformWindow->window);
     } else {
         printf("%s no window to destroy\n", __FUNCTION__);
     }
-    if (platformWindow->renderer) {
-        SDL_DestroyRenderer(platformWindow->renderer);
-    } else {
-        printf("%s no renderer to destroy\n", __FUNCTION__);
-    }
     
     SDL_Quit();
-
-    free(platformWindow);
 }
 
 void platformOpenBackBuffer(GameBuffer *gameBuffer)
 {
     gameBuffer->bytesPerPixel = GAMEBUFFER_BYTES_PER_PIXEL;
-    PlatformTexture *platformTexture = (PlatformTexture *)malloc(sizeof(PlatformTexture));
-    platformTexture->textureHandle = 0;
-    gameBuffer->platformTexture = platformTexture;
     platformUpdateBackBuffer(gameBuffer);
 }
 
+//NOTE[ALEX]: only updates the size, the memory of every buffer in the present ring gets resized
+//            when it is acquired next and the main thread resizes its texture to match
 void platformUpdateBackBuffer(GameBuffer *gameBuffer)
 {
     platformGetWindowSize((PlatformWindow *)(gameBuffer->platformWindow),
                           &gameBuffer->width, &gameBuffer->height);
-    platformResizeTexture((PlatformWindow *)(gameBuffer->platformWindow),
-                          (PlatformTexture *)(gameBuffer->platformTexture),
-                          gameBuffer->width, gameBuffer->height            );
-    gameBuffer->pitch = gameBuffer->bytesPerPixel * gameBuffer->width;
+    gameBuffer->pitch = alignPow2U32(gameBuffer->bytesPerPixel * gameBuffer->width,
+                                     GAMEBUFFER_PITCH_ALIGNMENT                    );
 }
 
 void platformCloseBackBuffer(GameBuffer *gameBuffer)
 {
-    if (gameBuffer->platformTexture) {
-        free(gameBuffer->platformTexture); 
-    } else {
-        printf("%s no platformTexture memory to free\n", __FUNCTION__);
-    }
+    //NOTE[ALEX]: the memory belongs to the present ring
+    gameBuffer->textureMemory = 0;
 }
 
 void platformGetWindowSize(PlatformWindow *platformWindow, int *width, int *height)
 {
     SDL_GetWindowSize(platformWindow->window, width, height);
     //NOTE[ALEX]: by default SDL will stretch the texture to fit the window
-    //            if it is smaller than the window dimensions, so this will not fail
+    //            if it is smaller than the window dimensions, so this will not fail,
+    //            the maximum only limits how much address space is reserved for the GameBuffer
     if (*width > WINDOW_MAX_WIDTH ) {
         printf("window width %u larger than maximum %u, clamping to maximum.\n",
                *width, (uint32_t)WINDOW_MAX_WIDTH                               );
@@ -451,55 +1809,386 @@ void platformGetWindowSize(PlatformWindow *platformWindow, int *width, int *heig
     }
 }
 
-void platformResizeTexture(PlatformWindow *platformWindow, PlatformTexture *platformTexture,
-                           int width, int height                                            )
+void platformResizeTexture(PlatformWindow *platformWindow, PlatformTexture *platformTexture,
+                           int width, int height                                            )
+{
+    if (platformTexture->textureHandle != 0) {
+        SDL_DestroyTexture(platformTexture->textureHandle); 
+    }
+
+    platformTexture->textureHandle = 0;
+    platformTexture->width         = width;
+    platformTexture->height        = height;
+    if (platformWindow->renderer) {
+        platformTexture->textureHandle = SDL_CreateTexture(platformWindow->renderer,
+                                                           SDL_PIXELFORMAT_ARGB8888,
+                                                           SDL_TEXTUREACCESS_STREAMING,
+                                                           width, height               );
+    } else {
+        printf("%s renderer not initialized\n", __FUNCTION__);
+    }
+}
+
+// how much audio the game keeps queued up ahead
+void platformSetAudioLatency(uint32_t targetAudioFrameLatency, uint32_t targetRefreshRate,
+                             GameSound *gameSound                                         )
+{
+    gameSound->bytesPerSamplePerChannel = sizeof(int16_t);
+    float targetTimePerFrame = 1.0f/(float)targetRefreshRate;
+    float targetLatency      = targetTimePerFrame * (float)targetAudioFrameLatency;
+    uint32_t bytesPerFrame   = AUDIO_CHANNELS * gameSound->bytesPerSamplePerChannel;
+    gameSound->targetQueuedBytes = bytesPerFrame * roundF32toU32
+        (targetLatency * (float)AUDIO_SAMPLES_PER_SECOND);
+
+    // printf("%s targetLatency: %.04f, targetAudioFrameLatency: %u, targetTimePerFrame: %.04f, targetQueuedBytes: %u\n",
+    //        __FUNCTION__, targetLatency, targetAudioFrameLatency,
+    //        targetTimePerFrame, gameSound->targetQueuedBytes     );
+}
+
+void platformOpenSoundDevice(uint32_t targetAudioFrameLatency, uint32_t targetRefreshRate,
+                             GameSound *gameSound                                         )
+{
+    xbAssert(targetAudioFrameLatency > 0);
+
+    SDL_AudioSpec sdlAudioSettings = {};
+    sdlAudioSettings.freq     = AUDIO_SAMPLES_PER_SECOND;
+    sdlAudioSettings.format   = AUDIO_S16LSB; // signed 16bit little endian for each sample
+    sdlAudioSettings.channels = AUDIO_CHANNELS;
+    sdlAudioSettings.samples  = AUDIO_SAMPLES_PER_CALL; // buffer size per channel,
+                                                        // this will be passed per call,
+                                                        // so this is the minimum audio latency
+    sdlAudioSettings.callback = 0; // if left empty, SDL_QueueAudio can be used
+    
+    SDL_OpenAudio(&sdlAudioSettings, 0); //NOTE[ALEX]: passing 0 to the output will make this
+                                         //            modify the passed input instead
+
+    if (sdlAudioSettings.format != AUDIO_S16LSB) {
+        printf("%s format is not what was requested, but %u.\n",
+               __FUNCTION__, sdlAudioSettings.format            );
+    }
+    platformSetAudioLatency(targetAudioFrameLatency, targetRefreshRate, gameSound);
+
+    SDL_PauseAudio(0); // 0 for unpause, 1 for pause
+}
+
+PlatformAudio *platformCreateAudio(MemoryArena *arena, GameSound *gameSound)
+{
+    xbAssert((AUDIO_COMMANDS_MAX & (AUDIO_COMMANDS_MAX - 1)) == 0); // indices wrap with a mask
+    xbAssert((AUDIO_EVENTS_MAX   & (AUDIO_EVENTS_MAX   - 1)) == 0);
+
+    PlatformAudio *platformAudio = pushStruct(arena, PlatformAudio, CACHE_LINE_SIZE);
+    memset(platformAudio, 0, sizeof(PlatformAudio));
+    platformAtomicSet(&platformAudio->writeIndex, 0);
+    platformAtomicSet(&platformAudio->readIndex, 0);
+    platformAtomicSet(&platformAudio->eventWriteIndex, 0);
+    platformAtomicSet(&platformAudio->eventReadIndex, 0);
+    platformAtomicSet(&platformAudio->quitRequested, 0);
+    platformAudio->gameSound = gameSound;
+    gameSound->platformAudio            = platformAudio;
+    gameSound->platformPushAudioCommand = platformPushAudioCommand;
+    gameSound->platformPopAudioEvent    = platformPopAudioEvent;
+    gameSound->platformGetAudioClock    = platformGetAudioClock;
+
+    return platformAudio;
+}
+
+// game thread only, returns 0 if the ring is full
+int32_t platformPushAudioCommand(PlatformAudio *platformAudio, AudioCommand *command)
+{
+    uint32_t writeIndex = platformAtomicGet(&platformAudio->writeIndex);
+    uint32_t readIndex  = platformAtomicGet(&platformAudio->readIndex);
+    if (writeIndex - readIndex >= AUDIO_COMMANDS_MAX) {
+        printf("%s command ring full\n", __FUNCTION__);
+        return 0;
+    }
+    platformAudio->commands[writeIndex & (AUDIO_COMMANDS_MAX - 1)] = *command;
+    platformAtomicSet(&platformAudio->writeIndex, writeIndex + 1); // publishes the command
+    return 1;
+}
+
+// audio thread only
+int32_t platformPopAudioCommand(PlatformAudio *platformAudio, AudioCommand *command)
+{
+    uint32_t readIndex  = platformAtomicGet(&platformAudio->readIndex);
+    uint32_t writeIndex = platformAtomicGet(&platformAudio->writeIndex);
+    if (readIndex == writeIndex) { return 0; }
+    *command = platformAudio->commands[readIndex & (AUDIO_COMMANDS_MAX - 1)];
+    platformAtomicSet(&platformAudio->readIndex, readIndex + 1); // frees the slot
+    return 1;
+}
+
+// mixing thread only, returns 0 if the ring is full
+int32_t platformPushAudioEvent(PlatformAudio *platformAudio, AudioEvent *event)
+{
+    uint32_t writeIndex = platformAtomicGet(&platformAudio->eventWriteIndex);
+    uint32_t readIndex  = platformAtomicGet(&platformAudio->eventReadIndex);
+    if (writeIndex - readIndex >= AUDIO_EVENTS_MAX) { return 0; } // kept by the mixer
+    platformAudio->events[writeIndex & (AUDIO_EVENTS_MAX - 1)] = *event;
+    platformAtomicSet(&platformAudio->eventWriteIndex, writeIndex + 1); // publishes the event
+    return 1;
+}
+
+// game thread only
+int32_t platformPopAudioEvent(PlatformAudio *platformAudio, AudioEvent *event)
+{
+    uint32_t readIndex  = platformAtomicGet(&platformAudio->eventReadIndex);
+    uint32_t writeIndex = platformAtomicGet(&platformAudio->eventWriteIndex);
+    if (readIndex == writeIndex) { return 0; }
+    *event = platformAudio->events[readIndex & (AUDIO_EVENTS_MAX - 1)];
+    platformAtomicSet(&platformAudio->eventReadIndex, readIndex + 1); // frees the slot
+    return 1;
+}
+
+// passes the events of the mixer on to the game, the ones that do not fit into the ring stay
+// with the mixer until the next top up
+void platformPassAudioEvents(PlatformAudio *platformAudio)
+{
+    AudioMixer *audioMixer = &platformAudio->audioMixer;
+    uint32_t passed = 0;
+    while (   passed < audioMixer->eventCount
+           && platformPushAudioEvent(platformAudio, &audioMixer->events[passed])) {
+        passed++;
+    }
+    for (uint32_t i = passed; i < audioMixer->eventCount; i++) {
+        audioMixer->events[i - passed] = audioMixer->events[i];
+    }
+    audioMixer->eventCount -= passed;
+}
+
+// applies the pending commands and mixes enough audio to fill the queue up to its target
+void platformMixAudio(PlatformAudio *platformAudio)
+{
+    GameSound *gameSound = platformAudio->gameSound;
+    platformPassAudioEvents(platformAudio);
+    AudioCommand command = {};
+    while (   hasRoomForAudioCommand(&platformAudio->audioMixer)
+           && platformPopAudioCommand(platformAudio, &command)  ) {
+        applyAudioCommand(&platformAudio->audioMixer, &command);
+    }
+
+    uint32_t bytesPerFrame     = AUDIO_CHANNELS * gameSound->bytesPerSamplePerChannel;
+    uint32_t audioToQueueBytes = 0;
+    if (gameSound->targetQueuedBytes > gameSound->queuedBytes) {
+        audioToQueueBytes = gameSound->targetQueuedBytes - gameSound->queuedBytes;
+    }
+    audioToQueueBytes = minI32(audioToQueueBytes, sizeof(gameSound->audioToQueue));
+    audioToQueueBytes -= audioToQueueBytes % bytesPerFrame;
+    gameSound->audioToQueueBytes = audioToQueueBytes;
+    mixAudio(&platformAudio->audioMixer, gameSound->audioToQueue,
+             audioToQueueBytes / bytesPerFrame                  );
+
+    platformPassAudioEvents(platformAudio);
+}
+
+uint32_t getAudioLatencyBucket(float ms)
+{
+    return minI32((uint32_t)(ms / (float)AUDIO_LATENCY_BUCKET_MS), AUDIO_LATENCY_BUCKETS - 1);
+}
+
+//NOTE[ALEX]: an empty queue counts as an underrun, the device pulls AUDIO_SAMPLES_PER_CALL at
+//            once and the queue is topped up to a target that is no multiple of it, so the
+//            last pull before the queue ran dry was almost always short and padded with silence
+void platformUpdateAudioLatency(PlatformAudioLatency *latency, GameSound *gameSound)
+{
+    AudioLatencyStats *stats = &latency->stats;
+    uint32_t bytesPerFrame   = AUDIO_CHANNELS * gameSound->bytesPerSamplePerChannel;
+    uint32_t queuedFrames    = gameSound->queuedBytes / bytesPerFrame;
+    uint32_t maxFrames       = sizeof(gameSound->audioToQueue) / bytesPerFrame;
+    uint64_t counter         = SDL_GetPerformanceCounter();
+    uint64_t frequency       = SDL_GetPerformanceFrequency();
+    float    framesPerMs     = (float)AUDIO_SAMPLES_PER_SECOND / 1000.0f;
+
+    if (!latency->lastCounter) { // first top up
+        latency->targetFrames       = gameSound->targetQueuedBytes / bytesPerFrame;
+        latency->windowStartCounter = counter;
+        latency->windowMinFrames    = maxFrames;
+        stats->msIntervalAverage    = (float)AUDIO_THREAD_WAIT_MS;
+        stats->msTargetMin          = (float)latency->targetFrames / framesPerMs;
+    } else {
+        float msInterval = 1000.0f * (float)(counter - latency->lastCounter) / (float)frequency;
+        float delta      = msInterval - stats->msIntervalAverage;
+        stats->msIntervalAverage    += AUDIO_LATENCY_SMOOTHING * delta;
+        latency->msIntervalVariance  = (1.0f - AUDIO_LATENCY_SMOOTHING)
+                                       * (latency->msIntervalVariance
+                                          + AUDIO_LATENCY_SMOOTHING * delta * delta);
+    }
+    latency->lastCounter = counter;
+    stats->msIntervalDeviation = sqrtf(latency->msIntervalVariance);
+    stats->latencyHistogram[getAudioLatencyBucket((float)queuedFrames / framesPerMs)]++;
+
+    if (queuedFrames == 0 && latency->queuedBefore) {
+        stats->underruns++;
+        stats->underrunHistogram[getAudioLatencyBucket(stats->msTarget)]++;
+        latency->windowUnderruns++;
+        if (latency->adaptive) {
+            latency->targetFrames     = (uint32_t)((float)latency->targetFrames
+                                                   * AUDIO_LATENCY_GROWTH      );
+            latency->holdUntilCounter = counter + frequency * AUDIO_LATENCY_HOLD_MS / 1000;
+        }
+    }
+    latency->queuedBefore    = true;
+    latency->windowMinFrames = minI32(latency->windowMinFrames, queuedFrames);
+
+    float msFloor = stats->msIntervalAverage
+                    + AUDIO_LATENCY_JITTER_SIGMAS * stats->msIntervalDeviation;
+    uint32_t floorFrames = AUDIO_SAMPLES_PER_CALL + (uint32_t)(msFloor * framesPerMs);
+    if (counter - latency->windowStartCounter >= frequency * AUDIO_LATENCY_WINDOW_MS / 1000) {
+        if (   latency->adaptive && !latency->windowUnderruns
+            && counter >= latency->holdUntilCounter          ) {
+            // half of the headroom that was never needed, so the next window still has some
+            uint32_t shrinkFrames = minI32(latency->windowMinFrames / 2,
+                                           (uint32_t)(AUDIO_LATENCY_SHRINK_MS * framesPerMs));
+            latency->targetFrames -= minI32(shrinkFrames, latency->targetFrames);
+        }
+        latency->windowStartCounter = counter;
+        latency->windowMinFrames    = maxFrames;
+        latency->windowUnderruns    = 0;
+    }
+    if (latency->adaptive) {
+        latency->targetFrames = minI32(maxI32(latency->targetFrames, floorFrames), maxFrames);
+    }
+
+    gameSound->targetQueuedBytes = latency->targetFrames * bytesPerFrame;
+    stats->msTarget    = (float)latency->targetFrames / framesPerMs;
+    stats->msTargetMin = minF32(stats->msTargetMin, stats->msTarget);
+    stats->msTargetMax = maxF32(stats->msTargetMax, stats->msTarget);
+}
+
+//NOTE[ALEX]: read without synchronization while the audio thread keeps writing, so the values can
+//            be off by the current top up, which is fine for statistics
+void platformGetAudioLatencyStats(PlatformAudio *platformAudio, AudioLatencyStats *stats)
+{
+    *stats = platformAudio->latency.stats;
+}
+
+//NOTE[ALEX]: the device takes AUDIO_SAMPLES_PER_CALL frames out of the queue at once and plays
+//            them until it takes the next ones, so it is half way through the last ones on
+//            average; the measurement jumps by that much and top ups come at uneven times, so the
+//            published position only follows it slowly and snaps to it when it is far off
+//            (after an underrun the device played silence that is not on the timeline)
+void platformUpdateAudioClock(PlatformAudio *platformAudio)
+{
+    GameSound         *gameSound     = platformAudio->gameSound;
+    AudioMixer        *audioMixer    = &platformAudio->audioMixer;
+    AudioLatencyStats *stats         = &platformAudio->latency.stats;
+    AudioClock         clock         = platformAudio->clock; // only written by this thread
+    uint32_t           bytesPerFrame = AUDIO_CHANNELS * gameSound->bytesPerSamplePerChannel;
+    uint64_t           counter       = SDL_GetPerformanceCounter();
+    float              framesPerMs   = (float)AUDIO_SAMPLES_PER_SECOND / 1000.0f;
+
+    uint64_t queuedFrames = gameSound->queuedBytes / bytesPerFrame + AUDIO_SAMPLES_PER_CALL / 2;
+    uint64_t measured     =   audioMixer->mixedFrames
+                            - minU64(queuedFrames, audioMixer->mixedFrames);
+    clock.mixedFrame      = audioMixer->mixedFrames;
+    uint64_t predicted    = getAudioClockFrame(&clock, counter);
+    int64_t  error        = (int64_t)(measured - predicted);
+    int64_t  resyncFrames = (int64_t)(AUDIO_CLOCK_RESYNC_MS * framesPerMs);
+    if (!clock.perfCountFrequency || error > resyncFrames || error < -resyncFrames) {
+        clock.playedFrame = measured;
+    } else {
+        clock.playedFrame = predicted + (int64_t)((float)error * AUDIO_CLOCK_SMOOTHING);
+    }
+    clock.perfCounter        = counter;
+    clock.perfCountFrequency = SDL_GetPerformanceFrequency();
+    // what is queued, plus the wait until a command gets mixed and the error of the position
+    float msTopUp    = stats->msIntervalAverage
+                       + AUDIO_LATENCY_JITTER_SIGMAS * stats->msIntervalDeviation;
+    clock.leadFrames =   gameSound->targetQueuedBytes / bytesPerFrame + AUDIO_SAMPLES_PER_CALL
+                       + (uint32_t)(msTopUp * framesPerMs);
+
+    platformLockSpinLock(&platformAudio->clockLock);
+    platformAudio->clock = clock;
+    platformUnlockSpinLock(&platformAudio->clockLock);
+}
+
+// game thread, the clock as of the last top up
+void platformGetAudioClock(PlatformAudio *platformAudio, AudioClock *audioClock)
+{
+    platformLockSpinLock(&platformAudio->clockLock);
+    *audioClock = platformAudio->clock;
+    platformUnlockSpinLock(&platformAudio->clockLock);
+}
+
+// returns the performance counter the frame should end at, frameEnd if the clock is not running
+uint64_t platformGetAudioPacedFrameEnd(PlatformAudio *platformAudio, PlatformAudioPacing *pacing,
+                                       uint32_t refreshRate, uint64_t frameEnd                   )
+{
+    AudioClock clock = {};
+    platformGetAudioClock(platformAudio, &clock);
+    uint64_t counter = SDL_GetPerformanceCounter();
+    if (   !clock.perfCountFrequency
+        || counter - clock.perfCounter > clock.perfCountFrequency * AUDIO_CLOCK_STALE_MS / 1000) {
+        pacing->nextBoundary = 0; // no device or the audio thread stalled
+        return frameEnd;
+    }
+
+    uint64_t frameFrames = AUDIO_SAMPLES_PER_SECOND; // per frame, times the refresh rate
+    uint64_t now         = getAudioClockFrame(&clock, counter) * refreshRate;
+    if (pacing->nextBoundary) { pacing->nextBoundary += frameFrames; }
+    // starting, a frame took too long or the clock was reset, the grid starts over from now
+    if (   !pacing->nextBoundary || pacing->nextBoundary + frameFrames < now
+        || pacing->nextBoundary > now + 2 * frameFrames                      ) {
+        pacing->nextBoundary = now + frameFrames;
+    }
+    if (pacing->nextBoundary <= now) { return counter; }
+    uint64_t framesLeft = (pacing->nextBoundary - now) / refreshRate;
+    return counter + framesLeft * clock.perfCountFrequency / AUDIO_SAMPLES_PER_SECOND;
+}
+
+void printAudioLatencyStats(AudioLatencyStats *stats, int32_t printHistograms)
+{
+    printf("audio latency: target %.02fms (min %.02fms, max %.02fms), underruns %u, "
+           "top up interval avg %.03fms deviation %.03fms\n",
+           stats->msTarget, stats->msTargetMin, stats->msTargetMax, stats->underruns,
+           stats->msIntervalAverage, stats->msIntervalDeviation                       );
+    if (!printHistograms) { return; }
+    printf("audio latency histogram (ms, queued top ups, underruns at that target):\n");
+    for (uint32_t i = 0; i < AUDIO_LATENCY_BUCKETS; i++) {
+        if (stats->latencyHistogram[i] || stats->underrunHistogram[i]) {
+            printf("  %3u%s %10u %6u\n", i * AUDIO_LATENCY_BUCKET_MS,
+                   i == AUDIO_LATENCY_BUCKETS - 1 ? "+" : " ",
+                   stats->latencyHistogram[i], stats->underrunHistogram[i]);
+        }
+    }
+}
+
+//NOTE[ALEX]: the audio thread tops up the queue of the audio device every few milliseconds,
+//            independent of the frame rate, so the queue only has to cover the wait between
+//            two top ups and hitches of the game thread can not be heard
+int32_t platformAudioThreadProc(void *data)
 {
-    if (platformTexture->textureHandle != 0) {
-        SDL_DestroyTexture(platformTexture->textureHandle); 
+    PlatformAudio *platformAudio = (PlatformAudio *)data;
+    GameSound     *gameSound     = platformAudio->gameSound;
+    if (SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH) != 0) {
+        printf("%s could not raise the thread priority\n", __FUNCTION__);
     }
 
-    if (platformWindow->renderer) {
-        platformTexture->textureHandle = SDL_CreateTexture(platformWindow->renderer,
-                                                           SDL_PIXELFORMAT_ARGB8888,
-                                                           SDL_TEXTUREACCESS_STREAMING,
-                                                           width, height               );
-    } else {
-        printf("%s renderer not initialized\n", __FUNCTION__);
+    while (!platformAtomicGet(&platformAudio->quitRequested)) {
+        gameSound->queuedBytes = SDL_GetQueuedAudioSize(1);
+        platformUpdateAudioLatency(&platformAudio->latency, gameSound);
+        platformMixAudio(platformAudio);
+        platformQueueAudio(gameSound, gameSound->audioToQueue, gameSound->audioToQueueBytes);
+        platformUpdateAudioClock(platformAudio);
+        platformWait(AUDIO_THREAD_WAIT_MS);
     }
+
+    return 0;
 }
 
-void platformOpenSoundDevice(uint32_t targetAudioFrameLatency, uint32_t targetRefreshRate,
-                             GameSound *gameSound                                         )
+void platformStartAudioThread(MemoryArena *arena, PlatformAudio *platformAudio)
 {
-    xbAssert(targetAudioFrameLatency > 0);
-
-    SDL_AudioSpec sdlAudioSettings = {};
-    sdlAudioSettings.freq     = AUDIO_SAMPLES_PER_SECOND;
-    sdlAudioSettings.format   = AUDIO_S16LSB; // signed 16bit little endian for each sample
-    sdlAudioSettings.channels = AUDIO_CHANNELS;
-    sdlAudioSettings.samples  = AUDIO_SAMPLES_PER_CALL; // buffer size per channel,
-                                                        // this will be passed per call,
-                                                        // so this is the minimum audio latency
-    sdlAudioSettings.callback = 0; // if left empty, SDL_QueueAudio can be used
-    
-    SDL_OpenAudio(&sdlAudioSettings, 0); //NOTE[ALEX]: passing 0 to the output will make this
-                                         //            modify the passed input instead
+    platformAtomicSet(&platformAudio->quitRequested, 0);
+    platformAudio->thread = platformCreateThread(arena, platformAudioThreadProc,
+                                                 (char *)"xbAudio", platformAudio, 0);
+}
 
-    if (sdlAudioSettings.format != AUDIO_S16LSB) {
-        printf("%s format is not what was requested, but %u.\n",
-               __FUNCTION__, sdlAudioSettings.format            );
+void platformStopAudioThread(PlatformAudio *platformAudio)
+{
+    if (platformAudio->thread) {
+        platformAtomicSet(&platformAudio->quitRequested, 1);
+        platformCleanupThread(platformAudio->thread);
+        platformAudio->thread = 0;
     }
-    gameSound->bytesPerSamplePerChannel = sizeof(int16_t);
-    float targetTimePerFrame = 1.0f/(float)targetRefreshRate;
-    float targetLatency      = targetTimePerFrame * (float)targetAudioFrameLatency;
-    gameSound->targetQueuedBytes = roundF32toU32
-        (targetLatency * (float)(AUDIO_SAMPLES_PER_SECOND*gameSound->bytesPerSamplePerChannel));
-
-    // printf("%s targetLatency: %.04f, targetAudioFrameLatency: %u, targetTimePerFrame: %.04f, targetQueuedBytes: %u\n",
-    //        __FUNCTION__, targetLatency, targetAudioFrameLatency,
-    //        targetTimePerFrame, gameSound->targetQueuedBytes     );
-
-    SDL_PauseAudio(0); // 0 for unpause, 1 for pause
 }
 
 void platformCloseSoundDevice()
@@ -516,6 +2205,156 @@ void platformQueueAudio(GameSound *gameSound, int16_t *audioToQueue, uint32_t au
     // printf("%s, %u\n", __FUNCTION__, gameSound->queuedBytes);
 }
 
+//NOTE[ALEX]: the mapping is private and read-only, so the pages are shared with the page cache
+//            and never copied; the file descriptor is not needed once the file is mapped;
+//            without mmap the whole file gets read into arena instead
+int32_t platformMapFile(const char *fileName, MemoryArena *arena, PlatformMappedFile *mappedFile)
+{
+    *mappedFile = {};
+#ifdef __linux__
+    int fileDescriptor = open(fileName, O_RDONLY | O_CLOEXEC);
+    if (fileDescriptor < 0) {
+        printf("%s could not open %s\n", __FUNCTION__, fileName);
+        return 0;
+    }
+
+    struct stat fileStatus = {};
+    void *memory = MAP_FAILED;
+    if (fstat(fileDescriptor, &fileStatus) == 0 && fileStatus.st_size > 0) {
+        memory = mmap(0, (uint64_t)fileStatus.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    }
+    close(fileDescriptor);
+    if (memory == MAP_FAILED) {
+        printf("%s could not map %s\n", __FUNCTION__, fileName);
+        return 0;
+    }
+
+    mappedFile->memory = memory;
+    mappedFile->size   = (uint64_t)fileStatus.st_size;
+    return 1;
+#else
+    SDL_RWops *file = SDL_RWFromFile(fileName, "rb");
+    if (!file) {
+        printf("%s could not open %s\n", __FUNCTION__, fileName);
+        return 0;
+    }
+
+    int64_t fileSize = SDL_RWsize(file);
+    void   *memory   = 0;
+    //NOTE[ALEX]: aligned like the rows of a GameBuffer, so asset pixels can be used in place
+    if (   fileSize > 0
+        && (uint64_t)fileSize <= getArenaSizeRemaining(arena, GAMEBUFFER_PITCH_ALIGNMENT)) {
+        memory = pushSize(arena, (uint64_t)fileSize, GAMEBUFFER_PITCH_ALIGNMENT);
+        if (SDL_RWread(file, memory, (size_t)fileSize, 1) != 1) {
+            popSize(arena, (uint64_t)fileSize);
+            memory = 0;
+        }
+    }
+    SDL_RWclose(file);
+    if (!memory) {
+        printf("%s could not read %s\n", __FUNCTION__, fileName);
+        return 0;
+    }
+
+    mappedFile->memory = memory;
+    mappedFile->size   = (uint64_t)fileSize;
+    return 1;
+#endif
+}
+
+// the memory of a file that was read instead of mapped goes away with its arena
+void platformUnmapFile(PlatformMappedFile *mappedFile)
+{
+#ifdef __linux__
+    if (mappedFile->memory) {
+        munmap(mappedFile->memory, mappedFile->size);
+    }
+#endif
+    *mappedFile = {};
+}
+
+int32_t platformOpenFile(const char *fileName, PlatformFile *file)
+{
+    *file = {};
+#ifdef __linux__
+    int fileDescriptor = open(fileName, O_RDONLY | O_CLOEXEC);
+    if (fileDescriptor < 0) {
+        printf("%s could not open %s\n", __FUNCTION__, fileName);
+        return 0;
+    }
+    struct stat fileStatus = {};
+    if (fstat(fileDescriptor, &fileStatus) != 0) {
+        printf("%s could not stat %s\n", __FUNCTION__, fileName);
+        close(fileDescriptor);
+        return 0;
+    }
+    file->size   = (uint64_t)fileStatus.st_size;
+    file->handle = fileDescriptor;
+    file->isOpen = 1;
+    return 1;
+#else
+    SDL_RWops *stream = SDL_RWFromFile(fileName, "rb");
+    if (!stream) {
+        printf("%s could not open %s\n", __FUNCTION__, fileName);
+        return 0;
+    }
+    int64_t    fileSize   = SDL_RWsize(stream);
+    SDL_mutex *streamLock = fileSize >= 0 ? SDL_CreateMutex() : 0;
+    if (!streamLock) {
+        printf("%s could not get the size of %s\n", __FUNCTION__, fileName);
+        SDL_RWclose(stream);
+        return 0;
+    }
+    file->size       = (uint64_t)fileSize;
+    file->stream     = stream;
+    file->streamLock = streamLock;
+    file->isOpen     = 1;
+    return 1;
+#endif
+}
+
+//NOTE[ALEX]: pread does not move the file position, so threads can read the same file at once;
+//            without it the seek and the read of a thread have to happen under the file's lock
+uint32_t platformReadFile(PlatformFile *file, uint64_t offset, void *memory, uint32_t size)
+{
+    uint32_t bytesRead = 0;
+#ifdef __linux__
+    while (bytesRead < size) {
+        ssize_t result = pread(file->handle, (uint8_t *)memory + bytesRead, size - bytesRead,
+                               (off_t)(offset + bytesRead)                                   );
+        if (result < 0 && errno == EINTR) { continue; }
+        if (result <= 0) { break; } // end of the file or an error
+        bytesRead += (uint32_t)result;
+    }
+#else
+    SDL_RWops *stream = (SDL_RWops *)file->stream;
+    SDL_LockMutex((SDL_mutex *)file->streamLock);
+    if (SDL_RWseek(stream, (int64_t)offset, RW_SEEK_SET) == (int64_t)offset) {
+        while (bytesRead < size) {
+            size_t result = SDL_RWread(stream, (uint8_t *)memory + bytesRead, 1,
+                                       size - bytesRead                         );
+            if (result == 0) { break; } // end of the file or an error
+            bytesRead += (uint32_t)result;
+        }
+    }
+    SDL_UnlockMutex((SDL_mutex *)file->streamLock);
+#endif
+    return bytesRead;
+}
+
+void platformCloseFile(PlatformFile *file)
+{
+    if (file->isOpen) {
+#ifdef __linux__
+        close(file->handle);
+#else
+        SDL_RWclose((SDL_RWops *)file->stream);
+        SDL_DestroyMutex((SDL_mutex *)file->streamLock);
+#endif
+    }
+    *file = {};
+}
+
 FileReadResultDEBUG platformReadEntireFileDEBUG(char *fileName)
 {
     FileReadResultDEBUG fileReadResult = {};
@@ -1003,12 +2842,11 @@ void SDL2ControllerAxisMotion(SDL_Event cAxisEvent, GameInput *gameInput,
     }
 }
 
-void platformInitializeControllers(GameInput *gameInput)
+void platformInitializeControllers(MemoryArena *arena, GameInput *gameInput)
 {
     for (uint32_t i = 0; i < MAX_CONTROLLERS; i++) {
         if (!gameInput->platformController[i]) {
-            PlatformController *platformController =
-                (PlatformController *)malloc(sizeof(PlatformController));
+            PlatformController *platformController = pushStruct(arena, PlatformController);
             platformController->controllerHandle = 0;
             platformController->sdlID = -1;
             gameInput->platformController[i] = platformController;
@@ -1028,9 +2866,9 @@ void platformCloseControllers(GameInput *gameInput)
                 SDL_GameControllerClose(platformController->controllerHandle);
                 printf("Closed Game Controller %u.\n", i);
             }
-            free(gameInput->platformController[i]);
+            gameInput->platformController[i] = 0;
         } else {
-            printf("%s platformControllers[%u] nothing to free.\n", __FUNCTION__, i);
+            printf("%s platformControllers[%u] nothing to close.\n", __FUNCTION__, i);
         }
     }
 }
@@ -1098,11 +2936,14 @@ void platformHandleEvents(GameBuffer *gameBuffer, GameInput *gameInput, GameGlob
                     } break;
                     case SDL_WINDOWEVENT_RESTORED: {
                         gameGlobal->stopRendering = false;
+                        gameBuffer->windowDamaged = true;
                     } break;
                     case SDL_WINDOWEVENT_RESIZED: {
                         platformUpdateBackBuffer(gameBuffer);
+                        gameBuffer->windowDamaged = true;
                     } break;
                     case SDL_WINDOWEVENT_EXPOSED: {
+                        gameBuffer->windowDamaged = true;
                     } break;
                 }
             } break;
@@ -1173,28 +3014,549 @@ void platformHandleEvents(GameBuffer *gameBuffer, GameInput *gameInput, GameGlob
     }
 }
 
-void platformUpdateWindow(PlatformWindow *platformWindow, PlatformTexture *platformTexture,
-                          int width, uint32_t bytesPerPixel, void *textureMemory           )
+void platformPresentTexture(PlatformWindow *platformWindow, PlatformTexture *platformTexture)
 {
-    SDL_UpdateTexture(platformTexture->textureHandle, 0, textureMemory, width * bytesPerPixel);
     SDL_RenderCopy(platformWindow->renderer, platformTexture->textureHandle, 0, 0);
     SDL_RenderPresent(platformWindow->renderer);
 }
 
+void platformUpdateWindow(PlatformWindow *platformWindow, PlatformTexture *platformTexture,
+                          uint32_t pitch, void *textureMemory                              )
+{
+    SDL_UpdateTexture(platformTexture->textureHandle, 0, textureMemory, pitch);
+    platformPresentTexture(platformWindow, platformTexture);
+}
+
+// uploads only the given regions of textureMemory, returns the bytes copied
+uint64_t platformUpdateTextureRects(PlatformTexture *platformTexture, uint32_t pitch,
+                                    void *textureMemory, GameRect *rects, uint32_t rectCount)
+{
+    uint64_t bytesCopied = 0;
+    for (uint32_t i = 0; i < rectCount; i++) {
+        GameRect *rect = &rects[i];
+        SDL_Rect  sdlRect = { rect->startX, rect->startY,
+                              rect->endX - rect->startX, rect->endY - rect->startY };
+        uint8_t  *pixels  = (uint8_t *)textureMemory + rect->startY * pitch
+                          + rect->startX * GAMEBUFFER_BYTES_PER_PIXEL;
+        SDL_UpdateTexture(platformTexture->textureHandle, &sdlRect, pixels, pitch);
+        bytesCopied += (uint64_t)sdlRect.w * GAMEBUFFER_BYTES_PER_PIXEL * sdlRect.h;
+    }
+    return bytesCopied;
+}
+
+//NOTE[ALEX]: SDL only guarantees that locked memory can be written, it does not necessarily
+//            hold the previous contents of the texture
+int32_t platformLockTexture(PlatformTexture *platformTexture, void **memory, uint32_t *pitch)
+{
+    int lockedPitch = 0;
+    if (   !platformTexture->textureHandle
+        || SDL_LockTexture(platformTexture->textureHandle, 0, memory, &lockedPitch) != 0) {
+        *memory = 0;
+        return 0;
+    }
+    *pitch = (uint32_t)lockedPitch;
+    return 1;
+}
+
+//NOTE[ALEX]: in lock mode every buffer has a texture of its own that stays locked while the
+//            buffer is free, so the game renders straight into texture memory and the
+//            full frame copy of SDL_UpdateTexture goes away; a buffer falls back to the copy
+//            path (rendering into textureMemory) while its texture does not match the window
+enum PresentUpload {
+    PRESENT_UPLOAD_NONE,  // rendered into the locked texture
+    PRESENT_UPLOAD_FULL,  // the texture gets recreated at the size of the buffer
+    PRESENT_UPLOAD_RECTS, // only the dirty regions
+};
+
+struct PlatformPresentBuffer {
+    MemoryArena      textureArena; // only holds textureMemory
+    void            *textureMemory;
+    int              width;
+    int              height;
+    uint32_t         pitch;
+    uint64_t         submitCounter;
+    PlatformTexture  platformTexture;
+    void            *lockedMemory; // set by the main thread while the texture is locked
+    uint32_t         lockedPitch;
+    int32_t          renderedIntoLockedMemory;
+    //NOTE[ALEX]: with the copy path the texture always holds the same pixels as textureMemory,
+    //            so the renderer can skip tiles that did not change and only the dirty regions
+    //            are uploaded; locked texture memory is not guaranteed to keep its contents
+    uint64_t        *tileHashes;    // RENDER_TILE_COUNT_MAX entries
+    int32_t          contentsValid; // textureMemory holds what the tile hashes describe
+    GameRect         dirtyRects[DIRTY_RECTS_MAX];
+    uint32_t         dirtyRectCount;
+    int32_t          frameChanged;
+    // decided when the buffer is submitted
+    PresentUpload    upload;
+    int32_t          present;        // the window shows something else afterwards
+    GameRect         uploadRects[DIRTY_RECTS_MAX]; // dirty rects clipped to the texture
+    uint32_t         uploadRectCount;
+    uint64_t         uploadBytes;
+};
+
+//NOTE[ALEX]: SDL only renders on the thread that created the window, so uploading and
+//            presenting cannot overlap with the next frame on another thread; a submitted
+//            buffer is uploaded and presented right away by the main thread and the game moves
+//            on to the next buffer of the ring, whose texture stays locked in lock mode
+struct PlatformPresenter {
+    PlatformWindow        *platformWindow;
+    uint32_t               bufferCount;
+    int32_t                lockTextures;
+    PlatformPresentBuffer  buffers[PRESENT_BUFFERS_MAX];
+    uint32_t               nextBufferToRender;
+    int32_t                framesPresented;    // uploaded and presented (or found unchanged)
+    uint64_t               presentCounterLast; // upload and present of the last frame
+    uint64_t               latencyCounterLast; // from submitting the last frame until presented
+    uint64_t               bytesCopiedLast;    // by the copy path for the last frame
+    uint64_t               statsCounter;
+    int32_t                statsFramesPresented;
+};
+
+void platformUnlockPresentBuffer(PlatformPresentBuffer *buffer)
+{
+    if (buffer->lockedMemory) {
+        SDL_UnlockTexture(buffer->platformTexture.textureHandle);
+        buffer->lockedMemory = 0;
+    }
+}
+
+// decides what has to be uploaded, the dirty rects are clipped to the buffer
+void platformPrepareUpload(PlatformPresentBuffer *buffer)
+{
+    PlatformTexture *platformTexture = &buffer->platformTexture;
+    buffer->uploadRectCount = 0;
+    buffer->uploadBytes     = 0;
+    if (buffer->renderedIntoLockedMemory) {
+        buffer->upload  = PRESENT_UPLOAD_NONE;
+        buffer->present = buffer->frameChanged;
+    } else if (   platformTexture->width  != buffer->width
+               || platformTexture->height != buffer->height) {
+        buffer->upload      = PRESENT_UPLOAD_FULL;
+        buffer->present     = true;
+        buffer->uploadBytes = (uint64_t)buffer->pitch * buffer->height;
+    } else {
+        buffer->upload  = PRESENT_UPLOAD_RECTS;
+        buffer->present = buffer->frameChanged;
+        for (uint32_t i = 0; i < buffer->dirtyRectCount; i++) {
+            GameRect rect = buffer->dirtyRects[i];
+            rect.startX = maxI32(rect.startX, 0);
+            rect.startY = maxI32(rect.startY, 0);
+            rect.endX   = minI32(rect.endX, buffer->width);
+            rect.endY   = minI32(rect.endY, buffer->height);
+            if (rect.startX >= rect.endX || rect.startY >= rect.endY) { continue; }
+            buffer->uploadRects[buffer->uploadRectCount++] = rect;
+            buffer->uploadBytes += (uint64_t)(rect.endX - rect.startX)
+                                   * GAMEBUFFER_BYTES_PER_PIXEL * (rect.endY - rect.startY);
+        }
+    }
+}
+
+void platformUploadAndPresent(PlatformPresenter *presenter, PlatformPresentBuffer *buffer)
+{
+    PlatformWindow  *platformWindow  = presenter->platformWindow;
+    PlatformTexture *platformTexture = &buffer->platformTexture;
+
+    uint64_t startCounter = SDL_GetPerformanceCounter();
+    platformUnlockPresentBuffer(buffer);
+    if (buffer->upload == PRESENT_UPLOAD_FULL) {
+        platformResizeTexture(platformWindow, platformTexture,
+                              buffer->width, buffer->height   );
+        SDL_UpdateTexture(platformTexture->textureHandle, 0, buffer->textureMemory,
+                          buffer->pitch                                            );
+    } else if (buffer->upload == PRESENT_UPLOAD_RECTS) {
+        platformUpdateTextureRects(platformTexture, buffer->pitch, buffer->textureMemory,
+                                   buffer->uploadRects, buffer->uploadRectCount          );
+    }
+    if (buffer->present) {
+        platformPresentTexture(platformWindow, platformTexture);
+    }
+    uint64_t endCounter = SDL_GetPerformanceCounter();
+
+    if (presenter->lockTextures) {
+        if (!platformLockTexture(platformTexture, &buffer->lockedMemory,
+                                 &buffer->lockedPitch                   )) {
+            printf("%s SDL_LockTexture failed, falling back to copying\n", __FUNCTION__);
+            presenter->lockTextures = 0;
+        }
+    }
+
+    presenter->presentCounterLast = endCounter - startCounter;
+    presenter->latencyCounterLast = endCounter - buffer->submitCounter;
+    presenter->bytesCopiedLast    = buffer->uploadBytes;
+    presenter->framesPresented++;
+}
+
+// the buffers are carved out of textureMemory, the presenter itself out of arena
+PlatformPresenter *platformCreatePresenter(MemoryArena *arena, MemoryArena *textureMemory,
+                                           PlatformWindow *platformWindow, uint32_t bufferCount,
+                                           int32_t lockTextures                                 )
+{
+    PlatformPresenter *presenter = pushStruct(arena, PlatformPresenter, CACHE_LINE_SIZE);
+    memset(presenter, 0, sizeof(PlatformPresenter));
+    presenter->platformWindow = platformWindow;
+    presenter->bufferCount    = bufferCount;
+    presenter->lockTextures   = lockTextures;
+    for (uint32_t i = 0; i < bufferCount; i++) {
+        subArena(&presenter->buffers[i].textureArena, textureMemory, GAMEBUFFER_ARENA_SIZE,
+                 GAMEBUFFER_PITCH_ALIGNMENT                                                );
+        presenter->buffers[i].tileHashes = pushArray(arena, RENDER_TILE_COUNT_MAX, uint64_t);
+    }
+    presenter->statsCounter = SDL_GetPerformanceCounter();
+    platformCreateRenderer(platformWindow);
+
+    return presenter;
+}
+
+void platformDestroyPresenter(PlatformPresenter *presenter)
+{
+    for (uint32_t i = 0; i < presenter->bufferCount; i++) {
+        PlatformPresentBuffer *buffer = &presenter->buffers[i];
+        platformUnlockPresentBuffer(buffer);
+        if (buffer->platformTexture.textureHandle) {
+            SDL_DestroyTexture(buffer->platformTexture.textureHandle);
+        }
+    }
+    platformDestroyRenderer(presenter->platformWindow);
+}
+
+// points the GameBuffer at the next buffer of the ring, either at the locked
+// texture memory or, if the texture does not match the window size (yet), at textureMemory
+// which gets resized here if the window size changed since the buffer was last used
+void platformAcquireBackBuffer(PlatformPresenter *presenter, GameBuffer *gameBuffer,
+                               GameClocks *gameClocks                                )
+{
+    uint64_t startCounter = SDL_GetPerformanceCounter();
+    gameClocks->msWaitForBackBuffer = 1000.0f * platformGetSecondsElapsed(startCounter,
+                                                    SDL_GetPerformanceCounter(),
+                                                    gameClocks->perfCountFrequency     );
+
+    PlatformPresentBuffer *buffer = &presenter->buffers[presenter->nextBufferToRender];
+    gameBuffer->tileHashes    = buffer->tileHashes;
+    gameBuffer->tileHashCount = RENDER_TILE_COUNT_MAX;
+    if (   buffer->lockedMemory
+        && buffer->platformTexture.width  == gameBuffer->width
+        && buffer->platformTexture.height == gameBuffer->height) {
+        buffer->renderedIntoLockedMemory = 1;
+        buffer->contentsValid     = 0;
+        gameBuffer->keepsContents = 0;
+        gameBuffer->textureMemory = buffer->lockedMemory;
+        gameBuffer->pitch         = buffer->lockedPitch;
+        return;
+    }
+
+    buffer->renderedIntoLockedMemory = 0;
+    gameBuffer->pitch = alignPow2U32(gameBuffer->bytesPerPixel * gameBuffer->width,
+                                     GAMEBUFFER_PITCH_ALIGNMENT                    );
+    if (   buffer->width  != gameBuffer->width || buffer->height != gameBuffer->height
+        || buffer->pitch  != gameBuffer->pitch || !buffer->textureMemory              ) {
+        MemoryArena *textureArena = &buffer->textureArena;
+        uint64_t previousSize = textureArena->used;
+        resetArena(textureArena);
+        buffer->textureMemory = pushSize(textureArena,
+                                         (uint64_t)gameBuffer->pitch * gameBuffer->height,
+                                         GAMEBUFFER_PITCH_ALIGNMENT                      );
+        //NOTE[ALEX]: memory that is not needed anymore after shrinking is given back to the os
+        if (textureArena->used < previousSize) {
+            platformDecommitMemory(textureArena->base + textureArena->used,
+                                   previousSize - textureArena->used       );
+        }
+        buffer->width         = gameBuffer->width;
+        buffer->height        = gameBuffer->height;
+        buffer->pitch         = gameBuffer->pitch;
+        buffer->contentsValid = 0;
+    }
+    gameBuffer->keepsContents = buffer->contentsValid;
+    gameBuffer->textureMemory = buffer->textureMemory;
+    buffer->contentsValid     = 1;
+}
+
+// uploads the regions of the buffer the GameBuffer points at that the renderer changed and
+// presents it, the next frame goes into the next buffer of the ring
+void platformSubmitBackBuffer(PlatformPresenter *presenter, GameBuffer *gameBuffer)
+{
+    PlatformPresentBuffer *buffer = &presenter->buffers[presenter->nextBufferToRender];
+    buffer->dirtyRectCount = gameBuffer->dirtyRectCount;
+    for (uint32_t i = 0; i < gameBuffer->dirtyRectCount; i++) {
+        buffer->dirtyRects[i] = gameBuffer->dirtyRects[i];
+    }
+    buffer->frameChanged  = gameBuffer->frameChanged;
+    buffer->submitCounter = SDL_GetPerformanceCounter();
+    presenter->nextBufferToRender = (presenter->nextBufferToRender + 1) % presenter->bufferCount;
+    platformPrepareUpload(buffer);
+    platformUploadAndPresent(presenter, buffer);
+}
+
+void platformGetPresentClocks(PlatformPresenter *presenter, GameClocks *gameClocks)
+{
+    float msPerCounter = 1000.0f / (float)gameClocks->perfCountFrequency;
+    gameClocks->msPresentLastFrame = msPerCounter * (float)presenter->presentCounterLast;
+    gameClocks->msSubmitToPresent  = msPerCounter * (float)presenter->latencyCounterLast;
+    gameClocks->mbCopiedLastFrame  = (float)presenter->bytesCopiedLast / (float)Megabytes(1);
+
+    uint64_t counter = SDL_GetPerformanceCounter();
+    float secondsElapsed = platformGetSecondsElapsed(presenter->statsCounter, counter,
+                                                     gameClocks->perfCountFrequency   );
+    if (secondsElapsed >= 1.0f) {
+        gameClocks->presentedFramesPerSecond =
+            (float)(presenter->framesPresented - presenter->statsFramesPresented) / secondsElapsed;
+        presenter->statsFramesPresented = presenter->framesPresented;
+        presenter->statsCounter         = counter;
+    }
+}
+
+void printArenaUsage(char *arenaName, MemoryArena *arena)
+{
+    printf("%s: %lu / %lu bytes used, high water mark %lu (%.04f%%)\n",
+           arenaName, arena->used, arena->size, arena->highWaterMark,
+           100.0f*((float)arena->highWaterMark/(float)arena->size)  );
+}
+
+//NOTE[ALEX]: headless runs (--headless / XB_HEADLESS) have no window, no audio device and no
+//            presenter, they render --frames N (XB_FRAMES) frames at --width W and --height H
+//            (XB_WIDTH, XB_HEIGHT) as fast as possible with scripted input and report the frame
+//            rate and the time every stage of a frame took; --dump-frames DIR (XB_DUMP_FRAMES)
+//            writes every --dump-every N-th frame (XB_DUMP_EVERY) to DIR as a PPM file or as
+//            raw BGRA pixels with --dump-raw (XB_DUMP_RAW), to compare against golden images
+enum PlatformHeadlessStage {
+    HEADLESS_STAGE_INPUT,
+    HEADLESS_STAGE_UPDATE, // game update including rendering
+    HEADLESS_STAGE_AUDIO,
+    HEADLESS_STAGE_DUMP,
+    HEADLESS_STAGE_COUNT
+};
+
+struct PlatformStageTiming {
+    float msTotal;
+    float msMin;
+    float msMax;
+};
+
+//NOTE[ALEX]: the buffers are used in turn like the present ring, so the renderer skips the
+//            same unchanged tiles as it would in a window
+struct PlatformHeadlessBuffer {
+    void     *textureMemory;
+    uint64_t *tileHashes;
+    int32_t   contentsValid;
+};
+
+// adds the time since *counter to the stage and moves *counter to now
+void platformRecordStage(PlatformStageTiming *timing, uint64_t *counter,
+                         uint64_t perfCountFrequency                    )
+{
+    uint64_t now = platformGetPerformanceCounter();
+    float    ms  = 1000.0f * platformGetSecondsElapsed(*counter, now, perfCountFrequency);
+    timing->msTotal += ms;
+    timing->msMin    = minF32(timing->msMin, ms);
+    timing->msMax    = maxF32(timing->msMax, ms);
+    *counter = now;
+}
+
+// 0 up to range - 1 and back down again as value grows
+int32_t platformPingPong(uint64_t value, int32_t range)
+{
+    if (range <= 1) { return 0; }
+    int32_t position = (int32_t)(value % (uint64_t)(2*(range - 1)));
+    return position < range ? position : 2*(range - 1) - position;
+}
+
+// input that only depends on the frame, so dumped frames are the same on every run
+void platformScriptInput(GameInput *gameInput, uint64_t frame, int32_t width, int32_t height)
+{
+    // the mouse bounces between the edges with a different speed on each axis
+    gameInput->mousePosX = platformPingPong(frame * 7, width);
+    gameInput->mousePosY = platformPingPong(frame * 5, height);
+
+    // the keys are held down for 15 frames each in turn, except escape, which quits
+    uint32_t keyCount = sizeof(gameInput->keys)/sizeof(gameInput->keys[0]);
+    uint32_t keyDown  = 1 + (uint32_t)((frame / 15) % (keyCount - 1));
+    for (uint32_t i = 1; i < keyCount; i++) {
+        if (i == keyDown) {
+            buttonStateUpdateDown(&gameInput->keys[i]);
+        } else if (gameInput->keys[i].isDown) {
+            buttonStateUpdateUp(&gameInput->keys[i]);
+        }
+    }
+}
+
+// the audio gets mixed on the main thread, the null audio sink plays one frame worth every frame
+void platformQueueNullAudio(PlatformAudio *platformAudio, uint32_t refreshRate)
+{
+    GameSound *gameSound = platformAudio->gameSound;
+    platformMixAudio(platformAudio);
+    uint32_t bytesPerFrame =   AUDIO_SAMPLES_PER_SECOND / refreshRate
+                             * AUDIO_CHANNELS * gameSound->bytesPerSamplePerChannel;
+    uint32_t queuedBytes = gameSound->queuedBytes + gameSound->audioToQueueBytes;
+    gameSound->queuedBytes = queuedBytes > bytesPerFrame ? queuedBytes - bytesPerFrame : 0;
+    platformUpdateAudioClock(platformAudio);
+}
+
+// PPM files only keep the color channels, raw files hold the BGRA bytes of every row (no padding),
+// fileMemory has to hold a header and 4 bytes per pixel
+int32_t platformDumpFrame(GameBuffer *gameBuffer, const char *directory, uint64_t frame,
+                          int32_t raw, uint8_t *fileMemory                              )
+{
+    char fileName[1024];
+    uint8_t *out = fileMemory;
+    if (raw) {
+        snprintf(fileName, sizeof(fileName), "%s/frame_%06lu_%ix%i.bgra", directory, frame,
+                 gameBuffer->width, gameBuffer->height                                     );
+    } else {
+        snprintf(fileName, sizeof(fileName), "%s/frame_%06lu.ppm", directory, frame);
+        out += sprintf((char *)out, "P6\n%i %i\n255\n", gameBuffer->width, gameBuffer->height);
+    }
+
+    uint8_t *row = (uint8_t *)gameBuffer->textureMemory;
+    for (int32_t y = 0; y < gameBuffer->height; y++) {
+        if (raw) {
+            memcpy(out, row, gameBuffer->width * sizeof(uint32_t));
+            out += gameBuffer->width * sizeof(uint32_t);
+        } else {
+            uint32_t *pixel = (uint32_t *)row;
+            for (int32_t x = 0; x < gameBuffer->width; x++) {
+                *out++ = (uint8_t)(pixel[x] >> 16);
+                *out++ = (uint8_t)(pixel[x] >>  8);
+                *out++ = (uint8_t)(pixel[x]      );
+            }
+        }
+        row += gameBuffer->pitch;
+    }
+
+    int32_t result = 0;
+    SDL_RWops *file = SDL_RWFromFile(fileName, "wb");
+    if (file) {
+        result = SDL_RWwrite(file, fileMemory, out - fileMemory, 1) == 1;
+        SDL_RWclose(file);
+    }
+    if (!result) {
+        printf("%s could not write %s\n", __FUNCTION__, fileName);
+    }
+    return result;
+}
+
+void platformRunHeadless(int argc, char **argv, GameState *gameState, GameTest *gameTest,
+                         uint32_t targetAudioFrameLatency                                )
+{
+    GameMemory  *gameMemory     = gameState->gameMemory;
+    GameGlobal  *gameGlobal     = &gameState->gameGlobal;
+    GameInput   *gameInput      = &gameState->gameInput;
+    GameClocks  *gameClocks     = &gameState->gameClocks;
+    GameBuffer  *gameBuffer     = &gameState->gameBuffer;
+    GameSound   *gameSound      = &gameState->gameSound;
+    WorkQueues  *workQueues     = &gameState->workQueues;
+    MemoryArena *transientArena = &gameMemory->transientArena;
+
+    uint32_t frameCount = maxI32(platformGetOptionValue(argc, argv, "--frames", "XB_FRAMES",
+                                                        HEADLESS_FRAMES_DEFAULT             ), 1);
+    int32_t  width      = platformGetOptionValue(argc, argv, "--width", "XB_WIDTH",
+                                                 WINDOW_INIT_WIDTH                 );
+    int32_t  height     = platformGetOptionValue(argc, argv, "--height", "XB_HEIGHT",
+                                                 WINDOW_INIT_HEIGHT                 );
+    uint32_t bufferCount = platformGetOptionValue(argc, argv, "--present-buffers",
+                                                  "XB_PRESENT_BUFFERS", PRESENT_BUFFERS_DEFAULT);
+    bufferCount = minI32(maxI32(bufferCount, 1), PRESENT_BUFFERS_MAX);
+    const char *dumpDirectory = platformGetOptionString(argc, argv, "--dump-frames",
+                                                        "XB_DUMP_FRAMES", 0         );
+    uint32_t dumpEvery = maxI32(platformGetOptionValue(argc, argv, "--dump-every",
+                                                       "XB_DUMP_EVERY", 1        ), 1);
+    int32_t  dumpRaw   = platformHasOption(argc, argv, "--dump-raw", "XB_DUMP_RAW");
+
+    gameGlobal->renderingRefreshRate = HEADLESS_REFRESH_RATE;
+    gameGlobal->targetTimePerFrame   = 1000.0f / (float)(gameGlobal->renderingRefreshRate);
+    platformInitClocks(gameClocks);
+    platformSetAudioLatency(targetAudioFrameLatency, AUDIO_REFRESH_RATE, gameSound);
+
+    gameBuffer->platformWindow = 0;
+    gameBuffer->bytesPerPixel  = GAMEBUFFER_BYTES_PER_PIXEL;
+    gameBuffer->width          = minI32(maxI32(width,  1), WINDOW_MAX_WIDTH);
+    gameBuffer->height         = minI32(maxI32(height, 1), WINDOW_MAX_HEIGHT);
+    gameBuffer->pitch          = alignPow2U32(gameBuffer->bytesPerPixel * gameBuffer->width,
+                                              GAMEBUFFER_PITCH_ALIGNMENT                    );
+    PlatformHeadlessBuffer buffers[PRESENT_BUFFERS_MAX] = {};
+    for (uint32_t i = 0; i < bufferCount; i++) {
+        buffers[i].textureMemory = pushSize(transientArena,
+                                            (uint64_t)gameBuffer->pitch * gameBuffer->height,
+                                            GAMEBUFFER_PITCH_ALIGNMENT                      );
+        buffers[i].tileHashes    = pushArray(transientArena, RENDER_TILE_COUNT_MAX, uint64_t);
+    }
+    uint8_t *dumpMemory = 0;
+    if (dumpDirectory) {
+        dumpMemory = (uint8_t *)pushSize(transientArena,
+                                         64 + (uint64_t)gameBuffer->width * gameBuffer->height
+                                            * sizeof(uint32_t)                                );
+    }
+    printf("%s %u frames at %ix%i, %u buffers, dumping %s\n", __FUNCTION__, frameCount,
+           gameBuffer->width, gameBuffer->height, bufferCount,
+           dumpDirectory ? dumpDirectory : "nothing"                                   );
+
+    PlatformStageTiming stageTimings[HEADLESS_STAGE_COUNT] = {};
+    for (uint32_t i = 0; i < HEADLESS_STAGE_COUNT; i++) {
+        stageTimings[i].msMin = 1000000.0f;
+    }
+    uint64_t startCounter = platformGetPerformanceCounter();
+    uint32_t frame = 0;
+    while (frame < frameCount && !gameGlobal->quitGame) {
+        uint64_t counter = platformGetPerformanceCounter();
+        resetArena(&gameMemory->frameArena);
+        resetArena(&workQueues->scratchArenas[0].arena);
+        platformScriptInput(gameInput, frame, gameBuffer->width, gameBuffer->height);
+        platformRecordStage(&stageTimings[HEADLESS_STAGE_INPUT], &counter,
+                            gameClocks->perfCountFrequency                );
+
+        PlatformHeadlessBuffer *buffer = &buffers[frame % bufferCount];
+        gameBuffer->textureMemory = buffer->textureMemory;
+        gameBuffer->tileHashes    = buffer->tileHashes;
+        gameBuffer->tileHashCount = RENDER_TILE_COUNT_MAX;
+        gameBuffer->keepsContents = buffer->contentsValid;
+        buffer->contentsValid     = 1;
+        gameUpdate(gameState, gameTest);
+        platformRecordStage(&stageTimings[HEADLESS_STAGE_UPDATE], &counter,
+                            gameClocks->perfCountFrequency                 );
+
+        platformQueueNullAudio(gameSound->platformAudio, gameGlobal->renderingRefreshRate);
+        platformRecordStage(&stageTimings[HEADLESS_STAGE_AUDIO], &counter,
+                            gameClocks->perfCountFrequency                );
+
+        if (dumpDirectory && frame % dumpEvery == 0) {
+            platformDumpFrame(gameBuffer, dumpDirectory, frame, dumpRaw, dumpMemory);
+        }
+        platformRecordStage(&stageTimings[HEADLESS_STAGE_DUMP], &counter,
+                            gameClocks->perfCountFrequency               );
+
+        platformGetElapsedCPU(gameClocks);
+        platformGetClocks(gameClocks);
+        frame++;
+    }
+
+    float seconds = platformGetSecondsElapsed(startCounter, platformGetPerformanceCounter(),
+                                              gameClocks->perfCountFrequency               );
+    printf("%s %u frames in %.03fs, %.02f f/s\n", __FUNCTION__, frame, seconds,
+           (float)frame / maxF32(seconds, 0.000001f)                          );
+    const char *stageNames[HEADLESS_STAGE_COUNT] = { "input", "update", "audio", "dump" };
+    for (uint32_t i = 0; i < HEADLESS_STAGE_COUNT && frame; i++) {
+        printf("%s %-6s avg %.04fms, min %.04fms, max %.04fms\n", __FUNCTION__, stageNames[i],
+               stageTimings[i].msTotal / (float)frame, stageTimings[i].msMin,
+               stageTimings[i].msMax                                                        );
+    }
+}
+
 int main(int argc, char **argv)
 {
-    //NOTE[ALEX]: platform independent memory gets allocated from these allocation pools,
-    //            platform dependent structs get allocated using malloc,
-    //            sdl structs get allocated by sdl
+    uint64_t startupCounter  = SDL_GetPerformanceCounter();
+    uint64_t startupResident = platformGetResidentMemory();
+
+    //NOTE[ALEX]: all memory gets allocated from these allocation pools through arenas,
+    //            including platform dependent structs, sdl structs get allocated by sdl
+    int32_t useHugePages = platformHasOption(argc, argv, "--huge-pages", "XB_HUGE_PAGES");
     GameMemory gameMemory = {};
-    gameMemory.permanentMemSize = Megabytes(48);
-    gameMemory.permanentMem     = (uint64_t *)malloc(gameMemory.permanentMemSize);
-    gameMemory.transientMemSize = Gigabytes(1);
-    gameMemory.transientMem     = (uint64_t *)malloc(gameMemory.transientMemSize);
-    // all memory is pre initialized to 0
+    gameMemory.permanentMemSize = PERMANENT_MEMORY_SIZE;
+    gameMemory.permanentMem     = platformAllocateMemory(gameMemory.permanentMemSize,
+                                                         useHugePages                );
+    gameMemory.transientMemSize = TRANSIENT_MEMORY_SIZE;
+    gameMemory.transientMem     = platformAllocateMemory(gameMemory.transientMemSize,
+                                                         useHugePages                );
+    // all memory is pre initialized to 0 (by the os, when a page is touched for the first time)
     if (gameMemory.transientMem && gameMemory.permanentMem) {
-        memset(gameMemory.permanentMem, 0, gameMemory.permanentMemSize);
-        memset(gameMemory.transientMem, 0, gameMemory.transientMemSize);
         gameMemory.initialized =  1;
     } else {
         printf("Could not allocated gameMemory: transient: %lu, permanent: %lu\n",
@@ -1204,6 +3566,13 @@ int main(int argc, char **argv)
 
     xbAssert(gameMemory.initialized);
 
+    initializeArena(&gameMemory.permanentArena, gameMemory.permanentMem,
+                    gameMemory.permanentMemSize                         );
+    initializeArena(&gameMemory.transientArena, gameMemory.transientMem,
+                    gameMemory.transientMemSize                         );
+    subArena(&gameMemory.frameArena, &gameMemory.transientArena, FRAME_ARENA_SIZE);
+    MemoryArena *permanentArena = &gameMemory.permanentArena;
+
 #ifdef PRINT_MEMORY_SIZES
     printf("MEMORY:\n");
     printf("gameMemory.permanentMemSize: %lu\n", gameMemory.permanentMemSize);
@@ -1228,7 +3597,8 @@ int main(int argc, char **argv)
     xbAssert(sizeof(GameState) <= gameMemory.permanentMemSize);
     xbAssert(sizeof(GameTest)  <= gameMemory.transientMemSize);
 
-    GameState  *gameState  = (GameState *)gameMemory.permanentMem;
+    GameState  *gameState  = pushStruct(permanentArena, GameState);
+    gameState->gameMemory  = &gameMemory;
     GameGlobal *gameGlobal = &gameState->gameGlobal;
     GameInput  *gameInput  = &gameState->gameInput;
     GameClocks *gameClocks = &gameState->gameClocks;
@@ -1243,53 +3613,175 @@ int main(int argc, char **argv)
     xbAssert(   &gameInput->controller[0].terminatorContr - &gameInput->controller[0].buttons[0]
              == sizeof(gameInput->controller[0].buttons)/sizeof(gameInput->controller[0].buttons[0]));
 
-    workQueues->workQueue            = platformCreateWorkQueue();
-    workQueues->platformAddWork      = platformAddWorkQueueEntry;
-    workQueues->platformCompleteWork = platformCompleteAllWork;
-
-    const uint32_t threadCount = THREAD_COUNT;
-    PlatformThreadInfo  platformThreadInfo[threadCount];
-    PlatformThread     *platformThread[threadCount];
-    char *threadName = (char *)THREAD_NAME;
-    size_t threadStackSize = 0;
-    for (uint32_t i = 0; i < threadCount; i++) {
-        platformThreadInfo[i] = {};
-        platformThreadInfo[i].logicalThreadID = i + 1; //NOTE[ALEX]: 0 is reserverd for main thread
-        platformThreadInfo[i].platformWorkQueue = workQueues->workQueue;
-        platformThread[i] = platformCreateThread(threadProc, threadName,
-                                                 (void *)&platformThreadInfo[i], threadStackSize);
+    PlatformCPUTopology cpuTopology;
+    platformGetCPUTopology(&cpuTopology);
+    PlatformThreadConfig threadConfig;
+    platformGetThreadConfig(argc, argv, &cpuTopology, &threadConfig);
+    platformSetLogicalThreadID(0); //NOTE[ALEX]: 0 is reserved for main thread
+    if (threadConfig.pinThreads) {
+        platformPinThread(0, platformGetThreadCPU(&cpuTopology, 0));
+    }
+#ifdef THREAD_POOL_RESTART_TEST
+    for (uint32_t i = 0; i < 100; i++) {
+        TemporaryMemory testPoolMemory    = beginTemporaryMemory(permanentArena);
+        TemporaryMemory testScratchMemory = beginTemporaryMemory(&gameMemory.transientArena);
+        PlatformThreadPool *testPool = platformCreateThreadPool(permanentArena,
+                                                                &gameMemory.transientArena,
+                                                                &threadConfig, &cpuTopology);
+        platformAddWorkQueueEntries(testPool->highPriorityQueue, 64, doQueueWorkNothing, 0);
+        platformAddWorkQueueEntries(testPool->lowPriorityQueue, 64, doQueueWorkNothing, 0);
+        platformDestroyThreadPool(testPool, (i % 2) ? PLATFORM_SHUTDOWN_CANCEL
+                                                    : PLATFORM_SHUTDOWN_DRAIN );
+        endTemporaryMemory(testScratchMemory);
+        endTemporaryMemory(testPoolMemory);
     }
+#endif
+    PlatformThreadPool *threadPool = platformCreateThreadPool(permanentArena,
+                                                              &gameMemory.transientArena,
+                                                              &threadConfig, &cpuTopology);
+    workQueues->highPriorityQueue        = threadPool->highPriorityQueue;
+    workQueues->lowPriorityQueue         = threadPool->lowPriorityQueue;
+    workQueues->scratchArenas            = threadPool->scratchArenas;
+    workQueues->scratchArenaCount        = threadPool->threadCount + 1;
+    workQueues->workerCount              = threadPool->threadCount;
+    workQueues->platformAddWork          = platformAddWorkQueueEntry;
+    workQueues->platformAddDependentWork = platformAddDependentWork;
+    workQueues->platformCompleteWork     = platformCompleteAllWork;
+    workQueues->platformWaitForCounter   = platformWaitForCounter;
+    workQueues->platformGetWorkCounter   = platformGetWorkCounter;
+    workQueues->platformGetWorkQueueStats = platformGetWorkQueueStats;
+    workQueues->platformParallelFor      = platformParallelFor;
 
 #ifdef MULTI_THREADING_TEST
-    platformAddWorkQueueEntry(workQueues->workQueue, doQueueWorkPrint, (char *)"testA00");
-    platformAddWorkQueueEntry(workQueues->workQueue, doQueueWorkPrint, (char *)"testA01");
-    platformAddWorkQueueEntry(workQueues->workQueue, doQueueWorkPrint, (char *)"testA02");
-    platformAddWorkQueueEntry(workQueues->workQueue, doQueueWorkPrint, (char *)"testA03");
-    platformAddWorkQueueEntry(workQueues->workQueue, doQueueWorkPrint, (char *)"testA04");
-    platformAddWorkQueueEntry(workQueues->workQueue, doQueueWorkPrint, (char *)"testA05");
-    platformAddWorkQueueEntry(workQueues->workQueue, doQueueWorkPrint, (char *)"testA06");
-    platformAddWorkQueueEntry(workQueues->workQueue, doQueueWorkPrint, (char *)"testA07");
-    platformAddWorkQueueEntry(workQueues->workQueue, doQueueWorkPrint, (char *)"testA08");
-    platformAddWorkQueueEntry(workQueues->workQueue, doQueueWorkPrint, (char *)"testA09");
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkPrint, (char *)"testA00");
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkPrint, (char *)"testA01");
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkPrint, (char *)"testA02");
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkPrint, (char *)"testA03");
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkPrint, (char *)"testA04");
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkPrint, (char *)"testA05");
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkPrint, (char *)"testA06");
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkPrint, (char *)"testA07");
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkPrint, (char *)"testA08");
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkPrint, (char *)"testA09");
     platformWait(1000);
-    platformAddWorkQueueEntry(workQueues->workQueue, doQueueWorkPrint, (char *)"testB00");
-    platformAddWorkQueueEntry(workQueues->workQueue, doQueueWorkPrint, (char *)"testB01");
-    platformAddWorkQueueEntry(workQueues->workQueue, doQueueWorkPrint, (char *)"testB02");
-    platformAddWorkQueueEntry(workQueues->workQueue, doQueueWorkPrint, (char *)"testB03");
-    platformAddWorkQueueEntry(workQueues->workQueue, doQueueWorkPrint, (char *)"testB04");
-    platformAddWorkQueueEntry(workQueues->workQueue, doQueueWorkPrint, (char *)"testB05");
-    platformAddWorkQueueEntry(workQueues->workQueue, doQueueWorkPrint, (char *)"testB06");
-    platformAddWorkQueueEntry(workQueues->workQueue, doQueueWorkPrint, (char *)"testB07");
-    platformAddWorkQueueEntry(workQueues->workQueue, doQueueWorkPrint, (char *)"testB08");
-    platformAddWorkQueueEntry(workQueues->workQueue, doQueueWorkPrint, (char *)"testB09");
-    platformCompleteAllWork(workQueues->workQueue, 0);
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkPrint, (char *)"testB00");
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkPrint, (char *)"testB01");
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkPrint, (char *)"testB02");
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkPrint, (char *)"testB03");
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkPrint, (char *)"testB04");
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkPrint, (char *)"testB05");
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkPrint, (char *)"testB06");
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkPrint, (char *)"testB07");
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkPrint, (char *)"testB08");
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkPrint, (char *)"testB09");
+    platformAddWorkQueueEntry(workQueues->highPriorityQueue, doQueueWorkSpawn,
+                              workQueues->highPriorityQueue                 );
+    platformCompleteAllWork(workQueues->highPriorityQueue, 0);
+    uint32_t testCounter = WORK_COUNTER_NAMED_COUNT; // first free counter
+    platformAddDependentWork(workQueues->highPriorityQueue, WORK_COUNTER_NONE, testCounter,
+                             doQueueWorkPrint, (char *)"testD00");
+    platformAddDependentWork(workQueues->highPriorityQueue, WORK_COUNTER_NONE, testCounter,
+                             doQueueWorkPrint, (char *)"testD01");
+    platformAddDependentWork(workQueues->highPriorityQueue, WORK_COUNTER_NONE, testCounter,
+                             doQueueWorkPrint, (char *)"testD02");
+    //NOTE[ALEX]: added after the jobs that raise the counter, so it gets held until they are done
+    platformAddDependentWork(workQueues->highPriorityQueue, testCounter, WORK_COUNTER_NONE,
+                             doQueueWorkContinuation, (char *)"testD03");
+    platformWaitForCounter(workQueues->highPriorityQueue, testCounter, 0);
+    //NOTE[ALEX]: low priority work is picked up by the worker threads once the high priority
+    //            queue is empty, the main thread does not wait for it
+    platformAddWorkQueueEntry(workQueues->lowPriorityQueue, doQueueWorkPrint, (char *)"testE00");
+    platformAddWorkQueueEntry(workQueues->lowPriorityQueue, doQueueWorkPrint, (char *)"testE01");
+    platformCompleteAllWork(workQueues->highPriorityQueue, 0);
+#endif
+
+#ifdef WORK_QUEUE_LATENCY_TEST
+    platformRunWorkQueueLatencyTest(workQueues->highPriorityQueue, permanentArena);
+#endif
+
+    //NOTE[ALEX]: the pixel kernels can be limited with --pixel-kernels N / XB_PIXEL_KERNELS
+    //            (0 scalar, 1 sse2, 2 avx2) to compare them
+    int32_t maxPixelKernelLevel = platformGetOptionValue(argc, argv, "--pixel-kernels",
+                                                         "XB_PIXEL_KERNELS",
+                                                         PIXEL_KERNELS_LEVEL_COUNT - 1 );
+    maxPixelKernelLevel = minI32(maxI32(maxPixelKernelLevel, 0), PIXEL_KERNELS_LEVEL_COUNT - 1);
+    PixelKernelLevel pixelKernelLevel =
+        initializePixelKernels((PixelKernelLevel)maxPixelKernelLevel);
+    printf("%s pixel kernels: %s\n", __FUNCTION__, getPixelKernelLevelName(pixelKernelLevel));
+#ifdef PIXEL_KERNEL_BENCHMARK
+    platformRunPixelKernelBenchmark(&gameMemory.transientArena);
+#endif
+    //NOTE[ALEX]: the sample kernels of the mixer use the same levels as the pixel kernels
+    PixelKernelLevel sampleKernelLevel = initializeSampleKernels(pixelKernelLevel);
+    printf("%s sample kernels: %s\n", __FUNCTION__, getPixelKernelLevelName(sampleKernelLevel));
+#ifdef SAMPLE_KERNEL_BENCHMARK
+    platformRunSampleKernelBenchmark(&gameMemory.transientArena, sampleKernelLevel);
+#endif
+
+    platformGetRenderTargetConfig(argc, argv, &gameState->renderTarget,
+                                  &gameMemory.transientArena                );
+    //NOTE[ALEX]: the audio thread keeps the queue of the audio device filled, so the queue needs
+    //            a sufficient amount of audio to bridge the time until the thread tops it up again;
+    //            if there is no audio queued up, silence is put out
+    //            targetAudioFrameLatency controls the amount of frames (at 30fps)
+    //            that audio is mixed in advance for;
+    //            mixing does not depend on the frame time of the game anymore, the queue only has
+    //            to cover the device buffer (AUDIO_SAMPLES_PER_CALL) and the wait of the audio
+    //            thread (AUDIO_THREAD_WAIT_MS), but also delays every command to the mixer;
+    //            this is only where the latency controller of the audio thread starts, it keeps
+    //            the lowest latency that does not run dry on this machine (unless the latency is
+    //            fixed with --fixed-audio-latency / XB_FIXED_AUDIO_LATENCY)
+    uint32_t targetAudioFrameLatency = 2;
+
+    // transient memory test
+    GameTest *gameTest = pushStruct(&gameMemory.transientArena, GameTest);
+    //audio test
+    gameTest->toneHz     = 261.0f; // C-Major note tone frequency
+    gameTest->toneVolume = 0.015f;
+    PlatformAudio *platformAudio = platformCreateAudio(permanentArena, gameSound);
+
+    //NOTE[ALEX]: the asset pack is set with --assets FILE / XB_ASSETS
+    gameState->fileIO.assetPackFileName = platformGetOptionString(argc, argv, "--assets",
+                                                                  "XB_ASSETS",
+                                                                  ASSET_PACK_DEFAULT    );
+    //NOTE[ALEX]: the streamed music is set with --music FILE / XB_MUSIC
+    gameState->fileIO.musicFileName     = platformGetOptionString(argc, argv, "--music",
+                                                                  "XB_MUSIC", MUSIC_DEFAULT);
+    gameState->fileIO.platformMapFile   = platformMapFile;
+    gameState->fileIO.platformUnmapFile = platformUnmapFile;
+    gameState->fileIO.platformOpenFile  = platformOpenFile;
+    gameState->fileIO.platformReadFile  = platformReadFile;
+    gameState->fileIO.platformCloseFile = platformCloseFile;
+
+    if (platformHasOption(argc, argv, "--headless", "XB_HEADLESS")) {
+        platformRunHeadless(argc, argv, gameState, gameTest, targetAudioFrameLatency);
+        platformDestroyThreadPool(threadPool, PLATFORM_SHUTDOWN_DRAIN);
+        unloadAssetPack(&gameTest->assetPack, &gameState->fileIO);
+        if (gameTest->music) { closeAudioStream(gameTest->music); }
+#ifdef PRINT_MEMORY_SIZES
+        printArenaUsage((char *)"permanentArena", &gameMemory.permanentArena);
+        printArenaUsage((char *)"transientArena", &gameMemory.transientArena);
+        printArenaUsage((char *)"frameArena", &gameMemory.frameArena);
 #endif
+        platformFreeMemory(gameMemory.transientMem, gameMemory.transientMemSize);
+        platformFreeMemory(gameMemory.permanentMem, gameMemory.permanentMemSize);
+        return 0;
+    }
 
     platformInit();
-    gameBuffer->platformWindow = platformOpenWindow((char *)WINDOW_TITLE,
+    gameBuffer->platformWindow = platformOpenWindow(permanentArena, (char *)WINDOW_TITLE,
                                                      WINDOW_INIT_WIDTH, WINDOW_INIT_HEIGHT);
     platformOpenBackBuffer(gameBuffer);
     platformInitClocks(gameClocks);
+    uint32_t presentBufferCount = platformGetOptionValue(argc, argv, "--present-buffers",
+                                                         "XB_PRESENT_BUFFERS",
+                                                         PRESENT_BUFFERS_DEFAULT          );
+    presentBufferCount = minI32(maxI32(presentBufferCount, 1), PRESENT_BUFFERS_MAX);
+    int32_t lockTextures = !platformHasOption(argc, argv, "--present-copy", "XB_PRESENT_COPY");
+    PlatformPresenter *presenter =
+        platformCreatePresenter(permanentArena, &gameMemory.transientArena,
+                                (PlatformWindow *)gameBuffer->platformWindow, presentBufferCount,
+                                lockTextures                                                    );
     gameGlobal->monitorRefreshRate = platformGetRefreshRate
         ((PlatformWindow *)(gameBuffer->platformWindow));
     if (gameGlobal->monitorRefreshRate == 0) { // fallback
@@ -1298,28 +3790,24 @@ int main(int argc, char **argv)
         gameGlobal->renderingRefreshRate = gameGlobal->monitorRefreshRate;
     }
     gameGlobal->targetTimePerFrame = 1000.0f / (float)(gameGlobal->renderingRefreshRate);
-    //NOTE[ALEX]: audio to play gets queued every frame, so the audio queue needs to be filled
-    //            a sufficient amount in advance;
-    //            if there is no audio queued up, silence is put out
-    //            targetAudioFrameLatency controls the amount of frames (at 30fps)
-    //            that audio is written in advance for;
-    //            if an application targets 30 frames per seconds, this could theoretically be
-    //            reduced down to 1, however, even the slightest spike in frame time would then
-    //            cause an audible stutter, so a larger value is recommended
-    //NOTE[ALEX]: when using a software renderer with an unoptimized draw loop (like the test function),
-    //            the framerate can drop drastically on larger (~4K) resolutions or when scaling
-    //            the window, so a larger latency is chosen but should be adjusted as necessary
-    uint32_t targetAudioFrameLatency = 6;
+
     platformOpenSoundDevice(targetAudioFrameLatency, AUDIO_REFRESH_RATE, gameSound);
-    platformInitializeControllers(gameInput);
+    platformAudio->latency.adaptive = !platformHasOption(argc, argv, "--fixed-audio-latency",
+                                                         "XB_FIXED_AUDIO_LATENCY"         );
+    //NOTE[ALEX]: --audio-clock-pacing / XB_AUDIO_CLOCK_PACING ends frames on the audio clock
+    PlatformAudioPacing audioPacing = {};
+    audioPacing.enabled = platformHasOption(argc, argv, "--audio-clock-pacing",
+                                            "XB_AUDIO_CLOCK_PACING"         );
+    platformStartAudioThread(permanentArena, platformAudio);
+    platformInitializeControllers(permanentArena, gameInput);
 
-    // transient memory test
-    GameTest *gameTest = (GameTest *)gameMemory.transientMem;
-    //audio test
-    gameTest->toneHz         = 261; // C-Major note tone frequency
-    gameTest->toneVolume     = 500;
-    gameTest->wavePeriod     = AUDIO_SAMPLES_PER_SECOND / gameTest->toneHz;
-    gameTest->halfWavePeriod = gameTest->wavePeriod / 2;
+#ifdef PRINT_MEMORY_SIZES
+    printf("startup took %.03fms, resident memory %.03fmb at start, %.03fmb now\n",
+           1000.0f * platformGetSecondsElapsed(startupCounter, SDL_GetPerformanceCounter(),
+                                               SDL_GetPerformanceFrequency()              ),
+           (float)startupResident / (float)Megabytes(1),
+           (float)platformGetResidentMemory() / (float)Megabytes(1)                        );
+#endif
 
     // MAIN LOOP
     while (!gameGlobal->quitGame) {
@@ -1330,53 +3818,102 @@ int main(int argc, char **argv)
             continue;
         }
 
+        resetArena(&gameMemory.frameArena);
+        resetArena(&workQueues->scratchArenas[0].arena); // worker arenas reset after every entry
+        platformAcquireBackBuffer(presenter, gameBuffer, gameClocks);
         gameUpdate(gameState, gameTest);
-        platformQueueAudio(gameSound, gameSound->audioToQueue, gameSound->audioToQueueBytes);
 
-        platformUpdateWindow((PlatformWindow *)(gameBuffer->platformWindow),
-                             (PlatformTexture *)(gameBuffer->platformTexture),
-                             gameBuffer->width, gameBuffer->bytesPerPixel,
-                             gameBuffer->textureMemory                        );
+        platformSubmitBackBuffer(presenter, gameBuffer);
 
         platformGetElapsedCPU(gameClocks);
 
-        float mSecondsElapsed = 1000.0f
-            * platformGetSecondsElapsed(gameClocks->lastPerfCounter,
-                                        platformGetPerformanceCounter(),
-                                        gameClocks->perfCountFrequency  );
-        int32_t timeToSleep = gameGlobal->targetTimePerFrame - mSecondsElapsed;
-        if (timeToSleep > 0) {
-            platformWait(timeToSleep);
+        uint64_t frameEndCounter = gameClocks->lastPerfCounter
+            + (uint64_t)(gameGlobal->targetTimePerFrame / 1000.0f
+                         * (float)gameClocks->perfCountFrequency);
+        if (audioPacing.enabled) {
+            frameEndCounter = platformGetAudioPacedFrameEnd(platformAudio, &audioPacing,
+                                                            gameGlobal->renderingRefreshRate,
+                                                            frameEndCounter                  );
+        }
+        uint64_t frameCounter = platformGetPerformanceCounter();
+        if (frameEndCounter > frameCounter) {
+            int32_t timeToSleep = 1000.0f
+                * platformGetSecondsElapsed(frameCounter, frameEndCounter,
+                                            gameClocks->perfCountFrequency);
+            if (timeToSleep > 0) { platformWait(timeToSleep); }
             //NOTE[ALEX]: to bridge the "gap" introduced by the lower granularity of the wait call,
-            //            stay in the following while loop until the target frame time is reached
-            while (1000.0f * platformGetSecondsElapsed(gameClocks->lastPerfCounter,
-                                                       platformGetPerformanceCounter(),
-                                                       gameClocks->perfCountFrequency  )
-                   < gameGlobal->targetTimePerFrame                                     ) { }
+            //            stay in the following while loop until the end of the frame is reached
+            while (platformGetPerformanceCounter() < frameEndCounter) { }
         }
 
         platformGetClocks(gameClocks);
+        platformGetPresentClocks(presenter, gameClocks);
+
+#ifdef PRINT_WORK_QUEUE_STATS
+        if (gameGlobal->gameFrame % gameGlobal->renderingRefreshRate == 0) {
+            WorkQueueStats workQueueStats = {};
+            platformGetWorkQueueStats(workQueues->highPriorityQueue, &workQueueStats);
+            printWorkQueueStats((char *)"highPriorityQueue", &workQueueStats);
+            platformGetWorkQueueStats(workQueues->lowPriorityQueue, &workQueueStats);
+            printWorkQueueStats((char *)"lowPriorityQueue", &workQueueStats);
+        }
+#endif
+
+#ifdef PRINT_AUDIO_LATENCY_STATS
+        if (gameGlobal->gameFrame % gameGlobal->renderingRefreshRate == 0) {
+            AudioLatencyStats audioLatencyStats = {};
+            platformGetAudioLatencyStats(platformAudio, &audioLatencyStats);
+            printAudioLatencyStats(&audioLatencyStats, false);
+            // the two times only drift apart if frames are not paced by the audio clock
+            AudioClock audioClock = {};
+            platformGetAudioClock(platformAudio, &audioClock);
+            printf("audio clock %.03fs at frame %lu (%.03fs of frames), lead %u frames, "
+                   "late voices %u\n",
+                   (float)audioClock.playedFrame / (float)AUDIO_SAMPLES_PER_SECOND,
+                   gameGlobal->gameFrame,
+                   (float)gameGlobal->gameFrame / (float)gameGlobal->renderingRefreshRate,
+                   audioClock.leadFrames, platformAudio->audioMixer.lateVoices           );
+        }
+#endif
 
 #ifdef PRINT_FRAME_TIMES
         printf("%.04fms/f, %.04ff/s, %lu cycles/f\n", gameClocks->msLastFrame,
                                                       (1.0f/gameClocks->msLastFrame),
                                                       gameClocks->elapsedCycleCount     );
+        printf("present %.04fms (%.03fmb copied, %.01fmb/s), buffer wait %.04fms, "
+               "latency %.04fms, %.02f presented f/s\n", gameClocks->msPresentLastFrame,
+               gameClocks->mbCopiedLastFrame,
+               gameClocks->mbCopiedLastFrame / maxF32(gameClocks->msPresentLastFrame, 0.001f)
+               * 1000.0f, gameClocks->msWaitForBackBuffer, gameClocks->msSubmitToPresent,
+               gameClocks->presentedFramesPerSecond                                         );
 #endif
     }
 
     // CLEANUP
-    for (uint32_t i = 0; i < threadCount; i++) {
-        platformCleanupThread(platformThread[i]);
-    }
-    platformDestroyWorkQueue(workQueues->workQueue);
+    platformDestroyThreadPool(threadPool, PLATFORM_SHUTDOWN_DRAIN);
 
     platformCloseControllers(gameInput);
+    platformStopAudioThread(platformAudio);
     platformCloseSoundDevice();
+#ifdef PRINT_AUDIO_LATENCY_STATS
+    AudioLatencyStats audioLatencyStats = {};
+    platformGetAudioLatencyStats(platformAudio, &audioLatencyStats);
+    printAudioLatencyStats(&audioLatencyStats, true);
+#endif
+    platformDestroyPresenter(presenter);
     platformCloseWindow((PlatformWindow *)gameBuffer->platformWindow);
     platformCloseBackBuffer(gameBuffer);
+    unloadAssetPack(&gameTest->assetPack, &gameState->fileIO);
+    if (gameTest->music) { closeAudioStream(gameTest->music); }
+
+#ifdef PRINT_MEMORY_SIZES
+    printArenaUsage((char *)"permanentArena", &gameMemory.permanentArena);
+    printArenaUsage((char *)"transientArena", &gameMemory.transientArena);
+    printArenaUsage((char *)"frameArena", &gameMemory.frameArena);
+#endif
 
-    free(gameMemory.transientMem);
-    free(gameMemory.permanentMem);
+    platformFreeMemory(gameMemory.transientMem, gameMemory.transientMemSize);
+    platformFreeMemory(gameMemory.permanentMem, gameMemory.permanentMemSize);
 
     return 0;
 }
@@ -0,0 +1,110 @@
+#include "xbAsset.h"
+#include "xbEngine.h"
+#include "constants.h"
+
+#include <cstdio> // for printf
+#include <cstring> // for strcmp, memchr
+
+// every entry has to stay inside the file, so a broken pack can never be read out of bounds
+int32_t validateAssetEntry(AssetPackEntry *entry, uint64_t fileSize)
+{
+    if (!memchr(entry->name, 0, ASSET_NAME_LENGTH))     { return 0; }
+    if (entry->type >= ASSET_TYPE_COUNT)                { return 0; }
+    if (entry->dataOffset % ASSET_PACK_ALIGNMENT)       { return 0; }
+    if (entry->dataOffset > fileSize)                   { return 0; }
+    if (entry->dataSize > fileSize - entry->dataOffset) { return 0; }
+    if (entry->type == ASSET_TYPE_BITMAP) {
+        if (entry->width <= 0 || entry->height <= 0)                   { return 0; }
+        if (entry->pitch % ASSET_PACK_ALIGNMENT)                       { return 0; }
+        if (entry->pitch / sizeof(uint32_t) < (uint32_t)entry->width)  { return 0; }
+        if (entry->dataSize < (uint64_t)entry->pitch * entry->height)  { return 0; }
+    }
+    return 1;
+}
+
+// arena only gets used on platforms that cannot map the file (see PlatformMappedFile)
+int32_t loadAssetPack(AssetPack *assetPack, FileIO *fileIO, const char *fileName,
+                      MemoryArena *arena                                         )
+{
+    *assetPack = {};
+    PlatformMappedFile file = {};
+    if (!fileIO->platformMapFile(fileName, arena, &file)) { return 0; }
+
+    const char *error = 0;
+    AssetPackHeader *header = (AssetPackHeader *)file.memory;
+    if (file.size < sizeof(AssetPackHeader)) {
+        error = "too small";
+    } else if (header->magic != ASSET_PACK_MAGIC) {
+        error = "not an asset pack";
+    } else if (   header->version   != ASSET_PACK_VERSION
+               || header->entrySize != sizeof(AssetPackEntry)) {
+        error = "unsupported version";
+    } else if (   header->fileSize != file.size
+               || header->indexOffset % alignof(AssetPackEntry)
+               || header->indexOffset > file.size
+               ||   (uint64_t)header->assetCount * sizeof(AssetPackEntry)
+                  > file.size - header->indexOffset                       ) {
+        error = "truncated";
+    } else {
+        AssetPackEntry *entries =
+            (AssetPackEntry *)((uint8_t *)file.memory + header->indexOffset);
+        for (uint32_t i = 0; i < header->assetCount && !error; i++) {
+            if (!validateAssetEntry(&entries[i], file.size)) {
+                error = "broken index";
+            } else if (i > 0 && strcmp(entries[i - 1].name, entries[i].name) >= 0) {
+                error = "index not sorted";
+            }
+        }
+    }
+
+    if (error) {
+        printf("%s %s: %s\n", __FUNCTION__, fileName, error);
+        fileIO->platformUnmapFile(&file);
+        return 0;
+    }
+
+    assetPack->file       = file;
+    assetPack->entries    = (AssetPackEntry *)((uint8_t *)file.memory + header->indexOffset);
+    assetPack->assetCount = header->assetCount;
+    printf("%s %s: %u assets, %lu bytes mapped\n", __FUNCTION__, fileName,
+           assetPack->assetCount, file.size                                );
+    return 1;
+}
+
+void unloadAssetPack(AssetPack *assetPack, FileIO *fileIO)
+{
+    if (assetPack->file.memory) {
+        fileIO->platformUnmapFile(&assetPack->file);
+    }
+    *assetPack = {};
+}
+
+// binary search, the packer sorts the index by name
+AssetPackEntry *findAsset(AssetPack *assetPack, const char *name)
+{
+    uint32_t low  = 0;
+    uint32_t high = assetPack->assetCount;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        int32_t  order  = strcmp(name, assetPack->entries[middle].name);
+        if (order == 0) {
+            return &assetPack->entries[middle];
+        } else if (order < 0) {
+            high = middle;
+        } else {
+            low  = middle + 1;
+        }
+    }
+    return 0;
+}
+
+int32_t getAssetBitmap(AssetPack *assetPack, AssetPackEntry *entry, RenderBitmap *bitmap)
+{
+    if (!entry || entry->type != ASSET_TYPE_BITMAP) { return 0; }
+    bitmap->width  = entry->width;
+    bitmap->height = entry->height;
+    bitmap->pitch  = entry->pitch;
+    bitmap->pixels = (uint32_t *)((uint8_t *)assetPack->file.memory + entry->dataOffset);
+    bitmap->opaque = (entry->flags & ASSET_FLAG_OPAQUE) != 0;
+    return 1;
+}
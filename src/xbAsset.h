@@ -0,0 +1,59 @@
+#ifndef XBASSET_H // include guard begin
+#define XBASSET_H // include guard
+
+#include "constants.h"
+#include "xbEngine.h"
+
+#include <stdint.h> // defines fixed size types, C++ version is <cstdint>
+
+//NOTE[ALEX]: asset packs are built offline by xbPacker and memory-mapped at runtime, the pixels
+//            are already in the layout of the GameBuffer (premultiplied AARRGGBB, pitch and
+//            start aligned to ASSET_PACK_ALIGNMENT), so bitmaps point straight into the mapping;
+//            nothing gets copied and pages are only read from disk when they are touched
+//            file layout: AssetPackHeader, pixel data of every asset, AssetPackEntry index
+//            (sorted by name), all values little endian
+#define ASSET_PACK_MAGIC 0x4B504258 // "XBPK"
+#define ASSET_PACK_VERSION 1
+#define ASSET_PACK_ALIGNMENT GAMEBUFFER_PITCH_ALIGNMENT
+#define ASSET_NAME_LENGTH 32 // including the terminating 0
+
+enum AssetType {
+    ASSET_TYPE_BITMAP,
+    ASSET_TYPE_COUNT
+};
+
+enum AssetFlags {
+    ASSET_FLAG_OPAQUE = 0x1, // all pixels have an alpha of 255
+};
+
+struct AssetPackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t assetCount;
+    uint32_t entrySize;   // sizeof(AssetPackEntry) when the pack was built
+    uint64_t indexOffset; // from the start of the file
+    uint64_t fileSize;
+};
+
+struct AssetPackEntry {
+    char     name[ASSET_NAME_LENGTH]; // file name of the source without its extension
+    uint32_t type;
+    uint32_t flags;
+    int32_t  width;
+    int32_t  height;
+    uint32_t pitch;
+    uint32_t reserved;
+    uint64_t dataOffset; // from the start of the file
+    uint64_t dataSize;
+};
+
+// maps and validates the pack, returns 0 (and leaves nothing mapped) if it cannot be used
+int32_t loadAssetPack(AssetPack *assetPack, FileIO *fileIO, const char *fileName,
+                      MemoryArena *arena                                         );
+void unloadAssetPack(AssetPack *assetPack, FileIO *fileIO);
+
+AssetPackEntry *findAsset(AssetPack *assetPack, const char *name);
+// bitmap pointing into the mapped pack, returns 0 if the entry is not a bitmap
+int32_t getAssetBitmap(AssetPack *assetPack, AssetPackEntry *entry, RenderBitmap *bitmap);
+
+#endif // include guard end
@@ -0,0 +1,412 @@
+#include "xbAudio.h"
+#include "xbEngine.h"
+#include "xbMath.h"
+#include "xbSample.h"
+#include "constants.h"
+
+#include <math.h> // for cosf, sinf
+
+uint32_t pushPlayCommand(GameSound *gameSound, AudioCommandType type, AudioSound *sound,
+                         float volume, float pan, float rate, int32_t loop,
+                         uint64_t startFrame                                            )
+{
+    gameSound->nextVoiceID++;
+    if (gameSound->nextVoiceID == 0) { gameSound->nextVoiceID++; } // 0 is no voice
+
+    AudioCommand command = {};
+    command.type    = type;
+    command.voiceID = gameSound->nextVoiceID;
+    command.sound   = sound;
+    command.volume  = volume;
+    command.pan     = pan;
+    command.rate    = rate;
+    command.loop    = loop;
+    command.startFrame = startFrame;
+    if (!gameSound->platformPushAudioCommand(gameSound->platformAudio, &command)) { return 0; }
+    return command.voiceID;
+}
+
+uint32_t playSound(GameSound *gameSound, AudioSound *sound, float volume, float pan,
+                   float rate, int32_t loop                                        )
+{
+    return pushPlayCommand(gameSound, AUDIO_COMMAND_PLAY, sound, volume, pan, rate, loop, 0);
+}
+
+uint32_t playSoundAt(GameSound *gameSound, AudioSound *sound, float volume, float pan,
+                     float rate, int32_t loop, uint64_t startFrame                    )
+{
+    return pushPlayCommand(gameSound, AUDIO_COMMAND_PLAY, sound, volume, pan, rate, loop,
+                           startFrame                                                    );
+}
+
+uint32_t playStream(GameSound *gameSound, AudioSound *firstBuffer, float volume, float pan,
+                    float rate                                                          )
+{
+    return pushPlayCommand(gameSound, AUDIO_COMMAND_PLAY_STREAM, firstBuffer,
+                           volume, pan, rate, false, 0                       );
+}
+
+int32_t queueStreamBuffer(GameSound *gameSound, uint32_t voiceID, AudioSound *buffer)
+{
+    AudioCommand command = {};
+    command.type    = AUDIO_COMMAND_QUEUE_BUFFER;
+    command.voiceID = voiceID;
+    command.sound   = buffer;
+    return gameSound->platformPushAudioCommand(gameSound->platformAudio, &command);
+}
+
+int32_t endStream(GameSound *gameSound, uint32_t voiceID)
+{
+    AudioCommand command = {};
+    command.type    = AUDIO_COMMAND_END_STREAM;
+    command.voiceID = voiceID;
+    return gameSound->platformPushAudioCommand(gameSound->platformAudio, &command);
+}
+
+int32_t updateSound(GameSound *gameSound, uint32_t voiceID, float volume, float pan, float rate)
+{
+    AudioCommand command = {};
+    command.type    = AUDIO_COMMAND_UPDATE;
+    command.voiceID = voiceID;
+    command.volume  = volume;
+    command.pan     = pan;
+    command.rate    = rate;
+    return gameSound->platformPushAudioCommand(gameSound->platformAudio, &command);
+}
+
+int32_t stopSound(GameSound *gameSound, uint32_t voiceID)
+{
+    AudioCommand command = {};
+    command.type    = AUDIO_COMMAND_STOP;
+    command.voiceID = voiceID;
+    return gameSound->platformPushAudioCommand(gameSound->platformAudio, &command);
+}
+
+uint64_t getAudioClockFrame(AudioClock *audioClock, uint64_t perfCounter)
+{
+    if (!audioClock->perfCountFrequency) { return audioClock->playedFrame; } // not running yet
+    uint64_t frame = audioClock->playedFrame;
+    if (perfCounter >= audioClock->perfCounter) {
+        uint64_t elapsed = perfCounter - audioClock->perfCounter;
+        frame += elapsed * AUDIO_SAMPLES_PER_SECOND / audioClock->perfCountFrequency;
+    } else { // a frame that started before the last update
+        uint64_t elapsed = audioClock->perfCounter - perfCounter;
+        uint64_t frames  = elapsed * AUDIO_SAMPLES_PER_SECOND / audioClock->perfCountFrequency;
+        frame -= minU64(frames, frame);
+    }
+    return minU64(frame, audioClock->mixedFrame);
+}
+
+//NOTE[ALEX]: the table is read in runs that end before the phase wraps, so every run is a single
+//            resample of the table; the end of a run is checked with the same float math the
+//            sample kernels use, so no position of a run ever reaches past the repeated sample
+float oscillateWavetable(float *destination, uint32_t count, float *table, uint32_t tableFrames,
+                         float phase, float step                                               )
+{
+    xbAssert(step > 0.0f);
+    float end = (float)tableFrames;
+    while (count) {
+        float    left = minF32((end - phase) / step, (float)count);
+        uint32_t run  = (uint32_t)maxI32(ceilF32toI32(left), 1);
+        while (run > 1 && phase + step * (float)(run - 1) >= end) { run--; }
+        resampleSamples(destination, table, run, phase, step);
+        phase += step * (float)run;
+        while (phase >= end) { phase -= end; }
+        destination += run;
+        count       -= run;
+    }
+    return phase;
+}
+
+// constant power panning, the center is 3dB quieter per side than hard left or right
+void setVoiceTarget(AudioVoice *voice, float volume, float pan, float rate)
+{
+    float angle = (clampF32(pan, -1.0f, 1.0f) + 1.0f) * 0.25f * PI32;
+    voice->targetGainLeft  = maxF32(volume, 0.0f) * cosf(angle);
+    voice->targetGainRight = maxF32(volume, 0.0f) * sinf(angle);
+    voice->step = (uint64_t)(clampF32(rate, 0.0f, AUDIO_RATE_MAX) * 4294967296.0f);
+}
+
+AudioVoice *findVoice(AudioMixer *audioMixer, uint32_t voiceID)
+{
+    for (uint32_t i = 0; i < AUDIO_VOICES_MAX; i++) {
+        if (audioMixer->voices[i].id == voiceID) { return &audioMixer->voices[i]; }
+    }
+    return 0;
+}
+
+void pushAudioEvent(AudioMixer *audioMixer, AudioEventType type, uint32_t voiceID,
+                    AudioSound *sound                                             )
+{
+    if (audioMixer->eventCount == AUDIO_EVENTS_MAX) {
+        audioMixer->droppedEvents++;
+        return;
+    }
+    AudioEvent *event = &audioMixer->events[audioMixer->eventCount++];
+    event->type    = type;
+    event->voiceID = voiceID;
+    event->sound   = sound;
+}
+
+// a streaming voice gives back every buffer it still holds
+void freeVoice(AudioMixer *audioMixer, AudioVoice *voice)
+{
+    if (voice->streaming) {
+        pushAudioEvent(audioMixer, AUDIO_EVENT_BUFFER_DONE, voice->id, voice->sound);
+        for (uint32_t i = 0; i < voice->bufferCount; i++) {
+            pushAudioEvent(audioMixer, AUDIO_EVENT_BUFFER_DONE, voice->id, voice->buffers[i]);
+        }
+        pushAudioEvent(audioMixer, AUDIO_EVENT_STREAM_DONE, voice->id, 0);
+    }
+    voice->id = 0;
+}
+
+// moves a streaming voice on to its next buffer once its position has passed the current one
+void advanceVoiceBuffers(AudioMixer *audioMixer, AudioVoice *voice)
+{
+    while (voice->bufferCount) {
+        uint64_t end = (uint64_t)voice->sound->frameCount << 32;
+        if (voice->position < end) { break; }
+        pushAudioEvent(audioMixer, AUDIO_EVENT_BUFFER_DONE, voice->id, voice->sound);
+        voice->position -= end;
+        voice->sound     = voice->buffers[0];
+        voice->bufferCount--;
+        for (uint32_t i = 0; i < voice->bufferCount; i++) {
+            voice->buffers[i] = voice->buffers[i + 1];
+        }
+    }
+}
+
+// every command causes at most two events over its lifetime (a stream: its first buffer and
+// STREAM_DONE, a dropped sound: VOICE_DROPPED, a queued buffer: BUFFER_DONE)
+#define AUDIO_COMMAND_EVENTS_MAX 2
+
+int32_t hasRoomForAudioCommand(AudioMixer *audioMixer)
+{
+    // a streaming voice still owes BUFFER_DONE for every buffer it holds and its STREAM_DONE
+    uint32_t owedEvents = audioMixer->eventCount;
+    for (uint32_t i = 0; i < AUDIO_VOICES_MAX; i++) {
+        AudioVoice *voice = &audioMixer->voices[i];
+        if (voice->id && voice->streaming) {
+            owedEvents += 1 + voice->bufferCount + 1;
+        }
+    }
+    return owedEvents + AUDIO_COMMAND_EVENTS_MAX <= AUDIO_EVENTS_MAX;
+}
+
+void applyAudioCommand(AudioMixer *audioMixer, AudioCommand *command)
+{
+    switch (command->type) {
+        case AUDIO_COMMAND_PLAY:
+        case AUDIO_COMMAND_PLAY_STREAM: {
+            int32_t streaming = command->type == AUDIO_COMMAND_PLAY_STREAM;
+            AudioVoice *voice = findVoice(audioMixer, 0);
+            if (!voice) {
+                audioMixer->droppedVoices++;
+                if (streaming) {
+                    pushAudioEvent(audioMixer, AUDIO_EVENT_BUFFER_DONE, command->voiceID,
+                                   command->sound                                        );
+                    pushAudioEvent(audioMixer, AUDIO_EVENT_STREAM_DONE, command->voiceID, 0);
+                } else {
+                    pushAudioEvent(audioMixer, AUDIO_EVENT_VOICE_DROPPED, command->voiceID,
+                                   command->sound                                          );
+                }
+                break;
+            }
+            *voice = {};
+            voice->id        = command->voiceID;
+            voice->sound     = command->sound;
+            voice->loop      = streaming ? false : command->loop;
+            voice->streaming = streaming;
+            if (command->startFrame > audioMixer->mixedFrames) {
+                voice->startFrame = command->startFrame;
+            } else if (command->startFrame && command->startFrame < audioMixer->mixedFrames) {
+                audioMixer->lateVoices++;
+            }
+            setVoiceTarget(voice, command->volume, command->pan, command->rate);
+            voice->gainLeft  = voice->targetGainLeft; // sounds start at their first sample
+            voice->gainRight = voice->targetGainRight;
+        } break;
+        case AUDIO_COMMAND_QUEUE_BUFFER: {
+            AudioVoice *voice = command->voiceID ? findVoice(audioMixer, command->voiceID) : 0;
+            if (   voice && voice->streaming && !voice->streamEnded && !voice->stopping
+                && voice->bufferCount < AUDIO_VOICE_BUFFERS_MAX
+                && command->sound->channelCount == voice->sound->channelCount         ) {
+                voice->buffers[voice->bufferCount++] = command->sound;
+            } else { // never played, the buffer can be refilled right away
+                pushAudioEvent(audioMixer, AUDIO_EVENT_BUFFER_DONE, command->voiceID,
+                               command->sound                                        );
+            }
+        } break;
+        case AUDIO_COMMAND_END_STREAM: {
+            AudioVoice *voice = command->voiceID ? findVoice(audioMixer, command->voiceID) : 0;
+            if (voice) { voice->streamEnded = true; }
+        } break;
+        case AUDIO_COMMAND_UPDATE: {
+            AudioVoice *voice = findVoice(audioMixer, command->voiceID);
+            if (voice && !voice->stopping) {
+                setVoiceTarget(voice, command->volume, command->pan, command->rate);
+            }
+        } break;
+        case AUDIO_COMMAND_STOP:
+        case AUDIO_COMMAND_STOP_ALL: {
+            for (uint32_t i = 0; i < AUDIO_VOICES_MAX; i++) {
+                AudioVoice *voice = &audioMixer->voices[i];
+                int32_t matches =    command->type == AUDIO_COMMAND_STOP_ALL
+                                  || voice->id == command->voiceID;
+                if (voice->id && matches) {
+                    voice->targetGainLeft  = 0.0f;
+                    voice->targetGainRight = 0.0f;
+                    voice->stopping        = true;
+                }
+            }
+        } break;
+    }
+}
+
+// converts count frames starting at frame, a looping sound wraps around, a streaming voice goes
+// on with its queued buffers, otherwise the last frame is repeated (that one is only ever
+// interpolated to, never played on its own)
+void readVoiceSource(AudioMixer *audioMixer, AudioVoice *voice, uint32_t frame, uint32_t count)
+{
+    AudioSound *sound        = voice->sound;
+    uint32_t    channelCount = sound->channelCount;
+    float      *source       = channelCount == 2 ? audioMixer->sourceFrames
+                                                 : audioMixer->sourceLeft;
+    uint32_t    read         = 0;
+    uint32_t    nextBuffer   = 0;
+    while (read < count) {
+        uint32_t run = minI32(count - read, sound->frameCount - frame);
+        convertSamplesFromS16(source + read * channelCount,
+                              sound->samples + frame * channelCount, run * channelCount);
+        read  += run;
+        frame += run;
+        if (frame == sound->frameCount) {
+            if (voice->loop) {
+                frame = 0;
+            } else if (nextBuffer < voice->bufferCount) {
+                sound = voice->buffers[nextBuffer++];
+                frame = 0;
+            } else {
+                break;
+            }
+        }
+    }
+    for (; read < count; read++) {
+        for (uint32_t channel = 0; channel < channelCount; channel++) {
+            source[read * channelCount + channel] = source[(read - 1) * channelCount + channel];
+        }
+    }
+    if (channelCount == 2) {
+        deinterleaveSamples(audioMixer->sourceLeft, audioMixer->sourceRight, source, count);
+    }
+}
+
+//NOTE[ALEX]: samples are interpolated linearly between the two frames around the position,
+//            a voice that does not loop ends once its position passes the last frame, unless it
+//            is a stream that waits for more buffers; the voice is mixed into the bus from offset
+void mixVoice(AudioMixer *audioMixer, AudioVoice *voice, uint32_t offset, uint32_t frameCount)
+{
+    advanceVoiceBuffers(audioMixer, voice);
+    AudioSound *sound   = voice->sound;
+    int32_t     waiting = voice->streaming && !voice->streamEnded && !voice->stopping;
+    uint64_t    end     = (uint64_t)sound->frameCount << 32;
+    if (voice->position >= end) {
+        if (waiting) { return; } // ran out of buffers, silent until the next one is queued
+        if (!voice->loop || end == 0) {
+            freeVoice(audioMixer, voice);
+            return;
+        }
+        voice->position %= end;
+    }
+
+    // frames before a voice that does not loop runs out
+    uint64_t available = end;
+    for (uint32_t i = 0; i < voice->bufferCount; i++) {
+        available += (uint64_t)voice->buffers[i]->frameCount << 32;
+    }
+    uint32_t mixFrames = frameCount;
+    if (!voice->loop && voice->step) {
+        uint64_t remaining = available - voice->position;
+        uint64_t left      = remaining / voice->step + (remaining % voice->step != 0);
+        if (left < mixFrames) { mixFrames = (uint32_t)left; }
+    }
+
+    uint32_t frame    = (uint32_t)(voice->position >> 32);
+    uint64_t fraction = (uint32_t)voice->position;
+    uint32_t count    = (uint32_t)((fraction + (mixFrames - 1) * voice->step) >> 32) + 2;
+    xbAssert(count <= AUDIO_SOURCE_FRAMES);
+    readVoiceSource(audioMixer, voice, frame, count);
+
+    float *left  = audioMixer->sourceLeft;
+    float *right = sound->channelCount == 2 ? audioMixer->sourceRight : left;
+    // a voice at its original rate on a whole frame plays the samples as they are
+    if (voice->step != (uint64_t)1 << 32 || fraction != 0) {
+        float position = (float)fraction    * (1.0f / 4294967296.0f);
+        float step     = (float)voice->step * (1.0f / 4294967296.0f);
+        resampleSamples(audioMixer->resampledLeft, left, mixFrames, position, step);
+        left = audioMixer->resampledLeft;
+        if (sound->channelCount == 2) {
+            resampleSamples(audioMixer->resampledRight, right, mixFrames, position, step);
+            right = audioMixer->resampledRight;
+        } else {
+            right = left;
+        }
+    }
+
+    float gainStepLeft  = (voice->targetGainLeft  - voice->gainLeft ) / (float)frameCount;
+    float gainStepRight = (voice->targetGainRight - voice->gainRight) / (float)frameCount;
+    mixSamples(audioMixer->busLeft  + offset, left,  mixFrames, voice->gainLeft,  gainStepLeft );
+    mixSamples(audioMixer->busRight + offset, right, mixFrames, voice->gainRight, gainStepRight);
+    voice->position += mixFrames * voice->step;
+    advanceVoiceBuffers(audioMixer, voice);
+
+    if (mixFrames < frameCount) {
+        if (waiting) { // picks up the ramp where it stopped once more buffers arrive
+            voice->gainLeft  += gainStepLeft  * (float)mixFrames;
+            voice->gainRight += gainStepRight * (float)mixFrames;
+            return;
+        }
+        freeVoice(audioMixer, voice);
+        return;
+    }
+    voice->gainLeft  = voice->targetGainLeft;
+    voice->gainRight = voice->targetGainRight;
+    if (voice->stopping) { freeVoice(audioMixer, voice); }
+}
+
+// mixes all voices into frameCount interleaved stereo frames, block by block
+void mixAudio(AudioMixer *audioMixer, int16_t *output, uint32_t frameCount)
+{
+    xbAssert(AUDIO_CHANNELS == 2);
+    while (frameCount) {
+        uint32_t blockFrames = minI32(frameCount, AUDIO_MIX_FRAMES);
+        for (uint32_t i = 0; i < blockFrames; i++) {
+            audioMixer->busLeft[i]  = 0.0f;
+            audioMixer->busRight[i] = 0.0f;
+        }
+
+        for (uint32_t i = 0; i < AUDIO_VOICES_MAX; i++) {
+            AudioVoice *voice = &audioMixer->voices[i];
+            if (!voice->id) { continue; }
+            uint32_t offset = 0;
+            if (voice->startFrame > audioMixer->mixedFrames) {
+                if (voice->stopping) { // stopped before it was ever heard
+                    freeVoice(audioMixer, voice);
+                    continue;
+                }
+                uint64_t wait = voice->startFrame - audioMixer->mixedFrames;
+                if (wait >= blockFrames) { continue; }
+                offset = (uint32_t)wait;
+            }
+            mixVoice(audioMixer, voice, offset, blockFrames - offset);
+        }
+        audioMixer->mixedFrames += blockFrames;
+
+        interleaveSamples(audioMixer->mixBuffer, audioMixer->busLeft, audioMixer->busRight,
+                          blockFrames                                                     );
+        convertSamplesToS16(output, audioMixer->mixBuffer, blockFrames * AUDIO_CHANNELS);
+        output     += blockFrames * AUDIO_CHANNELS;
+        frameCount -= blockFrames;
+    }
+}
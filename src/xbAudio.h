@@ -0,0 +1,132 @@
+#ifndef XBAUDIO_H // include guard begin
+#define XBAUDIO_H // include guard
+
+#include "constants.h"
+#include "xbEngine.h"
+
+#include <stdint.h> // defines fixed size types, C++ version is <cstdint>
+
+//NOTE[ALEX]: game code does not write samples, it starts, changes and stops voices by pushing
+//            commands (see playSound) into a ring that the platform drains on its audio thread;
+//            the audio thread owns the AudioMixer and mixes all voices whenever the queue of the
+//            audio device runs low, so a slow frame no longer leaves a gap in the audio
+//NOTE[ALEX]: sounds are read while they play, so they have to stay valid until their voices
+//            are stopped or have finished
+//NOTE[ALEX]: a streaming voice plays a queue of buffers one after another, more buffers are
+//            queued while it plays; the mixer reports every buffer it is done with as an
+//            AudioEvent (through the ring the other way), only then can the buffer be refilled;
+//            a streaming voice that runs out of buffers plays silence until the next one arrives
+//NOTE[ALEX]: the mixer counts every frame it mixes, that count is the timeline of the AudioClock,
+//            so a voice can start at an exact frame (see playSoundAt) instead of at the start
+//            of whichever mix happens to pick up its command
+
+enum AudioCommandType {
+    AUDIO_COMMAND_PLAY,
+    AUDIO_COMMAND_PLAY_STREAM,  // sound is the first buffer
+    AUDIO_COMMAND_QUEUE_BUFFER, // plays sound after the buffers the stream already has
+    AUDIO_COMMAND_END_STREAM,   // no more buffers, the voice ends after the queued ones
+    AUDIO_COMMAND_UPDATE,       // volume, pan and rate of a playing voice
+    AUDIO_COMMAND_STOP,
+    AUDIO_COMMAND_STOP_ALL,
+};
+
+struct AudioCommand {
+    AudioCommandType  type;
+    uint32_t          voiceID;
+    AudioSound       *sound;  // play and queue only
+    float             volume; // 1 plays the sound at its own level
+    float             pan;    // -1 left, 0 center, 1 right
+    float             rate;   // 1 plays at the original pitch, 2 an octave higher
+    int32_t           loop;   // play only
+    uint64_t          startFrame; // play only, of the mixer, 0 (or a frame already mixed) is now
+};
+
+//NOTE[ALEX]: positions are 32.32 fixed point frames of the sound, gains ramp towards their
+//            target over one mix block, so changing the volume or stopping a voice never clicks
+struct AudioVoice {
+    uint32_t    id;       // 0 if the voice is free
+    AudioSound *sound;
+    uint64_t    position;
+    uint64_t    step;     // per output frame
+    float       gainLeft;
+    float       gainRight;
+    float       targetGainLeft;
+    float       targetGainRight;
+    int32_t     loop;
+    int32_t     stopping; // freed once its gains have ramped down to 0
+    int32_t     streaming;
+    int32_t     streamEnded;
+    AudioSound *buffers[AUDIO_VOICE_BUFFERS_MAX]; // queued after sound, streaming only
+    uint32_t    bufferCount;
+    uint64_t    startFrame;  // silent until the mixer gets there
+};
+
+enum AudioEventType {
+    AUDIO_EVENT_BUFFER_DONE, // the buffer of a streaming voice is not read anymore
+    AUDIO_EVENT_STREAM_DONE, // a streaming voice ended, was stopped or could not be started
+    AUDIO_EVENT_VOICE_DROPPED, // a sound was not started, all voices were playing
+};
+
+struct AudioEvent {
+    AudioEventType  type;
+    uint32_t        voiceID;
+    AudioSound     *sound;
+};
+
+// frames of a sound one block can read, at the fastest rate plus the frame to interpolate to
+#define AUDIO_SOURCE_FRAMES ((uint32_t)(AUDIO_MIX_FRAMES*AUDIO_RATE_MAX) + 2)
+
+//NOTE[ALEX]: voices are mixed into one float bus per channel with the sample kernels
+//            (see xbSample.h), a block of a voice is converted to float, resampled and then
+//            added to the buses with its gain ramp; the buses are only interleaved and
+//            saturated to 16 bit once all voices have been mixed
+// only ever touched by the thread that mixes
+struct AudioMixer {
+    AudioVoice voices[AUDIO_VOICES_MAX];
+    float      busLeft[AUDIO_MIX_FRAMES];
+    float      busRight[AUDIO_MIX_FRAMES];
+    float      sourceLeft[AUDIO_SOURCE_FRAMES];  // the frames of the sound a voice reads
+    float      sourceRight[AUDIO_SOURCE_FRAMES];
+    float      sourceFrames[AUDIO_SOURCE_FRAMES*2]; // stereo sounds before they are split
+    float      resampledLeft[AUDIO_MIX_FRAMES];
+    float      resampledRight[AUDIO_MIX_FRAMES];
+    float      mixBuffer[AUDIO_MIX_FRAMES*AUDIO_CHANNELS]; // interleaved
+    uint32_t   droppedVoices; // started while all voices were playing
+    uint32_t   lateVoices;    // scheduled for a frame that was already mixed, started right away
+    uint64_t   mixedFrames;   // since the mixer started, the next mix starts at this frame
+    AudioEvent events[AUDIO_EVENTS_MAX]; // not passed on by the platform yet
+    uint32_t   eventCount;
+    uint32_t   droppedEvents;
+};
+
+// game side, return the voice (0 if the command ring was full)
+uint32_t playSound(GameSound *gameSound, AudioSound *sound, float volume, float pan,
+                   float rate, int32_t loop                                        );
+// starts at startFrame of the AudioClock, see getAudioClockFrame
+uint32_t playSoundAt(GameSound *gameSound, AudioSound *sound, float volume, float pan,
+                     float rate, int32_t loop, uint64_t startFrame                    );
+int32_t updateSound(GameSound *gameSound, uint32_t voiceID, float volume, float pan, float rate);
+int32_t stopSound(GameSound *gameSound, uint32_t voiceID);
+uint32_t playStream(GameSound *gameSound, AudioSound *firstBuffer, float volume, float pan,
+                    float rate                                                          );
+int32_t queueStreamBuffer(GameSound *gameSound, uint32_t voiceID, AudioSound *buffer);
+int32_t endStream(GameSound *gameSound, uint32_t voiceID);
+
+// the frame the device plays at perfCounter, extrapolated from the last update of the clock,
+// never past the frames that were already mixed
+uint64_t getAudioClockFrame(AudioClock *audioClock, uint64_t perfCounter);
+
+// fills count samples from a table holding one period (plus its first sample again at the end),
+// phase is in frames of the table, returns the phase after the last sample
+float oscillateWavetable(float *destination, uint32_t count, float *table, uint32_t tableFrames,
+                         float phase, float step                                               );
+
+// mixer side
+//NOTE[ALEX]: events that hand a buffer back must never be dropped, so a command is only
+//            applied while events has room for everything the voices still owe plus the
+//            events the command can cause; commands that do not fit wait in their ring
+int32_t hasRoomForAudioCommand(AudioMixer *audioMixer);
+void applyAudioCommand(AudioMixer *audioMixer, AudioCommand *command);
+void mixAudio(AudioMixer *audioMixer, int16_t *output, uint32_t frameCount);
+
+#endif // include guard end
@@ -1,10 +1,31 @@
+#include "xbAsset.h"
+#include "xbAudio.h"
 #include "xbEngine.h"
 #include "xbMath.h"
+#include "xbPixel.h"
+#include "xbRender.h"
+#include "xbSample.h"
+#include "xbStream.h"
 #include "constants.h"
 
 #include <cstdio> // for printf
 #include <math.h> // for sinf
 
+// runs callback over [begin, end) in chunks of grainSize on all threads of the high priority queue
+void parallelFor(WorkQueues *workQueues, int32_t begin, int32_t end, int32_t grainSize,
+                 ParallelForCallback *callback, void *data                          )
+{
+    workQueues->platformParallelFor(workQueues->highPriorityQueue, begin, end, grainSize,
+                                    callback, data                                       );
+}
+
+// temporary memory for the thread running a callback, reset once the callback returns
+MemoryArena *getScratchArena(WorkQueues *workQueues, uint32_t logicalThreadID)
+{
+    xbAssert(logicalThreadID < workQueues->scratchArenaCount);
+    return &workQueues->scratchArenas[logicalThreadID].arena;
+}
+
 // get the position (id) of a specific key in GameInput->keys
 uint32_t getKeyID(ButtonState *buttonState, GameInput *gameInput) {
     uint32_t id = buttonState - &gameInput->keys[0];
@@ -12,7 +33,7 @@ uint32_t getKeyID(ButtonState *buttonState, GameInput *gameInput) {
     return id;
 }
 
-void inputTestDEBUG(GameInput *gameInput, GameBuffer *gameBuffer)
+void inputTestDEBUG(GameInput *gameInput, RenderCommands *renderCommands)
 {
     // mouse test
 #ifdef INPUT_TEST_MOUSE
@@ -80,7 +101,7 @@ void inputTestDEBUG(GameInput *gameInput, GameBuffer *gameBuffer)
         float endX   = startX + keyThickness;
         float startY = cornerOffset + row*keySpacing + row*keyThickness;
         float endY   = startY + keyThickness;
-        drawRectangle(startX, startY, endX, endY, gameBuffer, color);
+        pushRectangle(renderCommands, startX, startY, endX, endY, color);
 #endif
 #ifdef INPUT_TEST_PRESSES
         if (gameInput->keys[i].transitionCount > 1) {
@@ -123,7 +144,7 @@ void inputTestDEBUG(GameInput *gameInput, GameBuffer *gameBuffer)
 }
 
 void textureTestDEBUG(GameInput *gameInput, GameTest *gameTest,
-                      GameBuffer *gameBuffer, GameClocks *gameClocks)
+                      RenderCommands *renderCommands, GameClocks *gameClocks)
 {
     uint32_t scrollSpeed = 8; //NOTE[ALEX]: framerate dependent
     gameTest->offsetX += 
@@ -137,124 +158,200 @@ void textureTestDEBUG(GameInput *gameInput, GameTest *gameTest,
     if (gameInput->d.isDown || gameInput->down.isDown ) { gameTest->offsetY -= scrollSpeed; }
     if (gameInput->e.isDown || gameInput->up.isDown   ) { gameTest->offsetY += scrollSpeed; }
     
-    uint32_t pitch = gameBuffer->width * gameBuffer->bytesPerPixel;
-    uint8_t  *row  = (uint8_t *)gameBuffer->textureMemory;
-    for (int y = 0; y < gameBuffer->height; y++) {
-        uint8_t *pixel = (uint8_t *)row;
-        for (int x = 0; x < gameBuffer->width; x++) {
-            uint8_t value = (uint8_t)y+gameTest->offsetY;
-            if (x % 256 == 0 || y % 256 == 0) { value = 0; }
-            *pixel = value; // blue
-            pixel++;
-            *pixel = value; // green
-            pixel++;
-            *pixel = value; // red
-            pixel++;
-            *pixel = 255; // alpha
-            pixel++;
+    pushGradientDEBUG(renderCommands, gameTest->offsetY);
+}
+
+// checkerboard that follows the scroll offset and fades out to the left
+void bitmapTestDEBUG(GameTest *gameTest, RenderCommands *renderCommands)
+{
+    RenderBitmap *bitmap = &gameTest->testBitmap;
+    if (!bitmap->pixels) {
+        bitmap->width  = TEST_BITMAP_SIZE;
+        bitmap->height = TEST_BITMAP_SIZE;
+        bitmap->pitch  = TEST_BITMAP_SIZE * sizeof(uint32_t);
+        bitmap->pixels = gameTest->testBitmapPixels;
+        bitmap->opaque = false;
+        for (int32_t y = 0; y < bitmap->height; y++) {
+            for (int32_t x = 0; x < bitmap->width; x++) {
+                int32_t  checker = ((x / 16) + (y / 16)) % 2;
+                uint32_t alpha   = 32 + (223 * x) / (TEST_BITMAP_SIZE - 1);
+                uint32_t color   = (alpha << 24) | (checker ? 0xE0E0E0 : 0x2060A0);
+                bitmap->pixels[y * TEST_BITMAP_SIZE + x] = premultiplyColor(color);
+            }
         }
-        row += pitch;
     }
+    pushBitmap(renderCommands, bitmap, 400 + gameTest->offsetX, 400 - gameTest->offsetY);
 }
 
-void audioTestDEBUG(GameInput *gameInput, GameTest *gameTest,
-                    GameSound *gameSound, GameClocks *gameClocks, GameBuffer *gameBuffer)
+// the first bitmaps of the asset pack in a row at the top, drawn straight from the mapping
+void assetTestDEBUG(FileIO *fileIO, GameTest *gameTest, RenderCommands *renderCommands,
+                    MemoryArena *permanentArena                                        )
 {
-    float toneMult = 1.0f - (((float)gameInput->mousePosY) / ((float)gameBuffer->height));
-          toneMult = clampF32(toneMult, 0.0f, 1.0f); // necessary when resizing window
-    float toneHz   = 64.0f + 512.0f * toneMult;
-    gameTest->toneHz = (uint32_t)toneHz;
-
-    gameTest->wavePeriod = AUDIO_SAMPLES_PER_SECOND / gameTest->toneHz;
-    gameTest->halfWavePeriod = gameTest->wavePeriod / 2;
+    if (!gameTest->assetPackLoaded) {
+        gameTest->assetPackLoaded = true;
+        if (   fileIO->assetPackFileName
+            && loadAssetPack(&gameTest->assetPack, fileIO, fileIO->assetPackFileName,
+                             permanentArena                                          )) {
+            AssetPack *assetPack = &gameTest->assetPack;
+            for (uint32_t i = 0;    i < assetPack->assetCount
+                                 && gameTest->assetBitmapCount < ASSET_TEST_BITMAPS_MAX; i++) {
+                RenderBitmap *bitmap = &gameTest->assetBitmaps[gameTest->assetBitmapCount];
+                if (getAssetBitmap(assetPack, &assetPack->entries[i], bitmap)) {
+                    gameTest->assetBitmapCount++;
+                }
+            }
+        }
+    }
 
-    // if the framerate drops, the audio gets choppy
-    gameSound->audioToQueueBytes = gameSound->targetQueuedBytes - gameSound->queuedBytes;
-    if (gameSound->audioToQueueBytes > sizeof(gameSound->audioToQueue)) {
-        printf("%s out of bounds of audioToQueue\n", __FUNCTION__);
+    //NOTE[ALEX]: the bitmaps have to outlive the frame, render commands only point to them
+    int32_t x = 16;
+    for (uint32_t i = 0; i < gameTest->assetBitmapCount; i++) {
+        pushBitmap(renderCommands, &gameTest->assetBitmaps[i], x, 16);
+        x += gameTest->assetBitmaps[i].width + 16;
     }
+}
 
-    if (gameSound->audioToQueueBytes) {
-        int16_t *sampleOut   = gameSound->audioToQueue;
-        uint32_t sampleCount =   gameSound->audioToQueueBytes
-                               /(gameSound->bytesPerSamplePerChannel*AUDIO_CHANNELS);
+// a looping tone that follows the mouse (pitch by height, pan by side) and a blip for every key
+//NOTE[ALEX]: only the single period of the tone is computed with sinf, the blip reads it as a
+//            wavetable (see oscillateWavetable) and the looping tone voice does the same in the
+//            mixer, at whatever pitch it is played
+void audioTestDEBUG(GameInput *gameInput, GameTest *gameTest, GameSound *gameSound,
+                    GameBuffer *gameBuffer, GameClocks *gameClocks, MemoryArena *frameArena)
+{
+    if (!gameTest->toneSound.samples) {
+        TemporaryMemory tableMemory = beginTemporaryMemory(frameArena);
+        float *table = pushArray(frameArena, AUDIO_TEST_TONE_FRAMES + 1, float);
+        for (uint32_t i = 0; i < AUDIO_TEST_TONE_FRAMES; i++) {
+            float t = 2.0f*PI32 * (float)i / (float)AUDIO_TEST_TONE_FRAMES;
+            table[i] = 32767.0f * sinf(t);
+        }
+        table[AUDIO_TEST_TONE_FRAMES] = table[0];
+        gameTest->toneSound.samples      = gameTest->toneSamples;
+        gameTest->toneSound.frameCount   = AUDIO_TEST_TONE_FRAMES;
+        gameTest->toneSound.channelCount = 1;
+        convertSamplesToS16(gameTest->toneSamples, table, AUDIO_TEST_TONE_FRAMES);
 
-        for (uint32_t i = 0; i < sampleCount; i++) {
-            int16_t sampleValue = gameTest->toneVolume;
+        float *blip = pushArray(frameArena, AUDIO_TEST_BLIP_FRAMES, float);
+        float  step = 440.0f * (float)AUDIO_TEST_TONE_FRAMES / (float)AUDIO_SAMPLES_PER_SECOND;
+        oscillateWavetable(blip, AUDIO_TEST_BLIP_FRAMES, table, AUDIO_TEST_TONE_FRAMES,
+                           0.0f, step                                                  );
+        for (uint32_t i = 0; i < AUDIO_TEST_BLIP_FRAMES; i++) {
+            float decay = 1.0f - (float)i / (float)AUDIO_TEST_BLIP_FRAMES;
+            blip[i] *= decay * decay;
+        }
+        gameTest->blipSound.samples      = gameTest->blipSamples;
+        gameTest->blipSound.frameCount   = AUDIO_TEST_BLIP_FRAMES;
+        gameTest->blipSound.channelCount = 1;
+        convertSamplesToS16(gameTest->blipSamples, blip, AUDIO_TEST_BLIP_FRAMES);
+        endTemporaryMemory(tableMemory);
+    }
 
-            gameTest->tWave += 2.0f*PI32 *(1.0f / (float)gameTest->wavePeriod);
-            if (gameTest->tWave > 2.0f*PI32) {
-                gameTest->tWave -= 2.0f*PI32;
-            }
-            float sineValue = sinf(gameTest->tWave);
-            sampleValue *= sineValue;
+    float toneMult = 1.0f - (((float)gameInput->mousePosY) / ((float)gameBuffer->height));
+          toneMult = clampF32(toneMult, 0.0f, 1.0f); // necessary when resizing window
+    gameTest->toneHz = 64.0f + 512.0f * toneMult;
+    float toneRate = gameTest->toneHz * (float)AUDIO_TEST_TONE_FRAMES
+                                      / (float)AUDIO_SAMPLES_PER_SECOND;
+    float tonePan  = clampF32(2.0f * (float)gameInput->mousePosX / (float)gameBuffer->width - 1.0f,
+                              -1.0f, 1.0f                                                         );
+    if (!gameTest->toneVoiceID) {
+        gameTest->toneVoiceID = playSound(gameSound, &gameTest->toneSound, gameTest->toneVolume,
+                                          tonePan, toneRate, true                             );
+    } else {
+        updateSound(gameSound, gameTest->toneVoiceID, gameTest->toneVolume, tonePan, toneRate);
+    }
+
+    //NOTE[ALEX]: blips start a fixed time after the start of the frame their key press belongs
+    //            to instead of whenever the mixer picks up the command, so the time from a frame
+    //            to its sounds stays the same however frames and top ups of the queue line up
+    AudioClock audioClock = {};
+    gameSound->platformGetAudioClock(gameSound->platformAudio, &audioClock);
+    uint64_t blipFrame = getAudioClockFrame(&audioClock, gameClocks->lastPerfCounter)
+                         + audioClock.leadFrames
+                         + AUDIO_SCHEDULE_MARGIN_MS * AUDIO_SAMPLES_PER_SECOND / 1000;
 
-            gameTest->runningSampleIndex++;
-            for (uint32_t j = 0; j < AUDIO_CHANNELS; j++) {
-                *sampleOut = sampleValue;
-                sampleOut++;
+    // keys further right on the keyboard play higher and further to the right
+    uint32_t keyCount = sizeof(gameInput->keys)/sizeof(gameInput->keys[0]);
+    for (uint32_t i = 0; i < keyCount; i++) {
+        ButtonState *key = &gameInput->keys[i];
+        if (key->isDown && key->transitionCount) {
+            float keyMult = (float)i / (float)(keyCount - 1);
+            float pan     = 2.0f * keyMult - 1.0f;
+            float rate    = 0.5f + 1.5f * keyMult;
+            //NOTE[ALEX]: there is no clock before the first top up, blipFrame would already be
+            //            in the past and the blip would count as late, so it just plays now
+            if (audioClock.perfCountFrequency) {
+                playSoundAt(gameSound, &gameTest->blipSound, 0.1f, pan, rate, false, blipFrame);
+            } else {
+                playSound(gameSound, &gameTest->blipSound, 0.1f, pan, rate, false);
             }
-            
         }
     }
-
-    // printf("target: %u, currently queued: %u, to queue: %u, time last frame: %.04fms\n",
-    //        gameSound->targetQueuedBytes, gameSound->queuedBytes,
-    //        gameSound->audioToQueueBytes, gameClocks->msLastFrame                        );
 }
 
-void mouseTestDEBUG(GameInput *gameInput, GameBuffer *gameBuffer)
+//NOTE[ALEX]: events have to be taken every frame even without music, the ring is shared by
+//            all voices and the mixer drops events while it is full
+void audioEventTestDEBUG(GameTest *gameTest, GameSound *gameSound)
 {
-    float colorMult = ((float)gameInput->mousePosY) / ((float)gameBuffer->height);
-    uint8_t red   = lerpU8(0x00, 0xFF, colorMult);
-    uint8_t green = lerpU8(0x00, 0xFF, 1.0f-colorMult);
-    uint32_t mouseVisColor = 0xFF000000 | (red << 16) | (green << 8); // AARRGGBB
-    
-    float rectThickness = 10.0f;
-    drawRectangle(gameInput->mousePosX - rectThickness, gameInput->mousePosY - rectThickness,
-                  gameInput->mousePosX + rectThickness, gameInput->mousePosY + rectThickness,
-                  gameBuffer, mouseVisColor);
+    AudioEvent event = {};
+    while (gameSound->platformPopAudioEvent(gameSound->platformAudio, &event)) {
+        if (   event.type == AUDIO_EVENT_VOICE_DROPPED
+            && event.voiceID == gameTest->toneVoiceID) {
+            gameTest->toneVoiceID = 0; // the tone tries to play again this frame
+        } else if (gameTest->music) {
+            handleAudioStreamEvent(gameTest->music, &event);
+        }
+    }
 }
 
-// will draw a rectangle between rounded pixel coordinates in specified color
-// will draw from start pixel coordinates up to but not including end pixel coordinates
-// this should allow to draw perfectly touching rectangles even considering sub pixel positioning
-void drawRectangle(float startXF, float startYF, float endXF, float endYF,
-                   GameBuffer *gameBuffer, uint32_t color                 )
+// loops the music file (--music) for as long as the game runs
+//NOTE[ALEX]: the stream stays in the arena until the game exits, if the file cannot be opened
+//            the memory is given back and there is just no music
+void musicTestDEBUG(GameTest *gameTest, GameSound *gameSound, FileIO *fileIO,
+                    WorkQueues *workQueues, MemoryArena *transientArena     )
 {
-    int32_t startX = roundF32toI32(startXF);
-    int32_t startY = roundF32toI32(startYF);
-    int32_t endX   = roundF32toI32(endXF);
-    int32_t endY   = roundF32toI32(endYF);
-
-    //NOTE[ALEX]: true clamping is not required, as the for loop takes care of the remaining cases
-    startX = maxI32(startX, 0.0f);
-    startY = maxI32(startY, 0.0f);
-    endX   = minI32(endX, (float)gameBuffer->width);
-    endY   = minI32(endY, (float)gameBuffer->height);
-
-    // printf("%s from (%i, %i) to (%i, %i)\n", __FUNCTION__, startX, startY, endX, endY);
-
-    uint8_t *row = (uint8_t *)gameBuffer->textureMemory
-                     + startX * gameBuffer->bytesPerPixel
-                     + startY * gameBuffer->pitch;
-    for (int j = startY; j < endY; j++) {
-        uint32_t *pixel = (uint32_t *)row;
-        for (int i = startX; i < endX; i++) {
-            *pixel = color;
-            pixel++;
+    if (!gameTest->musicOpened) {
+        gameTest->musicOpened = true;
+        TemporaryMemory streamMemory = beginTemporaryMemory(transientArena);
+        AudioStream *music = pushStruct(transientArena, AudioStream);
+        if (openAudioStream(music, fileIO, fileIO->musicFileName, 0.25f, true)) {
+            gameTest->music = music;
+            keepTemporaryMemory(streamMemory);
+        } else {
+            endTemporaryMemory(streamMemory);
         }
-        row += gameBuffer->pitch;
+    }
+
+    if (gameTest->music) {
+        updateAudioStream(gameTest->music, gameSound, workQueues);
     }
 }
 
+void mouseTestDEBUG(GameInput *gameInput, RenderTarget *renderTarget,
+                    RenderCommands *renderCommands                       )
+{
+    float mouseX = 0.0f;
+    float mouseY = 0.0f;
+    mapToRenderTarget(renderTarget, gameInput->mousePosX, gameInput->mousePosY, &mouseX, &mouseY);
+    float colorMult = clampF32(mouseY / (float)renderCommands->height, 0.0f, 1.0f);
+    uint8_t red   = lerpU8(0x00, 0xFF, colorMult);
+    uint8_t green = lerpU8(0x00, 0xFF, 1.0f-colorMult);
+    uint32_t mouseVisColor = 0xC0000000 | (red << 16) | (green << 8); // AARRGGBB
+    
+    float rectThickness = 10.5f; // fractional edges get blended by coverage
+    pushRectangle(renderCommands, mouseX - rectThickness, mouseY - rectThickness,
+                  mouseX + rectThickness, mouseY + rectThickness, mouseVisColor);
+}
+
 void gameUpdate(GameState *gameState, GameTest *gameTest)
 {
-    GameGlobal *gameGlobal = &gameState->gameGlobal;
-    GameInput  *gameInput  = &gameState->gameInput;
-    GameClocks *gameClocks = &gameState->gameClocks;
-    GameBuffer *gameBuffer = &gameState->gameBuffer;
-    GameSound  *gameSound  = &gameState->gameSound;
+    GameGlobal   *gameGlobal   = &gameState->gameGlobal;
+    GameInput    *gameInput    = &gameState->gameInput;
+    GameClocks   *gameClocks   = &gameState->gameClocks;
+    GameBuffer   *gameBuffer   = &gameState->gameBuffer;
+    GameSound    *gameSound    = &gameState->gameSound;
+    WorkQueues   *workQueues   = &gameState->workQueues;
+    RenderTarget *renderTarget = &gameState->renderTarget;
+    MemoryArena  *frameArena   = &gameState->gameMemory->frameArena;
 
     if (gameInput->esc.transitionCount > 1) {
         gameInput->esc.transitionCount %= 2;
@@ -262,13 +359,34 @@ void gameUpdate(GameState *gameState, GameTest *gameTest)
         return;
     }
 
-    textureTestDEBUG(gameInput, gameTest, gameBuffer, gameClocks);
+    //NOTE[ALEX]: audio only pushes commands for the mixer, the samples get mixed on the audio
+    //            thread of the platform
+    audioEventTestDEBUG(gameTest, gameSound);
+    audioTestDEBUG(gameInput, gameTest, gameSound, gameBuffer, gameClocks, frameArena);
+    musicTestDEBUG(gameTest, gameSound, &gameState->fileIO, workQueues,
+                   &gameState->gameMemory->transientArena          );
+
+    //NOTE[ALEX]: drawing only records commands, the GameBuffer is written once all of them
+    //            are known, tile by tile on all threads; at a lower render resolution the
+    //            frame is rendered into the RenderTarget and upscaled into the GameBuffer
+    updateRenderScale(renderTarget, gameClocks, gameGlobal->targetTimePerFrame);
+    GameBuffer *renderBuffer = beginRenderTarget(renderTarget, gameBuffer);
+    RenderCommands *renderCommands = beginRenderCommands(frameArena, renderBuffer,
+                                                         RENDER_COMMANDS_MAX      );
+
+    textureTestDEBUG(gameInput, gameTest, renderCommands, gameClocks);
+
+    bitmapTestDEBUG(gameTest, renderCommands);
+
+    assetTestDEBUG(&gameState->fileIO, gameTest, renderCommands,
+                   &gameState->gameMemory->permanentArena       );
 
-    inputTestDEBUG(gameInput, gameBuffer);
+    inputTestDEBUG(gameInput, renderCommands);
 
-    audioTestDEBUG(gameInput, gameTest, gameSound, gameClocks, gameBuffer);
+    mouseTestDEBUG(gameInput, renderTarget, renderCommands);
 
-    mouseTestDEBUG(gameInput, gameBuffer);
+    executeRenderCommands(renderCommands, renderBuffer, workQueues, frameArena);
+    endRenderTarget(renderTarget, gameBuffer, workQueues, frameArena);
 
     gameGlobal->gameFrame++;
 }
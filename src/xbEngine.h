@@ -2,15 +2,21 @@
 #define XBENGINE_H // include guard
 
 #include "constants.h"
+#include "xbMemory.h"
 
 #include <stdint.h> // defines fixed size types, C++ version is <cstdint>
 
+//NOTE[ALEX]: all memory of the engine comes from these two pools through the arenas,
+//            the frame arena is part of transient memory and gets reset at the start of a frame
 struct GameMemory {
     uint8_t   initialized;
     uint64_t  permanentMemSize;
     void     *permanentMem;
     uint64_t  transientMemSize;
     void     *transientMem;
+    MemoryArena permanentArena; // lives as long as the program
+    MemoryArena transientArena; // can be reset when the game state gets rebuilt
+    MemoryArena frameArena;     // only valid until the end of the frame
 };
 
 // PERMANENT MEMORY
@@ -247,29 +253,145 @@ struct GameClocks {
     float msLastFrame;
     float msLastFrameCPU; // without main loop waiting
 
+    //NOTE[ALEX]: SDL only renders on the main thread, so a frame is uploaded and presented right
+    //            after it was submitted, before the next frame starts
+    float msPresentLastFrame;       // texture upload and present
+    float msWaitForBackBuffer;      // getting the next backbuffer ready (resizing its memory)
+    float msSubmitToPresent;        // submit until presented, the present time plus the clipping
+    float mbCopiedLastFrame;        // by the present path (0 if rendered into texture memory)
+    float presentedFramesPerSecond; // frames submitted and presented, about once per second
+
     uint64_t lastCycleCount;
     uint64_t endCycleCount;
     uint64_t elapsedCycleCount;
 };
 
+struct GameRect {
+    int32_t startX;
+    int32_t startY;
+    int32_t endX; // not included
+    int32_t endY;
+};
+
+//NOTE[ALEX]: textureMemory points to a different buffer of the platform's present ring every
+//            frame (possibly straight into texture memory), sized to the window, rows start
+//            pitch bytes apart (which can be larger than width*bytesPerPixel, it is aligned for
+//            SIMD loads and cache lines unless the texture memory of the platform is used);
+//            the renderer only rasterizes tiles that differ from what textureMemory already
+//            holds (if keepsContents is set), the platform keeps tileHashes for every buffer of
+//            its ring; dirtyRects are the regions that were rasterized, so only those have to
+//            be uploaded, frameChanged is 0 if the frame looks exactly like the previous one
 struct GameBuffer {
     void     *platformWindow;
     int       width;
     int       height;
     uint32_t  bytesPerPixel;
     uint32_t  pitch;
-    void     *platformTexture;
-    //NOTE[ALEX]: for an uncompressed 4K texture with 4 bytes per pixel,
-    //            the allocated memory is about 32mb
-    uint8_t   textureMemory[GAMEBUFFER_BYTES_PER_PIXEL*WINDOW_MAX_WIDTH*WINDOW_MAX_HEIGHT];
+    void     *textureMemory;
+    // set by the platform
+    uint64_t *tileHashes;     // of what textureMemory holds, 0 if not tracked
+    uint32_t  tileHashCount;  // capacity of tileHashes
+    int32_t   keepsContents;  // textureMemory still holds what was rendered into it last time
+    int32_t   windowDamaged;  // the window has to be presented again even if nothing changed
+    // set by the renderer
+    GameRect  dirtyRects[DIRTY_RECTS_MAX];
+    uint32_t  dirtyRectCount;
+    int32_t   frameChanged;
+    uint64_t  lastFrameHash;
+};
+
+//NOTE[ALEX]: pixels are 32 bit AARRGGBB (like the GameBuffer), rows start pitch bytes apart,
+//            color channels are premultiplied with alpha
+struct RenderBitmap {
+    int32_t   width;
+    int32_t   height;
+    uint32_t  pitch;
+    uint32_t *pixels;
+    int32_t   opaque; // all pixels have an alpha of 255, so they are copied instead of blended
+};
+
+enum UpscaleFilter {
+    UPSCALE_FILTER_NEAREST,
+    UPSCALE_FILTER_INTEGER,  // nearest by the largest whole factor that fits, centered
+    UPSCALE_FILTER_BILINEAR,
+    UPSCALE_FILTER_COUNT
+};
+
+//NOTE[ALEX]: the game can render at a lower resolution than the window, the frame then gets
+//            rendered into gameBuffer of the RenderTarget (which keeps its contents, so only
+//            changed tiles are rasterized) and upscaled into the GameBuffer afterwards;
+//            the resolution is either fixed or a scale of the window size, which can be
+//            adjusted every frame to hold the target frame time (dynamicResolution)
+struct RenderTarget {
+    // set by the platform at startup
+    int32_t       fixedWidth;  // 0 to follow the window size
+    int32_t       fixedHeight;
+    float         scale;       // of the window size, 1 renders straight into the GameBuffer
+    UpscaleFilter filter;
+    int32_t       dynamicResolution;
+    MemoryArena   arena;       // holds the pixels, large enough for the largest window
+    // internal
+    GameBuffer    gameBuffer;
+    uint64_t      tileHashes[RENDER_TILE_COUNT_MAX];
+    GameRect      viewport;    // where the upscaled frame ends up in the GameBuffer
+    int32_t       active;      // the current frame gets rendered into gameBuffer
+    float         msFrameCPUSum; // since the scale was last adjusted
+    uint32_t      frameCPUCount;
+};
+
+// 16 bit samples at AUDIO_SAMPLES_PER_SECOND, channelCount of them per frame (interleaved)
+struct AudioSound {
+    int16_t  *samples;
+    uint32_t  frameCount;
+    uint32_t  channelCount; // 1 or 2
+};
+
+struct AudioStream; // see xbStream.h
+
+//NOTE[ALEX]: frames of the mixer (see AudioMixer::mixedFrames), the device position is measured
+//            on the audio thread at every top up as the frames mixed minus the frames still
+//            queued and smoothed, between two top ups it is extrapolated with perfCounter
+struct AudioClock {
+    uint64_t playedFrame;        // being played by the device at perfCounter
+    uint64_t perfCounter;
+    uint64_t perfCountFrequency; // 0 until the clock was first measured
+    uint64_t mixedFrame;         // everything before this frame was mixed already
+    uint32_t leadFrames;         // sounds starting this far past playedFrame are mixed in time
 };
 
+struct PlatformAudio; //NOTE[ALEX]: blind struct to avoid including the platform header
+struct AudioCommand;
+struct AudioEvent;
+typedef int32_t PlatformPushAudioCommand(PlatformAudio *platformAudio, AudioCommand *command);
+typedef int32_t PlatformPopAudioEvent(PlatformAudio *platformAudio, AudioEvent *event);
+typedef void PlatformGetAudioClock(PlatformAudio *platformAudio, AudioClock *audioClock);
+
+//NOTE[ALEX]: the samples get mixed and queued on the audio thread of the platform, game code
+//            only pushes commands for the mixer (see xbAudio.h)
 struct GameSound {
     uint16_t bytesPerSamplePerChannel;
     int16_t  audioToQueue[AUDIO_MAX_LATENCY_SECONDS*AUDIO_SAMPLES_PER_SECOND*AUDIO_CHANNELS];
     uint32_t audioToQueueBytes; // how many new bytes to queue up
     uint32_t queuedBytes;       // how many bytes are currently queued up
     uint32_t targetQueuedBytes; // controls latency (how many bytes to queue up at most)
+    PlatformAudio            *platformAudio;
+    PlatformPushAudioCommand *platformPushAudioCommand;
+    PlatformPopAudioEvent    *platformPopAudioEvent;
+    PlatformGetAudioClock    *platformGetAudioClock;
+    uint32_t                  nextVoiceID; // only used by the game
+};
+
+//NOTE[ALEX]: kept by the latency controller of the audio thread, bucket i of the histograms
+//            counts [i, i + 1) * AUDIO_LATENCY_BUCKET_MS of latency
+struct AudioLatencyStats {
+    float    msTarget;            // queued audio the controller aims for right now
+    float    msTargetMin;         // since startup
+    float    msTargetMax;
+    float    msIntervalAverage;   // between two top ups of the queue
+    float    msIntervalDeviation;
+    uint32_t underruns;           // the queue ran dry, since startup
+    uint32_t latencyHistogram[AUDIO_LATENCY_BUCKETS];  // queued audio at every top up
+    uint32_t underrunHistogram[AUDIO_LATENCY_BUCKETS]; // target at every underrun
 };
 
 struct PlatformWorkQueue; //NOTE[ALEX]: blind struct to avoid including the platform header
@@ -277,21 +399,116 @@ typedef void PlatformWorkQueueCallback(void *data, uint32_t logicalThreadID);
 typedef int32_t PlatformAddWork(PlatformWorkQueue *platformQueue,
                                 PlatformWorkQueueCallback *callback, void *data);
 typedef void PlatformCompleteWork(PlatformWorkQueue *platformQueue, uint32_t logicalThreadID);
+//NOTE[ALEX]: work can signal one of the WORK_COUNTERS counters, the counter is raised when the
+//            work is added and lowered when it completes; work that waits on a counter is only
+//            queued once that counter is back at zero, so groups of work can be chained
+typedef int32_t PlatformAddDependentWork(PlatformWorkQueue *platformQueue, uint32_t waitCounter,
+                                         uint32_t signalCounter,
+                                         PlatformWorkQueueCallback *callback, void *data    );
+typedef void PlatformWaitForCounter(PlatformWorkQueue *platformQueue, uint32_t counter,
+                                    uint32_t logicalThreadID                           );
+// how much work signaling the counter is still queued or running, without waiting for it;
+// once this is 0 everything that work wrote is visible to the caller
+typedef uint32_t PlatformGetWorkCounter(PlatformWorkQueue *platformQueue, uint32_t counter);
+
+struct WorkQueueStats {
+    uint32_t depth;              // entries that are queued, held or running
+    uint64_t entriesCompleted;   // since the stats were read the last time
+    float    msWaitAverage;      // from queuing an entry until it starts
+    float    msWaitMax;          // since startup
+    float    msExecutionAverage;
+};
+typedef void PlatformGetWorkQueueStats(PlatformWorkQueue *platformQueue, WorkQueueStats *stats);
+
+//NOTE[ALEX]: splits [begin, end) into chunks of grainSize that get processed by all threads,
+//            the calling thread takes part and only returns once the whole range is done
+typedef void ParallelForCallback(void *data, int32_t begin, int32_t end, uint32_t logicalThreadID);
+typedef void PlatformParallelFor(PlatformWorkQueue *platformQueue, int32_t begin, int32_t end,
+                                 int32_t grainSize, ParallelForCallback *callback, void *data);
+
+// counters with a fixed meaning, all counters after these are free to use
+enum WorkCounterName {
+    WORK_COUNTER_UPDATE,
+    WORK_COUNTER_RENDER,
+    WORK_COUNTER_AUDIO,
+    WORK_COUNTER_NAMED_COUNT,
+};
 
+//NOTE[ALEX]: worker threads always drain the high priority queue before picking up low
+//            priority work, only the high priority queue is expected to complete every frame
+//NOTE[ALEX]: a callback can allocate temporary memory from the scratch arena of the thread
+//            running it, everything it pushed is given back when the callback returns,
+//            the main thread's arena (0) is also reset at the start of every frame
 struct WorkQueues {
-    PlatformWorkQueue *workQueue; //NOTE[ALEX]: there could be multiple of these with
-                                  //            different priorities
-    PlatformAddWork      *platformAddWork;
-    PlatformCompleteWork *platformCompleteWork;
+    PlatformWorkQueue *highPriorityQueue; // frame critical work
+    PlatformWorkQueue *lowPriorityQueue;  // background work that may span frames (asset decoding)
+    ScratchArena      *scratchArenas;     // one per logicalThreadID
+    uint32_t           scratchArenaCount;
+    uint32_t           workerCount;       // 0: low priority work is never picked up
+    PlatformAddWork           *platformAddWork;
+    PlatformAddDependentWork  *platformAddDependentWork;
+    PlatformCompleteWork      *platformCompleteWork;
+    PlatformWaitForCounter    *platformWaitForCounter;
+    PlatformGetWorkCounter    *platformGetWorkCounter;
+    PlatformGetWorkQueueStats *platformGetWorkQueueStats;
+    PlatformParallelFor       *platformParallelFor;
+};
+
+//NOTE[ALEX]: files are mapped read-only into the address space, pages get read from disk when
+//            they are first touched, the memory stays valid until the file is unmapped;
+//            platforms without mapping read the file into the arena, so it has to outlive the
+//            file
+struct PlatformMappedFile {
+    void     *memory;
+    uint64_t  size;
+};
+typedef int32_t PlatformMapFile(const char *fileName, MemoryArena *arena,
+                                PlatformMappedFile *mappedFile          );
+typedef void PlatformUnmapFile(PlatformMappedFile *mappedFile);
+
+//NOTE[ALEX]: for files that are read piece by piece (streaming), reads at an offset do not share
+//            a file position, so any thread can read from the same open file at the same time
+struct PlatformFile {
+    uint64_t  size;
+    int32_t   handle;
+    int32_t   isOpen;
+    void     *stream;     // without reads at an offset: read through one stream...
+    void     *streamLock; // ...that one thread at a time seeks and reads
+};
+typedef int32_t PlatformOpenFile(const char *fileName, PlatformFile *file);
+// returns the bytes read, less than size only at the end of the file or on an error
+typedef uint32_t PlatformReadFile(PlatformFile *file, uint64_t offset, void *memory,
+                                  uint32_t size                                     );
+typedef void PlatformCloseFile(PlatformFile *file);
+
+struct FileIO {
+    const char        *assetPackFileName; // set by the platform, 0 if there is none
+    const char        *musicFileName;
+    PlatformMapFile   *platformMapFile;
+    PlatformUnmapFile *platformUnmapFile;
+    PlatformOpenFile  *platformOpenFile;
+    PlatformReadFile  *platformReadFile;
+    PlatformCloseFile *platformCloseFile;
+};
+
+struct AssetPackEntry;
+// a memory-mapped asset pack (see xbAsset.h)
+struct AssetPack {
+    PlatformMappedFile  file;
+    AssetPackEntry     *entries; // sorted by name
+    uint32_t            assetCount;
 };
 
 struct GameState {
-    GameGlobal gameGlobal;
-    GameInput  gameInput;
-    GameClocks gameClocks;
-    GameBuffer gameBuffer;
-    GameSound  gameSound;
-    WorkQueues workQueues;
+    GameMemory   *gameMemory;
+    GameGlobal   gameGlobal;
+    GameInput    gameInput;
+    GameClocks   gameClocks;
+    GameBuffer   gameBuffer;
+    GameSound    gameSound;
+    WorkQueues   workQueues;
+    RenderTarget renderTarget;
+    FileIO       fileIO;
 };
 
 // TRANSIENT MEMORY
@@ -300,19 +517,32 @@ struct GameTest {
     // gradient background
     int32_t  offsetX;
     int32_t  offsetY;
-    // audio sine wave
-    float    tWave;
-    uint32_t runningSampleIndex;
-    uint32_t toneHz;
-    uint32_t toneVolume;
-    uint32_t wavePeriod;
-    uint32_t halfWavePeriod;
+    // audio voices, the sounds are set up on first use
+    float        toneHz;
+    float        toneVolume;
+    uint32_t     toneVoiceID; // loops the whole time
+    AudioSound   toneSound;   // one period of a sine
+    int16_t      toneSamples[AUDIO_TEST_TONE_FRAMES];
+    AudioSound   blipSound;   // decaying sine, played for every key press
+    int16_t      blipSamples[AUDIO_TEST_BLIP_FRAMES];
+    AudioStream *music;       // streamed from disk, 0 if there is none
+    int32_t      musicOpened; // tried once
+    // bitmap
+    RenderBitmap testBitmap; // set up on first use
+    uint32_t     testBitmapPixels[TEST_BITMAP_SIZE*TEST_BITMAP_SIZE];
+    // asset pack
+    AssetPack    assetPack;
+    int32_t      assetPackLoaded; // tried once, assetPack.file.memory is 0 if it failed
+    RenderBitmap assetBitmaps[ASSET_TEST_BITMAPS_MAX]; // point into the mapped pack
+    uint32_t     assetBitmapCount;
 };
 
 void gameUpdate(GameState *gameState, GameTest *gameTest);
 
-void drawRectangle(float startXF, float startYF, float endXF, float endYF,
-                   GameBuffer *gameBuffer, uint32_t color                 );
+void parallelFor(WorkQueues *workQueues, int32_t begin, int32_t end, int32_t grainSize,
+                 ParallelForCallback *callback, void *data                          );
+MemoryArena *getScratchArena(WorkQueues *workQueues, uint32_t logicalThreadID);
+
 uint32_t getKeyID(ButtonState *buttonState, GameInput *gameInput);
 
 #endif // include guard end
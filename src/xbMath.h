@@ -25,6 +25,20 @@ inline uint32_t roundF32toU32(float value)
     return (uint32_t)value;
 }
 
+inline int32_t floorF32toI32(float value)
+{
+    int32_t result = (int32_t)value;
+    if ((float)result > value) { result--; }
+    return result;
+}
+
+inline int32_t ceilF32toI32(float value)
+{
+    int32_t result = (int32_t)value;
+    if ((float)result < value) { result++; }
+    return result;
+}
+
 inline int32_t minI32(int32_t a, int32_t b)
 {
     if (a < b) { return a; }
@@ -43,6 +57,12 @@ inline uint8_t maxU8(uint8_t a, uint8_t b)
     else       { return b; }
 }
 
+inline uint64_t minU64(uint64_t a, uint64_t b)
+{
+    if (a < b) { return a; }
+    else       { return b; }
+}
+
 inline float minF32(float a, float b)
 {
     if (a < b) { return a; }
@@ -62,6 +82,20 @@ inline float clampF32(float value, float min, float max)
     return value;
 }
 
+inline int32_t clampI32(int32_t value, int32_t min, int32_t max)
+{
+    value = minI32(value, max);
+    value = maxI32(value, min);
+    return value;
+}
+
+// rounds value up to the next multiple of alignment, which has to be a power of 2
+inline uint32_t alignPow2U32(uint32_t value, uint32_t alignment)
+{
+    xbAssert((alignment & (alignment - 1)) == 0);
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
 inline uint8_t lerpU8(uint8_t a, uint8_t b, float t)
 {
     t = clampF32(t, 0.0f, 1.0f);
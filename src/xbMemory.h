@@ -0,0 +1,137 @@
+#ifndef XBMEMORY_H // include guard begin
+#define XBMEMORY_H // include guard
+
+#include "constants.h"
+
+#include <stdint.h> // defines fixed size types, C++ version is <cstdint>
+
+//NOTE[ALEX]: arenas hand out memory from a block that is owned by someone else (usually one of
+//            the GameMemory pools), memory is only ever given back by popping it in reverse
+//            order, by ending a temporary memory scope or by resetting the whole arena;
+//            an arena is not thread safe, every thread needs its own or has to lock around it
+struct MemoryArena {
+    uint8_t  *base;
+    uint64_t  size;
+    uint64_t  used;
+    uint64_t  highWaterMark; // most memory that was ever used at once
+    uint32_t  temporaryCount; // open temporary memory scopes
+};
+
+struct TemporaryMemory {
+    MemoryArena *arena;
+    uint64_t     used;
+};
+
+//NOTE[ALEX]: every thread that processes work owns one of these (indexed by logicalThreadID),
+//            padded so that threads bumping their own arena do not share a cache line
+struct ScratchArena {
+    MemoryArena arena;
+    uint8_t     padding[CACHE_LINE_SIZE - sizeof(MemoryArena)];
+};
+
+inline void initializeArena(MemoryArena *arena, void *base, uint64_t size)
+{
+    arena->base           = (uint8_t *)base;
+    arena->size           = size;
+    arena->used           = 0;
+    arena->highWaterMark  = 0;
+    arena->temporaryCount = 0;
+}
+
+// alignment has to be a power of 2
+inline uint64_t getAlignmentOffset(MemoryArena *arena, uint64_t alignment)
+{
+    xbAssert((alignment & (alignment - 1)) == 0);
+    uint64_t address = (uint64_t)(arena->base + arena->used);
+    return (alignment - (address & (alignment - 1))) & (alignment - 1);
+}
+
+inline uint64_t getArenaSizeRemaining(MemoryArena *arena,
+                                      uint64_t alignment = MEMORY_DEFAULT_ALIGNMENT)
+{
+    uint64_t alignmentOffset = getAlignmentOffset(arena, alignment);
+    if (arena->used + alignmentOffset > arena->size) { return 0; }
+    return arena->size - arena->used - alignmentOffset;
+}
+
+//NOTE[ALEX]: memory is not cleared, pools start out as zero, so memory from an arena that was
+//            never popped or reset is zero as well, use zeroSize otherwise
+inline void *pushSize(MemoryArena *arena, uint64_t size,
+                      uint64_t alignment = MEMORY_DEFAULT_ALIGNMENT)
+{
+    uint64_t alignmentOffset = getAlignmentOffset(arena, alignment);
+    xbAssert(arena->used + alignmentOffset + size <= arena->size);
+
+    void *result = arena->base + arena->used + alignmentOffset;
+    arena->used += alignmentOffset + size;
+    if (arena->used > arena->highWaterMark) {
+        arena->highWaterMark = arena->used;
+    }
+
+    return result;
+}
+
+#define pushStruct(arena, type, ...) (type *)pushSize(arena, sizeof(type), ##__VA_ARGS__)
+#define pushArray(arena, count, type, ...) \
+    (type *)pushSize(arena, (count)*sizeof(type), ##__VA_ARGS__)
+
+// gives back the last size bytes that were pushed (not including alignment padding)
+inline void popSize(MemoryArena *arena, uint64_t size)
+{
+    xbAssert(size <= arena->used);
+    arena->used -= size;
+}
+
+inline void zeroSize(void *memory, uint64_t size)
+{
+    uint8_t *byte = (uint8_t *)memory;
+    while (size--) { *byte++ = 0; }
+}
+
+// carves a new arena out of an existing one, the memory stays with the new arena
+inline void subArena(MemoryArena *result, MemoryArena *arena, uint64_t size,
+                     uint64_t alignment = MEMORY_DEFAULT_ALIGNMENT          )
+{
+    initializeArena(result, pushSize(arena, size, alignment), size);
+}
+
+// everything that was pushed after beginning the scope is given back when ending it
+inline TemporaryMemory beginTemporaryMemory(MemoryArena *arena)
+{
+    TemporaryMemory result;
+    result.arena = arena;
+    result.used  = arena->used;
+    arena->temporaryCount++;
+    return result;
+}
+
+inline void endTemporaryMemory(TemporaryMemory temporaryMemory)
+{
+    MemoryArena *arena = temporaryMemory.arena;
+    xbAssert(arena->used >= temporaryMemory.used);
+    xbAssert(arena->temporaryCount > 0);
+    arena->used = temporaryMemory.used;
+    arena->temporaryCount--;
+}
+
+// ends the scope but keeps everything that was pushed after beginning it
+inline void keepTemporaryMemory(TemporaryMemory temporaryMemory)
+{
+    MemoryArena *arena = temporaryMemory.arena;
+    xbAssert(arena->used >= temporaryMemory.used);
+    xbAssert(arena->temporaryCount > 0);
+    arena->temporaryCount--;
+}
+
+inline void resetArena(MemoryArena *arena)
+{
+    xbAssert(arena->temporaryCount == 0);
+    arena->used = 0;
+}
+
+inline void checkArena(MemoryArena *arena)
+{
+    xbAssert(arena->temporaryCount == 0);
+}
+
+#endif // include guard end
@@ -0,0 +1,294 @@
+#include "xbAsset.h"
+#include "xbMath.h"
+#include "xbPixel.h"
+#include "constants.h"
+
+#include <cstdio> // for printf, fopen
+#include <cstdlib> // for malloc, qsort
+#include <cstring> // for memcpy, strcmp, strrchr
+
+//NOTE[ALEX]: offline tool that packs BMP (uncompressed 24 or 32 bit) and PPM (P6) files into an
+//            asset pack (see xbAsset.h): xbPacker output.pack input.bmp input.ppm ...
+//            the pixels get converted to premultiplied AARRGGBB rows with the pitch of the
+//            GameBuffer here, so the engine can use them straight from the mapped file
+//NOTE[ALEX]: this runs at build time only, so memory comes from malloc and is never freed
+
+struct PackerFile {
+    uint8_t  *contents;
+    uint64_t  size;
+};
+
+struct PackerBitmap {
+    char      name[ASSET_NAME_LENGTH];
+    int32_t   width;
+    int32_t   height;
+    uint32_t *pixels; // straight alpha AARRGGBB, width pixels per row
+};
+
+PackerFile packerReadFile(const char *fileName)
+{
+    PackerFile file = {};
+    FILE *handle = fopen(fileName, "rb");
+    if (!handle) {
+        printf("%s could not open %s\n", __FUNCTION__, fileName);
+        return file;
+    }
+    fseek(handle, 0, SEEK_END);
+    long size = ftell(handle);
+    fseek(handle, 0, SEEK_SET);
+    if (size > 0) {
+        file.contents = (uint8_t *)malloc(size);
+        if (file.contents && fread(file.contents, size, 1, handle) == 1) {
+            file.size = (uint64_t)size;
+        } else {
+            printf("%s could not read %s\n", __FUNCTION__, fileName);
+            file.contents = 0;
+        }
+    }
+    fclose(handle);
+    return file;
+}
+
+uint32_t packerRead16(uint8_t *bytes)
+{
+    return bytes[0] | (bytes[1] << 8);
+}
+
+uint32_t packerRead32(uint8_t *bytes)
+{
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+// channel selected by mask scaled to 8 bits, 255 if the mask is empty
+uint32_t packerMaskChannel(uint32_t value, uint32_t mask)
+{
+    if (!mask) { return 255; }
+    uint32_t shift = 0;
+    while (!((mask >> shift) & 1)) { shift++; }
+    uint32_t maximum = mask >> shift;
+    return (((value & mask) >> shift) * 255 + maximum / 2) / maximum;
+}
+
+//NOTE[ALEX]: rows are stored bottom up unless the height is negative and padded to 4 bytes,
+//            24 bit and 32 bit BI_RGB files are opaque, BI_BITFIELDS files bring their own masks
+//            (alpha only in the larger headers)
+int32_t packerParseBMP(PackerFile *file, PackerBitmap *bitmap)
+{
+    uint8_t *bytes = file->contents;
+    if (file->size < 54 || bytes[0] != 'B' || bytes[1] != 'M') { return 0; }
+    uint32_t pixelOffset = packerRead32(bytes + 10);
+    uint32_t headerSize  = packerRead32(bytes + 14);
+    int32_t  width       = (int32_t)packerRead32(bytes + 18);
+    int32_t  height      = (int32_t)packerRead32(bytes + 22);
+    uint32_t bitCount    = packerRead16(bytes + 28);
+    uint32_t compression = packerRead32(bytes + 30);
+    int32_t  topDown     = height < 0;
+    height = topDown ? -height : height;
+
+    uint32_t redMask   = 0x00FF0000;
+    uint32_t greenMask = 0x0000FF00;
+    uint32_t blueMask  = 0x000000FF;
+    uint32_t alphaMask = 0;
+    if (compression == 3 || compression == 6) { // BI_BITFIELDS, BI_ALPHABITFIELDS
+        uint64_t maskOffset = 14 + 40;
+        if (file->size < maskOffset + 16) { return 0; }
+        redMask   = packerRead32(bytes + maskOffset);
+        greenMask = packerRead32(bytes + maskOffset + 4);
+        blueMask  = packerRead32(bytes + maskOffset + 8);
+        if (headerSize >= 56 || compression == 6) {
+            alphaMask = packerRead32(bytes + maskOffset + 12);
+        }
+    } else if (compression != 0) {
+        printf("%s compressed bitmaps are not supported\n", __FUNCTION__);
+        return 0;
+    }
+    if ((bitCount != 24 && bitCount != 32) || (bitCount == 24 && compression != 0)) {
+        printf("%s only 24 and 32 bit bitmaps are supported\n", __FUNCTION__);
+        return 0;
+    }
+    if (width <= 0 || height <= 0) { return 0; }
+
+    uint32_t bytesPerPixel = bitCount / 8;
+    uint64_t rowSize       = ((uint64_t)width * bytesPerPixel + 3) & ~3ull;
+    if (pixelOffset > file->size || rowSize * height > file->size - pixelOffset) { return 0; }
+
+    bitmap->width  = width;
+    bitmap->height = height;
+    bitmap->pixels = (uint32_t *)malloc((uint64_t)width * height * sizeof(uint32_t));
+    for (int32_t y = 0; y < height; y++) {
+        uint8_t  *source = bytes + pixelOffset + rowSize * (topDown ? y : height - 1 - y);
+        uint32_t *dest   = bitmap->pixels + (uint64_t)y * width;
+        for (int32_t x = 0; x < width; x++) {
+            if (bitCount == 24) {
+                dest[x] = 0xFF000000 | (source[2] << 16) | (source[1] << 8) | source[0];
+                source += 3;
+            } else {
+                uint32_t value = packerRead32(source);
+                dest[x] =   (packerMaskChannel(value, alphaMask) << 24)
+                          | (packerMaskChannel(value, redMask  ) << 16)
+                          | (packerMaskChannel(value, greenMask) <<  8)
+                          |  packerMaskChannel(value, blueMask );
+                source += 4;
+            }
+        }
+    }
+    return 1;
+}
+
+// next whitespace separated number of a PPM header, skipping comments
+int32_t packerParsePPMValue(PackerFile *file, uint64_t *position, int32_t *value)
+{
+    uint8_t *bytes = file->contents;
+    while (*position < file->size) {
+        uint8_t c = bytes[*position];
+        if (c == '#') {
+            while (*position < file->size && bytes[*position] != '\n') { (*position)++; }
+        } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            (*position)++;
+        } else {
+            break;
+        }
+    }
+    int32_t digits = 0;
+    *value = 0;
+    while (   *position < file->size && bytes[*position] >= '0' && bytes[*position] <= '9'
+           && *value < 1000000                                                           ) {
+        *value = *value * 10 + (bytes[*position] - '0');
+        (*position)++;
+        digits++;
+    }
+    return digits > 0;
+}
+
+// binary PPM with up to 8 bits per channel, always opaque
+int32_t packerParsePPM(PackerFile *file, PackerBitmap *bitmap)
+{
+    if (file->size < 2 || file->contents[0] != 'P' || file->contents[1] != '6') { return 0; }
+    uint64_t position = 2;
+    int32_t  width    = 0;
+    int32_t  height   = 0;
+    int32_t  maxValue = 0;
+    if (   !packerParsePPMValue(file, &position, &width)
+        || !packerParsePPMValue(file, &position, &height)
+        || !packerParsePPMValue(file, &position, &maxValue)) { return 0; }
+    position++; // single whitespace before the pixels
+    if (maxValue <= 0 || maxValue > 255) {
+        printf("%s only 8 bit PPM files are supported\n", __FUNCTION__);
+        return 0;
+    }
+    if (   width <= 0 || height <= 0 || position > file->size
+        || (uint64_t)width * height * 3 > file->size - position) { return 0; }
+
+    bitmap->width  = width;
+    bitmap->height = height;
+    bitmap->pixels = (uint32_t *)malloc((uint64_t)width * height * sizeof(uint32_t));
+    uint8_t *source = file->contents + position;
+    for (uint64_t i = 0; i < (uint64_t)width * height; i++) {
+        uint32_t red   = (source[0] * 255 + maxValue / 2) / maxValue;
+        uint32_t green = (source[1] * 255 + maxValue / 2) / maxValue;
+        uint32_t blue  = (source[2] * 255 + maxValue / 2) / maxValue;
+        bitmap->pixels[i] = 0xFF000000 | (red << 16) | (green << 8) | blue;
+        source += 3;
+    }
+    return 1;
+}
+
+// file name without directories and extension
+int32_t packerGetAssetName(const char *fileName, char *name)
+{
+    const char *start = strrchr(fileName, '/');
+    start = start ? start + 1 : fileName;
+    const char *end = strrchr(start, '.');
+    uint64_t length = end ? (uint64_t)(end - start) : strlen(start);
+    if (length == 0 || length >= ASSET_NAME_LENGTH) { return 0; }
+    memcpy(name, start, length);
+    name[length] = 0;
+    return 1;
+}
+
+int packerCompareEntries(const void *a, const void *b)
+{
+    return strcmp(((AssetPackEntry *)a)->name, ((AssetPackEntry *)b)->name);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        printf("usage: %s output.pack input.bmp input.ppm ...\n", argv[0]);
+        return 1;
+    }
+
+    uint32_t        assetCount = argc - 2;
+    AssetPackEntry *entries    = (AssetPackEntry *)calloc(assetCount, sizeof(AssetPackEntry));
+    PackerBitmap   *bitmaps    = (PackerBitmap *)calloc(assetCount, sizeof(PackerBitmap));
+    uint64_t        dataOffset = alignPow2U32(sizeof(AssetPackHeader), ASSET_PACK_ALIGNMENT);
+    for (uint32_t i = 0; i < assetCount; i++) {
+        const char   *fileName = argv[i + 2];
+        PackerBitmap *bitmap   = &bitmaps[i];
+        PackerFile    file     = packerReadFile(fileName);
+        if (!file.contents) { return 1; }
+        if (!packerGetAssetName(fileName, bitmap->name)) {
+            printf("%s the name of %s has to be 1 to %u characters\n", __FUNCTION__, fileName,
+                   ASSET_NAME_LENGTH - 1                                                     );
+            return 1;
+        }
+        if (!packerParseBMP(&file, bitmap) && !packerParsePPM(&file, bitmap)) {
+            printf("%s %s is not a supported BMP or PPM file\n", __FUNCTION__, fileName);
+            return 1;
+        }
+
+        AssetPackEntry *entry = &entries[i];
+        memcpy(entry->name, bitmap->name, ASSET_NAME_LENGTH);
+        entry->type       = ASSET_TYPE_BITMAP;
+        entry->flags      = ASSET_FLAG_OPAQUE;
+        entry->width      = bitmap->width;
+        entry->height     = bitmap->height;
+        entry->pitch      = alignPow2U32(bitmap->width * sizeof(uint32_t), ASSET_PACK_ALIGNMENT);
+        entry->dataOffset = dataOffset;
+        entry->dataSize   = (uint64_t)entry->pitch * entry->height;
+        for (uint64_t j = 0; j < (uint64_t)bitmap->width * bitmap->height; j++) {
+            if ((bitmap->pixels[j] >> 24) != 0xFF) { entry->flags &= ~ASSET_FLAG_OPAQUE; }
+        }
+        dataOffset       += entry->dataSize; // stays aligned, the pitch is
+    }
+
+    AssetPackHeader header = {};
+    header.magic       = ASSET_PACK_MAGIC;
+    header.version     = ASSET_PACK_VERSION;
+    header.assetCount  = assetCount;
+    header.entrySize   = sizeof(AssetPackEntry);
+    header.indexOffset = dataOffset;
+    header.fileSize    = dataOffset + assetCount * sizeof(AssetPackEntry);
+
+    // the data is written in input order at the offsets set above, only the index gets sorted
+    uint8_t *pack = (uint8_t *)calloc(header.fileSize, 1);
+    memcpy(pack, &header, sizeof(header));
+    for (uint32_t i = 0; i < assetCount; i++) {
+        for (int32_t y = 0; y < bitmaps[i].height; y++) {
+            uint32_t *source = bitmaps[i].pixels + (uint64_t)y * bitmaps[i].width;
+            uint32_t *dest   = (uint32_t *)(pack + entries[i].dataOffset
+                                                 + (uint64_t)y * entries[i].pitch);
+            for (int32_t x = 0; x < bitmaps[i].width; x++) {
+                dest[x] = premultiplyColor(source[x]);
+            }
+        }
+    }
+    qsort(entries, assetCount, sizeof(AssetPackEntry), packerCompareEntries);
+    for (uint32_t i = 1; i < assetCount; i++) {
+        if (strcmp(entries[i - 1].name, entries[i].name) == 0) {
+            printf("%s %s is in the pack twice\n", __FUNCTION__, entries[i].name);
+            return 1;
+        }
+    }
+    memcpy(pack + header.indexOffset, entries, assetCount * sizeof(AssetPackEntry));
+
+    FILE *output = fopen(argv[1], "wb");
+    if (!output || fwrite(pack, header.fileSize, 1, output) != 1) {
+        printf("%s could not write %s\n", __FUNCTION__, argv[1]);
+        return 1;
+    }
+    fclose(output);
+    printf("%s packed %u assets into %s (%lu bytes)\n", __FUNCTION__, assetCount, argv[1],
+           header.fileSize                                                                );
+    return 0;
+}
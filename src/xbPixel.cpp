@@ -0,0 +1,680 @@
+#include "xbPixel.h"
+#include "constants.h"
+
+#include <cstdio> // for printf (used by xbAssert)
+
+#if defined(__x86_64__) || defined(__i386__)
+#define XB_PIXEL_X86 1
+#include <immintrin.h> // for SSE2 and AVX2 intrinsics
+#endif
+
+//NOTE[ALEX]: pixels have to be 4 byte aligned, rows of the GameBuffer and texture memory are;
+//            the SIMD kernels write single pixels (SSE2) or masked lanes (AVX2) until the
+//            destination is aligned to the register width, then full aligned registers,
+//            then the remaining pixels the same way as the start
+
+void fillSpanScalar(uint32_t *pixel, uint32_t count, uint32_t color)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        *pixel = color;
+        pixel++;
+    }
+}
+
+void copySpanScalar(uint32_t *destination, uint32_t *source, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        *destination = *source;
+        destination++;
+        source++;
+    }
+}
+
+void blendSpanScalar(uint32_t *pixel, uint32_t count, uint32_t color)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        *pixel = blendPixel(*pixel, color);
+        pixel++;
+    }
+}
+
+void blendCopySpanScalar(uint32_t *destination, uint32_t *source, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        *destination = blendPixel(*destination, *source);
+        destination++;
+        source++;
+    }
+}
+
+inline int32_t clampSourceX(int32_t sourceX, int32_t maxSourceX)
+{
+    if (sourceX < 0)          { return 0; }
+    if (sourceX > maxSourceX) { return maxSourceX; }
+    return sourceX;
+}
+
+void scaleSpanNearestScalar(uint32_t *destination, uint32_t *source, uint32_t count,
+                            int32_t sourceX, int32_t step, int32_t maxSourceX       )
+{
+    for (uint32_t i = 0; i < count; i++) {
+        *destination = source[clampSourceX(sourceX, maxSourceX) >> 16];
+        destination++;
+        sourceX += step;
+    }
+}
+
+void scaleSpanLinearScalar(uint32_t *destination, uint32_t *source, uint32_t count,
+                           int32_t sourceX, int32_t step, int32_t maxSourceX       )
+{
+    int32_t lastIndex = maxSourceX >> 16;
+    for (uint32_t i = 0; i < count; i++) {
+        int32_t x     = clampSourceX(sourceX, maxSourceX);
+        int32_t index = x >> 16;
+        int32_t next  = index < lastIndex ? index + 1 : lastIndex;
+        *destination = lerpPixel(source[index], source[next], (x >> 8) & 0xFF);
+        destination++;
+        sourceX += step;
+    }
+}
+
+void lerpSpanScalar(uint32_t *destination, uint32_t *a, uint32_t *b, uint32_t count,
+                    uint32_t weight                                                 )
+{
+    for (uint32_t i = 0; i < count; i++) {
+        *destination = lerpPixel(*a, *b, weight);
+        destination++;
+        a++;
+        b++;
+    }
+}
+
+#ifdef XB_PIXEL_X86
+__attribute__((target("sse2")))
+inline uint32_t *fillSpanHeadSSE2(uint32_t *pixel, uint32_t *end, uint32_t color)
+{
+    while (pixel < end && ((uintptr_t)pixel & 15)) {
+        *pixel = color;
+        pixel++;
+    }
+    return pixel;
+}
+
+__attribute__((target("sse2")))
+void fillSpanSSE2(uint32_t *pixel, uint32_t count, uint32_t color)
+{
+    xbAssert(((uintptr_t)pixel & 3) == 0);
+    uint32_t *end = pixel + count;
+    pixel = fillSpanHeadSSE2(pixel, end, color);
+
+    __m128i wide = _mm_set1_epi32((int32_t)color);
+    while (end - pixel >= 16) {
+        _mm_store_si128((__m128i *)pixel + 0, wide);
+        _mm_store_si128((__m128i *)pixel + 1, wide);
+        _mm_store_si128((__m128i *)pixel + 2, wide);
+        _mm_store_si128((__m128i *)pixel + 3, wide);
+        pixel += 16;
+    }
+    while (end - pixel >= 4) {
+        _mm_store_si128((__m128i *)pixel, wide);
+        pixel += 4;
+    }
+    fillSpanScalar(pixel, end - pixel, color);
+}
+
+__attribute__((target("sse2")))
+void fillSpanStreamingSSE2(uint32_t *pixel, uint32_t count, uint32_t color)
+{
+    xbAssert(((uintptr_t)pixel & 3) == 0);
+    uint32_t *end = pixel + count;
+    pixel = fillSpanHeadSSE2(pixel, end, color);
+
+    __m128i wide = _mm_set1_epi32((int32_t)color);
+    while (end - pixel >= 16) {
+        _mm_stream_si128((__m128i *)pixel + 0, wide);
+        _mm_stream_si128((__m128i *)pixel + 1, wide);
+        _mm_stream_si128((__m128i *)pixel + 2, wide);
+        _mm_stream_si128((__m128i *)pixel + 3, wide);
+        pixel += 16;
+    }
+    while (end - pixel >= 4) {
+        _mm_stream_si128((__m128i *)pixel, wide);
+        pixel += 4;
+    }
+    fillSpanScalar(pixel, end - pixel, color);
+    _mm_sfence(); // streaming stores have to be visible before another thread reads the span
+}
+
+__attribute__((target("sse2")))
+void copySpanSSE2(uint32_t *destination, uint32_t *source, uint32_t count)
+{
+    xbAssert(((uintptr_t)destination & 3) == 0);
+    uint32_t *end = destination + count;
+    while (destination < end && ((uintptr_t)destination & 15)) {
+        *destination = *source;
+        destination++;
+        source++;
+    }
+    while (end - destination >= 16) {
+        __m128i a = _mm_loadu_si128((__m128i *)source + 0);
+        __m128i b = _mm_loadu_si128((__m128i *)source + 1);
+        __m128i c = _mm_loadu_si128((__m128i *)source + 2);
+        __m128i d = _mm_loadu_si128((__m128i *)source + 3);
+        _mm_store_si128((__m128i *)destination + 0, a);
+        _mm_store_si128((__m128i *)destination + 1, b);
+        _mm_store_si128((__m128i *)destination + 2, c);
+        _mm_store_si128((__m128i *)destination + 3, d);
+        destination += 16;
+        source      += 16;
+    }
+    while (end - destination >= 4) {
+        _mm_store_si128((__m128i *)destination, _mm_loadu_si128((__m128i *)source));
+        destination += 4;
+        source      += 4;
+    }
+    copySpanScalar(destination, source, end - destination);
+}
+
+//NOTE[ALEX]: the blend kernels widen the channels to 16 bit, so one register of pixels is
+//            blended as a low and a high half of 8 channels each
+
+// x*a/255 for 16 bit lanes holding 8 bit values
+__attribute__((target("sse2")))
+inline __m128i mulDiv255SSE2(__m128i x, __m128i a)
+{
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, a), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// 255 - alpha of each pixel, repeated for its 4 channels (16 bit lanes)
+__attribute__((target("sse2")))
+inline __m128i getInverseAlphaSSE2(__m128i source16)
+{
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(source16, _MM_SHUFFLE(3, 3, 3, 3)),
+                                        _MM_SHUFFLE(3, 3, 3, 3)                                );
+    return _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+}
+
+__attribute__((target("sse2")))
+void blendSpanSSE2(uint32_t *pixel, uint32_t count, uint32_t color)
+{
+    uint32_t *end = pixel + count;
+    __m128i zero         = _mm_setzero_si128();
+    __m128i source       = _mm_set1_epi32((int32_t)color);
+    __m128i inverseAlpha = _mm_set1_epi16((int16_t)(255 - (color >> 24)));
+    while (end - pixel >= 4) {
+        __m128i destination = _mm_loadu_si128((__m128i *)pixel);
+        __m128i low  = mulDiv255SSE2(_mm_unpacklo_epi8(destination, zero), inverseAlpha);
+        __m128i high = mulDiv255SSE2(_mm_unpackhi_epi8(destination, zero), inverseAlpha);
+        _mm_storeu_si128((__m128i *)pixel, _mm_adds_epu8(source, _mm_packus_epi16(low, high)));
+        pixel += 4;
+    }
+    blendSpanScalar(pixel, end - pixel, color);
+}
+
+__attribute__((target("sse2")))
+void blendCopySpanSSE2(uint32_t *destination, uint32_t *source, uint32_t count)
+{
+    uint32_t *end = destination + count;
+    __m128i zero = _mm_setzero_si128();
+    while (end - destination >= 4) {
+        __m128i sourcePixels      = _mm_loadu_si128((__m128i *)source);
+        __m128i destinationPixels = _mm_loadu_si128((__m128i *)destination);
+        __m128i low  = mulDiv255SSE2(_mm_unpacklo_epi8(destinationPixels, zero),
+                                     getInverseAlphaSSE2(_mm_unpacklo_epi8(sourcePixels, zero)));
+        __m128i high = mulDiv255SSE2(_mm_unpackhi_epi8(destinationPixels, zero),
+                                     getInverseAlphaSSE2(_mm_unpackhi_epi8(sourcePixels, zero)));
+        _mm_storeu_si128((__m128i *)destination,
+                         _mm_adds_epu8(sourcePixels, _mm_packus_epi16(low, high)));
+        destination += 4;
+        source      += 4;
+    }
+    blendCopySpanScalar(destination, source, end - destination);
+}
+
+// (a*(256 - weight) + b*weight)/256 for 16 bit lanes holding 8 bit values (weight up to 256)
+__attribute__((target("sse2")))
+inline __m128i lerp16SSE2(__m128i a, __m128i b, __m128i weight)
+{
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(a, _mm_sub_epi16(_mm_set1_epi16(256), weight)),
+                              _mm_mullo_epi16(b, weight)                                    );
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_set1_epi16(128)), 8);
+}
+
+__attribute__((target("sse2")))
+void lerpSpanSSE2(uint32_t *destination, uint32_t *a, uint32_t *b, uint32_t count,
+                  uint32_t weight                                                 )
+{
+    uint32_t *end = destination + count;
+    __m128i zero     = _mm_setzero_si128();
+    __m128i weight16 = _mm_set1_epi16((int16_t)weight);
+    while (end - destination >= 4) {
+        __m128i aPixels = _mm_loadu_si128((__m128i *)a);
+        __m128i bPixels = _mm_loadu_si128((__m128i *)b);
+        __m128i low  = lerp16SSE2(_mm_unpacklo_epi8(aPixels, zero),
+                                  _mm_unpacklo_epi8(bPixels, zero), weight16);
+        __m128i high = lerp16SSE2(_mm_unpackhi_epi8(aPixels, zero),
+                                  _mm_unpackhi_epi8(bPixels, zero), weight16);
+        _mm_storeu_si128((__m128i *)destination, _mm_packus_epi16(low, high));
+        destination += 4;
+        a           += 4;
+        b           += 4;
+    }
+    lerpSpanScalar(destination, a, b, end - destination, weight);
+}
+
+//NOTE[ALEX]: sse2 has neither gathers nor 32 bit min/max, so the source pixels are picked by
+//            scalar code and only the interpolation is done in SIMD; the per pixel weights
+//            (one per 32 bit lane) are spread to the four 16 bit channels of their pixel
+__attribute__((target("sse2")))
+void scaleSpanLinearSSE2(uint32_t *destination, uint32_t *source, uint32_t count,
+                         int32_t sourceX, int32_t step, int32_t maxSourceX       )
+{
+    uint32_t *end       = destination + count;
+    int32_t   lastIndex = maxSourceX >> 16;
+    __m128i   zero      = _mm_setzero_si128();
+    while (end - destination >= 4) {
+        uint32_t a[4];
+        uint32_t b[4];
+        int32_t  weight[4];
+        for (int32_t i = 0; i < 4; i++) {
+            int32_t x     = clampSourceX(sourceX, maxSourceX);
+            int32_t index = x >> 16;
+            a[i]      = source[index];
+            b[i]      = source[index < lastIndex ? index + 1 : lastIndex];
+            weight[i] = (x >> 8) & 0xFF;
+            sourceX  += step;
+        }
+        __m128i aPixels  = _mm_loadu_si128((__m128i *)a);
+        __m128i bPixels  = _mm_loadu_si128((__m128i *)b);
+        __m128i weight32 = _mm_loadu_si128((__m128i *)weight);
+        __m128i weight16 = _mm_or_si128(weight32, _mm_slli_epi32(weight32, 16));
+        __m128i low  = lerp16SSE2(_mm_unpacklo_epi8(aPixels, zero),
+                                  _mm_unpacklo_epi8(bPixels, zero),
+                                  _mm_unpacklo_epi32(weight16, weight16));
+        __m128i high = lerp16SSE2(_mm_unpackhi_epi8(aPixels, zero),
+                                  _mm_unpackhi_epi8(bPixels, zero),
+                                  _mm_unpackhi_epi32(weight16, weight16));
+        _mm_storeu_si128((__m128i *)destination, _mm_packus_epi16(low, high));
+        destination += 4;
+    }
+    scaleSpanLinearScalar(destination, source, end - destination, sourceX, step, maxSourceX);
+}
+
+// lanes below count are set (count gets clamped to 8)
+__attribute__((target("avx2")))
+inline __m256i getLaneMaskAVX2(int64_t count)
+{
+    if (count > 8) { count = 8; }
+    __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32((int32_t)count), lanes);
+}
+
+// pixels until the next 32 byte boundary (or until end), 0 if already aligned
+inline int64_t getHeadCountAVX2(uint32_t *pixel, uint32_t *end)
+{
+    int64_t headCount = ((32 - ((uintptr_t)pixel & 31)) & 31) / 4;
+    if (headCount > end - pixel) { headCount = end - pixel; }
+    return headCount;
+}
+
+__attribute__((target("avx2")))
+void fillSpanAVX2(uint32_t *pixel, uint32_t count, uint32_t color)
+{
+    xbAssert(((uintptr_t)pixel & 3) == 0);
+    uint32_t *end  = pixel + count;
+    __m256i   wide = _mm256_set1_epi32((int32_t)color);
+
+    int64_t headCount = getHeadCountAVX2(pixel, end);
+    if (headCount) {
+        _mm256_maskstore_epi32((int *)pixel, getLaneMaskAVX2(headCount), wide);
+        pixel += headCount;
+    }
+    while (end - pixel >= 32) {
+        _mm256_store_si256((__m256i *)pixel + 0, wide);
+        _mm256_store_si256((__m256i *)pixel + 1, wide);
+        _mm256_store_si256((__m256i *)pixel + 2, wide);
+        _mm256_store_si256((__m256i *)pixel + 3, wide);
+        pixel += 32;
+    }
+    while (end - pixel >= 8) {
+        _mm256_store_si256((__m256i *)pixel, wide);
+        pixel += 8;
+    }
+    if (end - pixel) {
+        _mm256_maskstore_epi32((int *)pixel, getLaneMaskAVX2(end - pixel), wide);
+    }
+}
+
+__attribute__((target("avx2")))
+void fillSpanStreamingAVX2(uint32_t *pixel, uint32_t count, uint32_t color)
+{
+    xbAssert(((uintptr_t)pixel & 3) == 0);
+    uint32_t *end  = pixel + count;
+    __m256i   wide = _mm256_set1_epi32((int32_t)color);
+
+    int64_t headCount = getHeadCountAVX2(pixel, end);
+    if (headCount) {
+        _mm256_maskstore_epi32((int *)pixel, getLaneMaskAVX2(headCount), wide);
+        pixel += headCount;
+    }
+    while (end - pixel >= 32) {
+        _mm256_stream_si256((__m256i *)pixel + 0, wide);
+        _mm256_stream_si256((__m256i *)pixel + 1, wide);
+        _mm256_stream_si256((__m256i *)pixel + 2, wide);
+        _mm256_stream_si256((__m256i *)pixel + 3, wide);
+        pixel += 32;
+    }
+    while (end - pixel >= 8) {
+        _mm256_stream_si256((__m256i *)pixel, wide);
+        pixel += 8;
+    }
+    if (end - pixel) {
+        _mm256_maskstore_epi32((int *)pixel, getLaneMaskAVX2(end - pixel), wide);
+    }
+    _mm_sfence(); // streaming stores have to be visible before another thread reads the span
+}
+
+__attribute__((target("avx2")))
+void copySpanAVX2(uint32_t *destination, uint32_t *source, uint32_t count)
+{
+    xbAssert(((uintptr_t)destination & 3) == 0);
+    uint32_t *end = destination + count;
+
+    int64_t headCount = getHeadCountAVX2(destination, end);
+    if (headCount) {
+        __m256i mask = getLaneMaskAVX2(headCount);
+        _mm256_maskstore_epi32((int *)destination, mask,
+                               _mm256_maskload_epi32((int *)source, mask));
+        destination += headCount;
+        source      += headCount;
+    }
+    while (end - destination >= 32) {
+        __m256i a = _mm256_loadu_si256((__m256i *)source + 0);
+        __m256i b = _mm256_loadu_si256((__m256i *)source + 1);
+        __m256i c = _mm256_loadu_si256((__m256i *)source + 2);
+        __m256i d = _mm256_loadu_si256((__m256i *)source + 3);
+        _mm256_store_si256((__m256i *)destination + 0, a);
+        _mm256_store_si256((__m256i *)destination + 1, b);
+        _mm256_store_si256((__m256i *)destination + 2, c);
+        _mm256_store_si256((__m256i *)destination + 3, d);
+        destination += 32;
+        source      += 32;
+    }
+    while (end - destination >= 8) {
+        _mm256_store_si256((__m256i *)destination, _mm256_loadu_si256((__m256i *)source));
+        destination += 8;
+        source      += 8;
+    }
+    if (end - destination) {
+        __m256i mask = getLaneMaskAVX2(end - destination);
+        _mm256_maskstore_epi32((int *)destination, mask,
+                               _mm256_maskload_epi32((int *)source, mask));
+    }
+}
+
+__attribute__((target("avx2")))
+inline __m256i mulDiv255AVX2(__m256i x, __m256i a)
+{
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(x, a), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+__attribute__((target("avx2")))
+inline __m256i getInverseAlphaAVX2(__m256i source16)
+{
+    __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(source16,
+                                                                  _MM_SHUFFLE(3, 3, 3, 3)),
+                                           _MM_SHUFFLE(3, 3, 3, 3)                         );
+    return _mm256_sub_epi16(_mm256_set1_epi16(255), alpha);
+}
+
+//NOTE[ALEX]: unpack and pack work within each 128 bit half, so the pixels end up in the
+//            order they were loaded in
+__attribute__((target("avx2")))
+void blendSpanAVX2(uint32_t *pixel, uint32_t count, uint32_t color)
+{
+    uint32_t *end = pixel + count;
+    __m256i zero         = _mm256_setzero_si256();
+    __m256i source       = _mm256_set1_epi32((int32_t)color);
+    __m256i inverseAlpha = _mm256_set1_epi16((int16_t)(255 - (color >> 24)));
+    while (end - pixel >= 8) {
+        __m256i destination = _mm256_loadu_si256((__m256i *)pixel);
+        __m256i low  = mulDiv255AVX2(_mm256_unpacklo_epi8(destination, zero), inverseAlpha);
+        __m256i high = mulDiv255AVX2(_mm256_unpackhi_epi8(destination, zero), inverseAlpha);
+        _mm256_storeu_si256((__m256i *)pixel,
+                            _mm256_adds_epu8(source, _mm256_packus_epi16(low, high)));
+        pixel += 8;
+    }
+    blendSpanScalar(pixel, end - pixel, color);
+}
+
+__attribute__((target("avx2")))
+void blendCopySpanAVX2(uint32_t *destination, uint32_t *source, uint32_t count)
+{
+    uint32_t *end = destination + count;
+    __m256i zero = _mm256_setzero_si256();
+    while (end - destination >= 8) {
+        __m256i sourcePixels      = _mm256_loadu_si256((__m256i *)source);
+        __m256i destinationPixels = _mm256_loadu_si256((__m256i *)destination);
+        __m256i low  = mulDiv255AVX2(_mm256_unpacklo_epi8(destinationPixels, zero),
+                                     getInverseAlphaAVX2(_mm256_unpacklo_epi8(sourcePixels,
+                                                                              zero        )));
+        __m256i high = mulDiv255AVX2(_mm256_unpackhi_epi8(destinationPixels, zero),
+                                     getInverseAlphaAVX2(_mm256_unpackhi_epi8(sourcePixels,
+                                                                              zero        )));
+        _mm256_storeu_si256((__m256i *)destination,
+                            _mm256_adds_epu8(sourcePixels, _mm256_packus_epi16(low, high)));
+        destination += 8;
+        source      += 8;
+    }
+    blendCopySpanScalar(destination, source, end - destination);
+}
+
+__attribute__((target("avx2")))
+inline __m256i lerp16AVX2(__m256i a, __m256i b, __m256i weight)
+{
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(a, _mm256_sub_epi16(_mm256_set1_epi16(256),
+                                                                        weight                )),
+                                 _mm256_mullo_epi16(b, weight)                                   );
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_set1_epi16(128)), 8);
+}
+
+__attribute__((target("avx2")))
+void lerpSpanAVX2(uint32_t *destination, uint32_t *a, uint32_t *b, uint32_t count,
+                  uint32_t weight                                                 )
+{
+    uint32_t *end = destination + count;
+    __m256i zero     = _mm256_setzero_si256();
+    __m256i weight16 = _mm256_set1_epi16((int16_t)weight);
+    while (end - destination >= 8) {
+        __m256i aPixels = _mm256_loadu_si256((__m256i *)a);
+        __m256i bPixels = _mm256_loadu_si256((__m256i *)b);
+        __m256i low  = lerp16AVX2(_mm256_unpacklo_epi8(aPixels, zero),
+                                  _mm256_unpacklo_epi8(bPixels, zero), weight16);
+        __m256i high = lerp16AVX2(_mm256_unpackhi_epi8(aPixels, zero),
+                                  _mm256_unpackhi_epi8(bPixels, zero), weight16);
+        _mm256_storeu_si256((__m256i *)destination, _mm256_packus_epi16(low, high));
+        destination += 8;
+        a           += 8;
+        b           += 8;
+    }
+    lerpSpanScalar(destination, a, b, end - destination, weight);
+}
+
+// 16.16 source positions of 8 consecutive pixels
+__attribute__((target("avx2")))
+inline __m256i getSourcePositionsAVX2(int32_t sourceX, int32_t step)
+{
+    __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    return _mm256_add_epi32(_mm256_set1_epi32(sourceX),
+                            _mm256_mullo_epi32(lanes, _mm256_set1_epi32(step)));
+}
+
+__attribute__((target("avx2")))
+void scaleSpanNearestAVX2(uint32_t *destination, uint32_t *source, uint32_t count,
+                          int32_t sourceX, int32_t step, int32_t maxSourceX       )
+{
+    uint32_t *end       = destination + count;
+    __m256i   positions = getSourcePositionsAVX2(sourceX, step);
+    __m256i   step8     = _mm256_set1_epi32(8*step);
+    __m256i   zero      = _mm256_setzero_si256();
+    __m256i   maxSource = _mm256_set1_epi32(maxSourceX);
+    while (end - destination >= 8) {
+        __m256i x = _mm256_min_epi32(_mm256_max_epi32(positions, zero), maxSource);
+        _mm256_storeu_si256((__m256i *)destination,
+                            _mm256_i32gather_epi32((int *)source, _mm256_srli_epi32(x, 16), 4));
+        positions    = _mm256_add_epi32(positions, step8);
+        sourceX     += 8*step;
+        destination += 8;
+    }
+    scaleSpanNearestScalar(destination, source, end - destination, sourceX, step, maxSourceX);
+}
+
+__attribute__((target("avx2")))
+void scaleSpanLinearAVX2(uint32_t *destination, uint32_t *source, uint32_t count,
+                         int32_t sourceX, int32_t step, int32_t maxSourceX       )
+{
+    uint32_t *end       = destination + count;
+    __m256i   positions = getSourcePositionsAVX2(sourceX, step);
+    __m256i   step8     = _mm256_set1_epi32(8*step);
+    __m256i   zero      = _mm256_setzero_si256();
+    __m256i   maxSource = _mm256_set1_epi32(maxSourceX);
+    __m256i   lastIndex = _mm256_set1_epi32(maxSourceX >> 16);
+    while (end - destination >= 8) {
+        __m256i x        = _mm256_min_epi32(_mm256_max_epi32(positions, zero), maxSource);
+        __m256i index    = _mm256_srli_epi32(x, 16);
+        __m256i next     = _mm256_min_epi32(_mm256_add_epi32(index, _mm256_set1_epi32(1)),
+                                            lastIndex                                      );
+        __m256i weight32 = _mm256_and_si256(_mm256_srli_epi32(x, 8), _mm256_set1_epi32(0xFF));
+        __m256i weight16 = _mm256_or_si256(weight32, _mm256_slli_epi32(weight32, 16));
+        __m256i aPixels  = _mm256_i32gather_epi32((int *)source, index, 4);
+        __m256i bPixels  = _mm256_i32gather_epi32((int *)source, next,  4);
+        __m256i low  = lerp16AVX2(_mm256_unpacklo_epi8(aPixels, zero),
+                                  _mm256_unpacklo_epi8(bPixels, zero),
+                                  _mm256_unpacklo_epi32(weight16, weight16));
+        __m256i high = lerp16AVX2(_mm256_unpackhi_epi8(aPixels, zero),
+                                  _mm256_unpackhi_epi8(bPixels, zero),
+                                  _mm256_unpackhi_epi32(weight16, weight16));
+        _mm256_storeu_si256((__m256i *)destination, _mm256_packus_epi16(low, high));
+        positions    = _mm256_add_epi32(positions, step8);
+        sourceX     += 8*step;
+        destination += 8;
+    }
+    scaleSpanLinearScalar(destination, source, end - destination, sourceX, step, maxSourceX);
+}
+#endif
+
+PixelKernelLevel getSupportedPixelKernelLevel()
+{
+#ifdef XB_PIXEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) { return PIXEL_KERNELS_AVX2; }
+    if (__builtin_cpu_supports("sse2")) { return PIXEL_KERNELS_SSE2; }
+#endif
+    return PIXEL_KERNELS_SCALAR;
+}
+
+const char *getPixelKernelLevelName(PixelKernelLevel level)
+{
+    switch (level) {
+        case PIXEL_KERNELS_SSE2: { return "sse2";   }
+        case PIXEL_KERNELS_AVX2: { return "avx2";   }
+        default:                 { return "scalar"; }
+    }
+}
+
+// level has to be supported by the cpu (see getSupportedPixelKernelLevel)
+void getPixelKernels(PixelKernels *pixelKernels, PixelKernelLevel level)
+{
+    pixelKernels->level             = PIXEL_KERNELS_SCALAR;
+    pixelKernels->fillSpan          = fillSpanScalar;
+    pixelKernels->fillSpanStreaming = fillSpanScalar;
+    pixelKernels->copySpan          = copySpanScalar;
+    pixelKernels->blendSpan         = blendSpanScalar;
+    pixelKernels->blendCopySpan     = blendCopySpanScalar;
+    pixelKernels->scaleSpanNearest  = scaleSpanNearestScalar;
+    pixelKernels->scaleSpanLinear   = scaleSpanLinearScalar;
+    pixelKernels->lerpSpan          = lerpSpanScalar;
+#ifdef XB_PIXEL_X86
+    if (level == PIXEL_KERNELS_SSE2) {
+        pixelKernels->level             = PIXEL_KERNELS_SSE2;
+        pixelKernels->fillSpan          = fillSpanSSE2;
+        pixelKernels->fillSpanStreaming = fillSpanStreamingSSE2;
+        pixelKernels->copySpan          = copySpanSSE2;
+        pixelKernels->blendSpan         = blendSpanSSE2;
+        pixelKernels->blendCopySpan     = blendCopySpanSSE2;
+        pixelKernels->scaleSpanLinear   = scaleSpanLinearSSE2;
+        pixelKernels->lerpSpan          = lerpSpanSSE2;
+    } else if (level == PIXEL_KERNELS_AVX2) {
+        pixelKernels->level             = PIXEL_KERNELS_AVX2;
+        pixelKernels->fillSpan          = fillSpanAVX2;
+        pixelKernels->fillSpanStreaming = fillSpanStreamingAVX2;
+        pixelKernels->copySpan          = copySpanAVX2;
+        pixelKernels->blendSpan         = blendSpanAVX2;
+        pixelKernels->blendCopySpan     = blendCopySpanAVX2;
+        pixelKernels->scaleSpanNearest  = scaleSpanNearestAVX2;
+        pixelKernels->scaleSpanLinear   = scaleSpanLinearAVX2;
+        pixelKernels->lerpSpan          = lerpSpanAVX2;
+    }
+#endif
+}
+
+//NOTE[ALEX]: only written by initializePixelKernels before any worker renders,
+//            the scalar kernels are used until then
+static PixelKernels activePixelKernels = { PIXEL_KERNELS_SCALAR,
+                                           fillSpanScalar, fillSpanScalar, copySpanScalar,
+                                           blendSpanScalar, blendCopySpanScalar,
+                                           scaleSpanNearestScalar, scaleSpanLinearScalar,
+                                           lerpSpanScalar                                 };
+
+PixelKernelLevel initializePixelKernels(PixelKernelLevel maxLevel)
+{
+    PixelKernelLevel level = getSupportedPixelKernelLevel();
+    if (level > maxLevel) { level = maxLevel; }
+    getPixelKernels(&activePixelKernels, level);
+    return activePixelKernels.level;
+}
+
+void fillPixels(uint32_t *pixel, uint32_t count, uint32_t color)
+{
+    activePixelKernels.fillSpan(pixel, count, color);
+}
+
+void fillPixelsStreaming(uint32_t *pixel, uint32_t count, uint32_t color)
+{
+    activePixelKernels.fillSpanStreaming(pixel, count, color);
+}
+
+void copyPixels(uint32_t *destination, uint32_t *source, uint32_t count)
+{
+    activePixelKernels.copySpan(destination, source, count);
+}
+
+void blendPixels(uint32_t *pixel, uint32_t count, uint32_t color)
+{
+    activePixelKernels.blendSpan(pixel, count, color);
+}
+
+void blendCopyPixels(uint32_t *destination, uint32_t *source, uint32_t count)
+{
+    activePixelKernels.blendCopySpan(destination, source, count);
+}
+
+void scalePixelsNearest(uint32_t *destination, uint32_t *source, uint32_t count,
+                        int32_t sourceX, int32_t step, int32_t maxSourceX       )
+{
+    activePixelKernels.scaleSpanNearest(destination, source, count, sourceX, step, maxSourceX);
+}
+
+void scalePixelsLinear(uint32_t *destination, uint32_t *source, uint32_t count,
+                       int32_t sourceX, int32_t step, int32_t maxSourceX       )
+{
+    activePixelKernels.scaleSpanLinear(destination, source, count, sourceX, step, maxSourceX);
+}
+
+void lerpPixels(uint32_t *destination, uint32_t *a, uint32_t *b, uint32_t count,
+                uint32_t weight                                                 )
+{
+    activePixelKernels.lerpSpan(destination, a, b, count, weight);
+}
@@ -0,0 +1,115 @@
+#ifndef XBPIXEL_H // include guard begin
+#define XBPIXEL_H // include guard
+
+#include "constants.h"
+
+#include <stdint.h> // defines fixed size types, C++ version is <cstdint>
+
+//NOTE[ALEX]: blending uses premultiplied alpha (color channels are already multiplied by
+//            alpha), so blending source over destination is source + destination*(1-alpha);
+//            x*a/255 is computed as (t + (t >> 8)) >> 8 with t = x*a + 128, which is exact
+//            for all 8 bit values and cheap in SIMD
+
+// x*a/255 rounded, for 8 bit x and a
+inline uint32_t mulDiv255(uint32_t x, uint32_t a)
+{
+    uint32_t t = x*a + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+// straight alpha AARRGGBB to premultiplied AARRGGBB
+inline uint32_t premultiplyColor(uint32_t color)
+{
+    uint32_t alpha = color >> 24;
+    return   (alpha << 24)
+           | (mulDiv255((color >> 16) & 0xFF, alpha) << 16)
+           | (mulDiv255((color >>  8) & 0xFF, alpha) <<  8)
+           |  mulDiv255( color        & 0xFF, alpha);
+}
+
+// scales all channels of a premultiplied color by coverage (0 to 255)
+inline uint32_t scaleColor(uint32_t color, uint32_t coverage)
+{
+    return   (mulDiv255( color >> 24,         coverage) << 24)
+           | (mulDiv255((color >> 16) & 0xFF, coverage) << 16)
+           | (mulDiv255((color >>  8) & 0xFF, coverage) <<  8)
+           |  mulDiv255( color        & 0xFF, coverage);
+}
+
+// weight (0 to 256) of b, two channels are interpolated at once in the 0x00FF00FF lanes
+inline uint32_t lerpPixel(uint32_t a, uint32_t b, uint32_t weight)
+{
+    uint32_t redBlue    = (  (a & 0x00FF00FF) * (256 - weight)
+                           + (b & 0x00FF00FF) * weight + 0x00800080) >> 8;
+    uint32_t alphaGreen = (  ((a >> 8) & 0x00FF00FF) * (256 - weight)
+                           + ((b >> 8) & 0x00FF00FF) * weight + 0x00800080);
+    return (redBlue & 0x00FF00FF) | (alphaGreen & 0xFF00FF00);
+}
+
+// premultiplied source over destination
+inline uint32_t blendPixel(uint32_t destination, uint32_t source)
+{
+    uint32_t inverseAlpha = 255 - (source >> 24);
+    uint32_t result = 0;
+    for (uint32_t shift = 0; shift < 32; shift += 8) {
+        uint32_t channel =   ((source >> shift) & 0xFF)
+                           + mulDiv255((destination >> shift) & 0xFF, inverseAlpha);
+        if (channel > 255) { channel = 255; }
+        result |= channel << shift;
+    }
+    return result;
+}
+
+//NOTE[ALEX]: span kernels write runs of 32 bit pixels, they are picked once at startup
+//            according to what the cpu supports (see initializePixelKernels), every level
+//            produces exactly the same pixels, only the speed differs
+enum PixelKernelLevel {
+    PIXEL_KERNELS_SCALAR,
+    PIXEL_KERNELS_SSE2,
+    PIXEL_KERNELS_AVX2,
+    PIXEL_KERNELS_LEVEL_COUNT
+};
+
+typedef void PixelFillFunction(uint32_t *pixel, uint32_t count, uint32_t color);
+typedef void PixelCopyFunction(uint32_t *destination, uint32_t *source, uint32_t count);
+//NOTE[ALEX]: scaling reads the source row at 16.16 fixed point positions, pixel i of the span
+//            samples sourceX + i*step, positions are clamped to [0, maxSourceX]
+typedef void PixelScaleFunction(uint32_t *destination, uint32_t *source, uint32_t count,
+                                int32_t sourceX, int32_t step, int32_t maxSourceX       );
+typedef void PixelLerpFunction(uint32_t *destination, uint32_t *a, uint32_t *b,
+                               uint32_t count, uint32_t weight                 );
+
+struct PixelKernels {
+    PixelKernelLevel    level;
+    PixelFillFunction  *fillSpan;
+    //NOTE[ALEX]: non-temporal stores bypass the cache, which is faster for large spans that
+    //            are not read again soon (full buffer clears) but much slower for small ones
+    PixelFillFunction  *fillSpanStreaming;
+    PixelCopyFunction  *copySpan;
+    PixelFillFunction  *blendSpan;        // one premultiplied color over every pixel
+    PixelCopyFunction  *blendCopySpan;    // premultiplied source pixels over destination
+    PixelScaleFunction *scaleSpanNearest;
+    PixelScaleFunction *scaleSpanLinear;  // interpolates between the two closest source pixels
+    PixelLerpFunction  *lerpSpan;         // a and b interpolated by weight (0 to 256) of b
+};
+
+PixelKernelLevel getSupportedPixelKernelLevel();
+const char *getPixelKernelLevelName(PixelKernelLevel level);
+void getPixelKernels(PixelKernels *pixelKernels, PixelKernelLevel level);
+// uses the best supported level up to maxLevel, returns the level in use
+PixelKernelLevel initializePixelKernels(PixelKernelLevel maxLevel);
+
+// these go through the kernels picked by initializePixelKernels
+void fillPixels(uint32_t *pixel, uint32_t count, uint32_t color);
+void fillPixelsStreaming(uint32_t *pixel, uint32_t count, uint32_t color);
+void copyPixels(uint32_t *destination, uint32_t *source, uint32_t count);
+void blendPixels(uint32_t *pixel, uint32_t count, uint32_t color);
+void blendCopyPixels(uint32_t *destination, uint32_t *source, uint32_t count);
+void scalePixelsNearest(uint32_t *destination, uint32_t *source, uint32_t count,
+                        int32_t sourceX, int32_t step, int32_t maxSourceX       );
+void scalePixelsLinear(uint32_t *destination, uint32_t *source, uint32_t count,
+                       int32_t sourceX, int32_t step, int32_t maxSourceX       );
+void lerpPixels(uint32_t *destination, uint32_t *a, uint32_t *b, uint32_t count,
+                uint32_t weight                                                 );
+
+#endif // include guard end
@@ -0,0 +1,665 @@
+#include "xbRender.h"
+#include "xbEngine.h"
+#include "xbMath.h"
+#include "xbPixel.h"
+#include "constants.h"
+
+#include <cstdio> // for printf
+#include <math.h> // for sqrtf
+
+RenderCommands *beginRenderCommands(MemoryArena *arena, GameBuffer *gameBuffer,
+                                    uint32_t maxCommandCount                    )
+{
+    RenderCommands *renderCommands = pushStruct(arena, RenderCommands);
+    renderCommands->width           = gameBuffer->width;
+    renderCommands->height          = gameBuffer->height;
+    renderCommands->commands        = pushArray(arena, maxCommandCount, RenderCommand);
+    renderCommands->commandCount    = 0;
+    renderCommands->maxCommandCount = maxCommandCount;
+    return renderCommands;
+}
+
+// returns 0 if the command is empty after clipping or if there is no space left
+RenderCommand *pushRenderCommand(RenderCommands *renderCommands, RenderCommandType type,
+                                 int32_t startX, int32_t startY, int32_t endX, int32_t endY)
+{
+    startX = maxI32(startX, 0);
+    startY = maxI32(startY, 0);
+    endX   = minI32(endX, renderCommands->width);
+    endY   = minI32(endY, renderCommands->height);
+    if (startX >= endX || startY >= endY) { return 0; }
+
+    if (renderCommands->commandCount >= renderCommands->maxCommandCount) {
+        printf("%s render commands are full, command dropped\n", __FUNCTION__);
+        return 0;
+    }
+
+    RenderCommand *command = &renderCommands->commands[renderCommands->commandCount++];
+    command->type    = type;
+    command->startX  = startX;
+    command->startY  = startY;
+    command->endX    = endX;
+    command->endY    = endY;
+    command->color   = 0;
+    command->startXF = (float)startX;
+    command->startYF = (float)startY;
+    command->endXF   = (float)endX;
+    command->endYF   = (float)endY;
+    command->bitmap  = 0;
+    command->originX = 0;
+    command->originY = 0;
+    command->offsetY = 0;
+    command->source  = 0;
+    command->filter  = UPSCALE_FILTER_NEAREST;
+    command->stepX   = 0;
+    command->stepY   = 0;
+    return command;
+}
+
+// replaces every pixel (no blending)
+void pushClear(RenderCommands *renderCommands, uint32_t color)
+{
+    RenderCommand *command = pushRenderCommand(renderCommands, RENDER_COMMAND_CLEAR, 0, 0,
+                                               renderCommands->width, renderCommands->height);
+    if (command) { command->color = premultiplyColor(color); }
+}
+
+// will draw a rectangle from start coordinates up to but not including end coordinates,
+// pixels on the edges are blended with the fraction of them that the rectangle covers,
+// so rectangles at sub pixel positions move smoothly and touching rectangles leave no gaps
+void pushRectangle(RenderCommands *renderCommands, float startXF, float startYF,
+                   float endXF, float endYF, uint32_t color                     )
+{
+    RenderCommand *command = pushRenderCommand(renderCommands, RENDER_COMMAND_RECTANGLE,
+                                               floorF32toI32(startXF), floorF32toI32(startYF),
+                                               ceilF32toI32(endXF),    ceilF32toI32(endYF)   );
+    if (command) {
+        command->color   = premultiplyColor(color);
+        command->startXF = startXF;
+        command->startYF = startYF;
+        command->endXF   = endXF;
+        command->endYF   = endYF;
+    }
+}
+
+// draws the bitmap with its top left pixel at (x, y), blended unless it is opaque
+void pushBitmap(RenderCommands *renderCommands, RenderBitmap *bitmap, int32_t x, int32_t y)
+{
+    RenderCommand *command = pushRenderCommand(renderCommands, RENDER_COMMAND_BITMAP, x, y,
+                                               x + bitmap->width, y + bitmap->height       );
+    if (command) {
+        command->bitmap  = bitmap;
+        command->originX = x;
+        command->originY = y;
+    }
+}
+
+// gray gradient over the whole target with a black grid line every 256 pixels
+void pushGradientDEBUG(RenderCommands *renderCommands, int32_t offsetY)
+{
+    RenderCommand *command = pushRenderCommand(renderCommands, RENDER_COMMAND_GRADIENT_DEBUG,
+                                               0, 0, renderCommands->width,
+                                               renderCommands->height                       );
+    if (command) { command->offsetY = offsetY; }
+}
+
+void pushUpscale(RenderCommands *renderCommands, GameBuffer *source, int32_t x, int32_t y,
+                 int32_t width, int32_t height, UpscaleFilter filter                      )
+{
+    RenderCommand *command = pushRenderCommand(renderCommands, RENDER_COMMAND_UPSCALE, x, y,
+                                               x + width, y + height                        );
+    if (command) {
+        command->source  = source;
+        command->originX = x;
+        command->originY = y;
+        command->filter  = filter;
+        command->stepX   = (int32_t)((((int64_t)source->width  << 16) + width/2)  / width);
+        command->stepY   = (int32_t)((((int64_t)source->height << 16) + height/2) / height);
+    }
+}
+
+//NOTE[ALEX]: the indices of the commands touching tile i are
+//            tileCommands[firstTileCommand[i]] up to tileCommands[firstTileCommand[i + 1]]
+struct RenderTiles {
+    GameBuffer     *gameBuffer;
+    RenderCommands *renderCommands;
+    int32_t         tileCountX;
+    int32_t         tileCountY;
+    uint32_t       *firstTileCommand; // tileCount + 1 entries
+    uint32_t       *tileCommands;
+    uint32_t       *dirtyTiles;       // the tiles that get rasterized
+};
+
+inline uint64_t hashU64(uint64_t hash, uint64_t value)
+{
+    hash ^= value;
+    hash *= 0x100000001B3; // FNV prime
+    return hash ^ (hash >> 32);
+}
+
+inline uint64_t hashF32(uint64_t hash, float value)
+{
+    union { float f; uint32_t u; } bits;
+    bits.f = value;
+    return hashU64(hash, bits.u);
+}
+
+//NOTE[ALEX]: destination pixel x samples the source at (x - originX + 0.5)*step, bilinear
+//            filtering interpolates around that position, so it starts half a pixel earlier
+inline int32_t getUpscaleSourceX(RenderCommand *command, int32_t x)
+{
+    int32_t sourceX = (x - command->originX) * command->stepX + command->stepX/2;
+    if (command->filter == UPSCALE_FILTER_BILINEAR) { sourceX -= 0x8000; }
+    return sourceX;
+}
+
+inline int32_t getUpscaleSourceY(RenderCommand *command, int32_t y)
+{
+    int32_t sourceY = (y - command->originY) * command->stepY + command->stepY/2;
+    if (command->filter == UPSCALE_FILTER_BILINEAR) { sourceY -= 0x8000; }
+    return sourceY;
+}
+
+// hashes the hashes of the source tiles that the part of the command inside the tile samples
+uint64_t hashUpscaleSource(uint64_t hash, RenderCommand *command, int32_t startX, int32_t startY,
+                           int32_t endX, int32_t endY                                           )
+{
+    GameBuffer *source = command->source;
+    int32_t tileCountX = (source->width  + RENDER_TILE_SIZE-1) / RENDER_TILE_SIZE;
+    int32_t tileCountY = (source->height + RENDER_TILE_SIZE-1) / RENDER_TILE_SIZE;
+    if (!source->tileHashes || (uint32_t)(tileCountX * tileCountY) > source->tileHashCount) {
+        return hashU64(hash, source->lastFrameHash);
+    }
+
+    // one more source pixel to the right and bottom for bilinear filtering
+    int32_t sourceStartX = minI32(maxI32(getUpscaleSourceX(command, startX) >> 16, 0),
+                                  source->width - 1                                   );
+    int32_t sourceStartY = minI32(maxI32(getUpscaleSourceY(command, startY) >> 16, 0),
+                                  source->height - 1                                  );
+    int32_t sourceEndX   = minI32((getUpscaleSourceX(command, endX - 1) >> 16) + 1,
+                                  source->width - 1                               );
+    int32_t sourceEndY   = minI32((getUpscaleSourceY(command, endY - 1) >> 16) + 1,
+                                  source->height - 1                              );
+    for (int32_t tileY = sourceStartY / RENDER_TILE_SIZE;
+         tileY <= sourceEndY / RENDER_TILE_SIZE; tileY++) {
+        for (int32_t tileX = sourceStartX / RENDER_TILE_SIZE;
+             tileX <= sourceEndX / RENDER_TILE_SIZE; tileX++) {
+            hash = hashU64(hash, source->tileHashes[tileY * tileCountX + tileX]);
+        }
+    }
+    return hash;
+}
+
+//NOTE[ALEX]: two tiles with the same hash have the same commands, so they have the same pixels;
+//            bitmaps are hashed by their address, changing the pixels of a bitmap that was
+//            drawn before requires a new RenderBitmap (or clearing the hashes)
+uint64_t hashTile(RenderTiles *renderTiles, int32_t tileIndex)
+{
+    RenderCommands *renderCommands = renderTiles->renderCommands;
+    int32_t tileStartX = (tileIndex % renderTiles->tileCountX) * RENDER_TILE_SIZE;
+    int32_t tileStartY = (tileIndex / renderTiles->tileCountX) * RENDER_TILE_SIZE;
+    uint64_t hash = 0xCBF29CE484222325; // FNV offset basis
+    hash = hashU64(hash, (uint32_t)renderCommands->width);
+    hash = hashU64(hash, (uint32_t)renderCommands->height);
+    for (uint32_t i = renderTiles->firstTileCommand[tileIndex];
+         i < renderTiles->firstTileCommand[tileIndex + 1]; i++) {
+        RenderCommand *command = &renderCommands->commands[renderTiles->tileCommands[i]];
+        hash = hashU64(hash, command->type);
+        hash = hashU64(hash, (uint32_t)command->startX);
+        hash = hashU64(hash, (uint32_t)command->startY);
+        hash = hashU64(hash, (uint32_t)command->endX);
+        hash = hashU64(hash, (uint32_t)command->endY);
+        hash = hashU64(hash, command->color);
+        hash = hashF32(hash, command->startXF);
+        hash = hashF32(hash, command->startYF);
+        hash = hashF32(hash, command->endXF);
+        hash = hashF32(hash, command->endYF);
+        hash = hashU64(hash, (uint64_t)command->bitmap);
+        hash = hashU64(hash, (uint32_t)command->originX);
+        hash = hashU64(hash, (uint32_t)command->originY);
+        hash = hashU64(hash, (uint32_t)command->offsetY);
+        if (command->type == RENDER_COMMAND_UPSCALE) {
+            hash = hashU64(hash, command->filter);
+            hash = hashU64(hash, (uint32_t)command->stepX);
+            hash = hashU64(hash, (uint32_t)command->stepY);
+            hash = hashUpscaleSource(hash, command,
+                                     maxI32(command->startX, tileStartX),
+                                     maxI32(command->startY, tileStartY),
+                                     minI32(command->endX, tileStartX + RENDER_TILE_SIZE),
+                                     minI32(command->endY, tileStartY + RENDER_TILE_SIZE));
+        }
+    }
+    if (!hash) { hash = 1; } // 0 means unknown contents
+    return hash;
+}
+
+// adds a rectangle of dirty tiles, rectangles of the row above with the same columns get extended
+void addDirtyRect(GameBuffer *gameBuffer, GameRect rect, int32_t *overflow)
+{
+    for (uint32_t i = 0; i < gameBuffer->dirtyRectCount; i++) {
+        GameRect *dirtyRect = &gameBuffer->dirtyRects[i];
+        if (   dirtyRect->startX == rect.startX && dirtyRect->endX == rect.endX
+            && dirtyRect->endY   == rect.startY                              ) {
+            dirtyRect->endY = rect.endY;
+            return;
+        }
+    }
+    if (gameBuffer->dirtyRectCount < DIRTY_RECTS_MAX) {
+        gameBuffer->dirtyRects[gameBuffer->dirtyRectCount++] = rect;
+    } else {
+        *overflow = true;
+    }
+}
+
+void renderGradientDEBUG(GameBuffer *gameBuffer, RenderCommand *command,
+                         int32_t startX, int32_t startY, int32_t endX, int32_t endY,
+                         PixelFillFunction *fill                                    )
+{
+    uint32_t gridColor = 0xFF000000; // AARRGGBB
+    int32_t  firstGridX = alignPow2U32(startX, 256);
+    uint8_t *row = (uint8_t *)gameBuffer->textureMemory + startY * gameBuffer->pitch;
+    for (int32_t y = startY; y < endY; y++) {
+        uint32_t *pixel = (uint32_t *)row;
+        uint8_t   value = (uint8_t)(y + command->offsetY);
+        uint32_t  color = gridColor | (value << 16) | (value << 8) | value;
+        if (y % 256 == 0) { color = gridColor; }
+        fill(pixel + startX, endX - startX, color);
+        for (int32_t x = firstGridX; x < endX; x += 256) {
+            pixel[x] = gridColor;
+        }
+        row += gameBuffer->pitch;
+    }
+}
+
+// how much of the pixel is covered by [startF, endF) (0 to 255)
+uint32_t getCoverage(int32_t pixel, float startF, float endF)
+{
+    float covered = minF32((float)pixel + 1.0f, endF) - maxF32((float)pixel, startF);
+    return roundF32toU32(clampF32(covered, 0.0f, 1.0f) * 255.0f);
+}
+
+void renderRectangleSpan(uint32_t *row, int32_t x, int32_t count, uint32_t color,
+                         uint32_t coverage, PixelFillFunction *fill              )
+{
+    if (count <= 0 || coverage == 0) { return; }
+    if (coverage == 255 && (color >> 24) == 255) {
+        fill(row + x, count, color);
+    } else if (coverage == 255) {
+        blendPixels(row + x, count, color);
+    } else {
+        blendPixels(row + x, count, scaleColor(color, coverage));
+    }
+}
+
+void renderRectangle(GameBuffer *gameBuffer, RenderCommand *command,
+                     int32_t startX, int32_t startY, int32_t endX, int32_t endY,
+                     PixelFillFunction *fill                                    )
+{
+    uint32_t leftCoverage  = getCoverage(startX,   command->startXF, command->endXF);
+    uint32_t rightCoverage = getCoverage(endX - 1, command->startXF, command->endXF);
+    uint8_t *row = (uint8_t *)gameBuffer->textureMemory + startY * gameBuffer->pitch;
+    for (int32_t y = startY; y < endY; y++) {
+        uint32_t rowCoverage = getCoverage(y, command->startYF, command->endYF);
+        int32_t  spanStartX  = startX;
+        int32_t  spanEndX    = endX;
+        if (leftCoverage < 255) {
+            renderRectangleSpan((uint32_t *)row, spanStartX, 1, command->color,
+                                mulDiv255(leftCoverage, rowCoverage), fill    );
+            spanStartX++;
+        }
+        if (rightCoverage < 255 && spanEndX - 1 >= spanStartX) {
+            renderRectangleSpan((uint32_t *)row, spanEndX - 1, 1, command->color,
+                                mulDiv255(rightCoverage, rowCoverage), fill      );
+            spanEndX--;
+        }
+        renderRectangleSpan((uint32_t *)row, spanStartX, spanEndX - spanStartX,
+                            command->color, rowCoverage, fill                   );
+        row += gameBuffer->pitch;
+    }
+}
+
+// source row index scaled horizontally, rows are kept by the parity of their index, so the two
+// rows that get interpolated never replace each other
+uint32_t *getScaledSourceRow(RenderCommand *command, int32_t index, int32_t startX,
+                             int32_t count, uint32_t *rows, int32_t *rowIndices     )
+{
+    GameBuffer *source = command->source;
+    uint32_t   *row    = rows + (index & 1) * RENDER_TILE_SIZE;
+    if (rowIndices[index & 1] != index) {
+        scalePixelsLinear(row, (uint32_t *)((uint8_t *)source->textureMemory
+                                            + index * source->pitch         ),
+                          count, getUpscaleSourceX(command, startX), command->stepX,
+                          (source->width - 1) << 16                                 );
+        rowIndices[index & 1] = index;
+    }
+    return row;
+}
+
+void renderUpscale(GameBuffer *gameBuffer, RenderCommand *command,
+                   int32_t startX, int32_t startY, int32_t endX, int32_t endY)
+{
+    GameBuffer *source     = command->source;
+    int32_t     count      = endX - startX;
+    int32_t     maxSourceY = (source->height - 1) << 16;
+    uint8_t    *row        = (uint8_t *)gameBuffer->textureMemory + startY * gameBuffer->pitch;
+    if (command->filter != UPSCALE_FILTER_BILINEAR) {
+        int32_t sourceX = getUpscaleSourceX(command, startX);
+        for (int32_t y = startY; y < endY; y++) {
+            int32_t sourceY = minI32(maxI32(getUpscaleSourceY(command, y), 0), maxSourceY);
+            scalePixelsNearest((uint32_t *)row + startX,
+                               (uint32_t *)((uint8_t *)source->textureMemory
+                                            + (sourceY >> 16) * source->pitch),
+                               count, sourceX, command->stepX, (source->width - 1) << 16);
+            row += gameBuffer->pitch;
+        }
+        return;
+    }
+
+    //NOTE[ALEX]: bilinear filtering scales the two closest source rows horizontally and then
+    //            interpolates between them; when upscaling, consecutive rows share their
+    //            source rows, so every source row is only scaled once per tile
+    xbAssert(count <= RENDER_TILE_SIZE);
+    uint32_t rows[2*RENDER_TILE_SIZE];
+    int32_t  rowIndices[2] = { -1, -1 };
+    for (int32_t y = startY; y < endY; y++) {
+        int32_t sourceY = minI32(maxI32(getUpscaleSourceY(command, y), 0), maxSourceY);
+        int32_t index   = sourceY >> 16;
+        int32_t next    = minI32(index + 1, source->height - 1);
+        uint32_t *top    = getScaledSourceRow(command, index, startX, count, rows, rowIndices);
+        uint32_t *bottom = getScaledSourceRow(command, next,  startX, count, rows, rowIndices);
+        lerpPixels((uint32_t *)row + startX, top, bottom, count, (sourceY >> 8) & 0xFF);
+        row += gameBuffer->pitch;
+    }
+}
+
+void renderTile(RenderTiles *renderTiles, int32_t tileIndex)
+{
+    GameBuffer     *gameBuffer     = renderTiles->gameBuffer;
+    RenderCommands *renderCommands = renderTiles->renderCommands;
+    int32_t tileStartX = (tileIndex % renderTiles->tileCountX) * RENDER_TILE_SIZE;
+    int32_t tileStartY = (tileIndex / renderTiles->tileCountX) * RENDER_TILE_SIZE;
+    int32_t tileEndX   = minI32(tileStartX + RENDER_TILE_SIZE, renderCommands->width);
+    int32_t tileEndY   = minI32(tileStartY + RENDER_TILE_SIZE, renderCommands->height);
+
+    uint32_t first = renderTiles->firstTileCommand[tileIndex];
+    uint32_t last  = renderTiles->firstTileCommand[tileIndex + 1];
+
+    //NOTE[ALEX]: an empty tile is dirty when its hash changed to the empty one or the buffer
+    //            did not keep its contents, either way the pixels still in there are stale
+    if (first == last) {
+        uint8_t *row = (uint8_t *)gameBuffer->textureMemory + tileStartY * gameBuffer->pitch;
+        for (int32_t y = tileStartY; y < tileEndY; y++) {
+            fillPixelsStreaming((uint32_t *)row + tileStartX, tileEndX - tileStartX,
+                                0xFF000000                                          );
+            row += gameBuffer->pitch;
+        }
+        return;
+    }
+
+    for (uint32_t i = first; i < last; i++) {
+        RenderCommand *command = &renderCommands->commands[renderTiles->tileCommands[i]];
+        int32_t startX = maxI32(command->startX, tileStartX);
+        int32_t startY = maxI32(command->startY, tileStartY);
+        int32_t endX   = minI32(command->endX,   tileEndX);
+        int32_t endY   = minI32(command->endY,   tileEndY);
+
+        //NOTE[ALEX]: the tile stays in cache while its commands are drawn on top of each
+        //            other, only the last command can bypass the cache if it covers the tile
+        PixelFillFunction *fill = fillPixels;
+        if (   i == last - 1
+            && startX == tileStartX && endX == tileEndX
+            && startY == tileStartY && endY == tileEndY) {
+            fill = fillPixelsStreaming;
+        }
+
+        uint8_t *row = (uint8_t *)gameBuffer->textureMemory + startY * gameBuffer->pitch;
+        switch (command->type) {
+            case RENDER_COMMAND_CLEAR: {
+                for (int32_t y = startY; y < endY; y++) {
+                    fill((uint32_t *)row + startX, endX - startX, command->color);
+                    row += gameBuffer->pitch;
+                }
+            } break;
+            case RENDER_COMMAND_RECTANGLE: {
+                renderRectangle(gameBuffer, command, startX, startY, endX, endY, fill);
+            } break;
+            case RENDER_COMMAND_BITMAP: {
+                RenderBitmap *bitmap = command->bitmap;
+                uint8_t *source = (uint8_t *)bitmap->pixels
+                                + (startY - command->originY) * bitmap->pitch;
+                PixelCopyFunction *copy = bitmap->opaque ? copyPixels : blendCopyPixels;
+                for (int32_t y = startY; y < endY; y++) {
+                    copy((uint32_t *)row + startX,
+                         (uint32_t *)source + (startX - command->originX), endX - startX);
+                    row    += gameBuffer->pitch;
+                    source += bitmap->pitch;
+                }
+            } break;
+            case RENDER_COMMAND_GRADIENT_DEBUG: {
+                renderGradientDEBUG(gameBuffer, command, startX, startY, endX, endY, fill);
+            } break;
+            case RENDER_COMMAND_UPSCALE: {
+                renderUpscale(gameBuffer, command, startX, startY, endX, endY);
+            } break;
+        }
+    }
+}
+
+void rasterizeTiles(void *data, int32_t startTile, int32_t endTile, uint32_t logicalThreadID)
+{
+    RenderTiles *renderTiles = (RenderTiles *)data;
+    for (int32_t i = startTile; i < endTile; i++) {
+        renderTile(renderTiles, renderTiles->dirtyTiles[i]);
+    }
+}
+
+void executeRenderCommands(RenderCommands *renderCommands, GameBuffer *gameBuffer,
+                           WorkQueues *workQueues, MemoryArena *arena             )
+{
+    xbAssert(   renderCommands->width  <= gameBuffer->width
+             && renderCommands->height <= gameBuffer->height);
+
+    RenderTiles renderTiles = {};
+    renderTiles.gameBuffer     = gameBuffer;
+    renderTiles.renderCommands = renderCommands;
+    renderTiles.tileCountX     = (renderCommands->width  + RENDER_TILE_SIZE-1) / RENDER_TILE_SIZE;
+    renderTiles.tileCountY     = (renderCommands->height + RENDER_TILE_SIZE-1) / RENDER_TILE_SIZE;
+    int32_t tileCount = renderTiles.tileCountX * renderTiles.tileCountY;
+
+    // count the commands per tile (shifted by one, so the prefix sum gives the first index)
+    renderTiles.firstTileCommand = pushArray(arena, tileCount + 1, uint32_t);
+    zeroSize(renderTiles.firstTileCommand, (tileCount + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < renderCommands->commandCount; i++) {
+        RenderCommand *command = &renderCommands->commands[i];
+        for (int32_t tileY =  command->startY    / RENDER_TILE_SIZE;
+                     tileY <= (command->endY - 1) / RENDER_TILE_SIZE; tileY++) {
+            for (int32_t tileX =  command->startX    / RENDER_TILE_SIZE;
+                         tileX <= (command->endX - 1) / RENDER_TILE_SIZE; tileX++) {
+                renderTiles.firstTileCommand[tileY * renderTiles.tileCountX + tileX + 1]++;
+            }
+        }
+    }
+    for (int32_t i = 0; i < tileCount; i++) {
+        renderTiles.firstTileCommand[i + 1] += renderTiles.firstTileCommand[i];
+    }
+
+    // fill in the command indices, in the order the commands were pushed
+    renderTiles.tileCommands = pushArray(arena, renderTiles.firstTileCommand[tileCount],
+                                         uint32_t                                       );
+    uint32_t *nextTileCommand = pushArray(arena, tileCount, uint32_t);
+    for (int32_t i = 0; i < tileCount; i++) {
+        nextTileCommand[i] = renderTiles.firstTileCommand[i];
+    }
+    for (uint32_t i = 0; i < renderCommands->commandCount; i++) {
+        RenderCommand *command = &renderCommands->commands[i];
+        for (int32_t tileY =  command->startY    / RENDER_TILE_SIZE;
+                     tileY <= (command->endY - 1) / RENDER_TILE_SIZE; tileY++) {
+            for (int32_t tileX =  command->startX    / RENDER_TILE_SIZE;
+                         tileX <= (command->endX - 1) / RENDER_TILE_SIZE; tileX++) {
+                uint32_t tileIndex = tileY * renderTiles.tileCountX + tileX;
+                renderTiles.tileCommands[nextTileCommand[tileIndex]++] = i;
+            }
+        }
+    }
+
+    // tiles that already hold the same commands do not need to be rasterized again
+    uint64_t *tileHashes = gameBuffer->tileHashes;
+    if ((uint32_t)tileCount > gameBuffer->tileHashCount) { tileHashes = 0; }
+    uint8_t  *tileDirty      = pushArray(arena, tileCount, uint8_t);
+    uint32_t  dirtyTileCount = 0;
+    uint64_t  frameHash      = 0xCBF29CE484222325;
+    renderTiles.dirtyTiles   = pushArray(arena, tileCount, uint32_t);
+    for (int32_t i = 0; i < tileCount; i++) {
+        uint64_t hash = hashTile(&renderTiles, i);
+        tileDirty[i] = !tileHashes || !gameBuffer->keepsContents || tileHashes[i] != hash;
+        if (tileDirty[i]) { renderTiles.dirtyTiles[dirtyTileCount++] = i; }
+        if (tileHashes) { tileHashes[i] = hash; }
+        frameHash = hashU64(frameHash, hash);
+    }
+    gameBuffer->frameChanged  = frameHash != gameBuffer->lastFrameHash || gameBuffer->windowDamaged;
+    gameBuffer->lastFrameHash = frameHash;
+    gameBuffer->windowDamaged = false;
+
+    // runs of dirty tiles per tile row, merged with the runs of the row above
+    int32_t  overflow = false;
+    GameRect bounds   = { renderCommands->width, renderCommands->height, 0, 0 };
+    gameBuffer->dirtyRectCount = 0;
+    for (int32_t tileY = 0; tileY < renderTiles.tileCountY; tileY++) {
+        int32_t tileX = 0;
+        while (tileX < renderTiles.tileCountX) {
+            if (!tileDirty[tileY * renderTiles.tileCountX + tileX]) { tileX++; continue; }
+            int32_t runStartX = tileX;
+            while (   tileX < renderTiles.tileCountX
+                   && tileDirty[tileY * renderTiles.tileCountX + tileX]) { tileX++; }
+            GameRect rect = {};
+            rect.startX = runStartX * RENDER_TILE_SIZE;
+            rect.startY = tileY     * RENDER_TILE_SIZE;
+            rect.endX   = minI32(tileX       * RENDER_TILE_SIZE, renderCommands->width);
+            rect.endY   = minI32((tileY + 1) * RENDER_TILE_SIZE, renderCommands->height);
+            addDirtyRect(gameBuffer, rect, &overflow);
+            bounds.startX = minI32(bounds.startX, rect.startX);
+            bounds.startY = minI32(bounds.startY, rect.startY);
+            bounds.endX   = maxI32(bounds.endX,   rect.endX);
+            bounds.endY   = maxI32(bounds.endY,   rect.endY);
+        }
+    }
+    if (overflow) {
+        gameBuffer->dirtyRects[0]  = bounds;
+        gameBuffer->dirtyRectCount = 1;
+    }
+
+    if (workQueues) {
+        parallelFor(workQueues, 0, dirtyTileCount, 1, rasterizeTiles, &renderTiles);
+    } else {
+        rasterizeTiles(&renderTiles, 0, dirtyTileCount, 0);
+    }
+}
+
+//NOTE[ALEX]: the cost of rendering grows with the pixel count, so the scale changes with the
+//            square root of how far the average cpu time is off the target
+void updateRenderScale(RenderTarget *renderTarget, GameClocks *gameClocks,
+                       float targetTimePerFrame                           )
+{
+    if (!renderTarget->dynamicResolution || renderTarget->fixedWidth) { return; }
+
+    renderTarget->msFrameCPUSum += 1000.0f * gameClocks->msLastFrameCPU; // stored in seconds
+    renderTarget->frameCPUCount++;
+    if (renderTarget->frameCPUCount < DYNAMIC_RESOLUTION_FRAMES) { return; }
+
+    float msFrameCPU = renderTarget->msFrameCPUSum / (float)renderTarget->frameCPUCount;
+    renderTarget->msFrameCPUSum = 0.0f;
+    renderTarget->frameCPUCount = 0;
+    if (msFrameCPU <= 0.0f) { return; }
+
+    float factor = sqrtf(DYNAMIC_RESOLUTION_TARGET * targetTimePerFrame / msFrameCPU);
+    factor = clampF32(factor, 1.0f - DYNAMIC_RESOLUTION_MAX_STEP,
+                      1.0f + DYNAMIC_RESOLUTION_MAX_STEP         );
+    float scale = clampF32(renderTarget->scale * factor, RENDER_SCALE_MIN, 1.0f);
+    if (   scale - renderTarget->scale >  DYNAMIC_RESOLUTION_MIN_STEP
+        || scale - renderTarget->scale < -DYNAMIC_RESOLUTION_MIN_STEP
+        || (scale == 1.0f && renderTarget->scale != 1.0f)           ) {
+        printf("%s render scale %.02f -> %.02f (%.02fms cpu per frame)\n", __FUNCTION__,
+               renderTarget->scale, scale, msFrameCPU                                   );
+        renderTarget->scale = scale;
+    }
+}
+
+GameBuffer *beginRenderTarget(RenderTarget *renderTarget, GameBuffer *gameBuffer)
+{
+    int32_t width  = renderTarget->fixedWidth;
+    int32_t height = renderTarget->fixedHeight;
+    if (!width || !height) {
+        width  = maxI32(roundF32toI32(renderTarget->scale * (float)gameBuffer->width),  1);
+        height = maxI32(roundF32toI32(renderTarget->scale * (float)gameBuffer->height), 1);
+    }
+    width  = minI32(width,  WINDOW_MAX_WIDTH);
+    height = minI32(height, WINDOW_MAX_HEIGHT);
+    renderTarget->active = width != gameBuffer->width || height != gameBuffer->height;
+    if (!renderTarget->active) { return gameBuffer; }
+
+    GameBuffer *target = &renderTarget->gameBuffer;
+    if (target->width != width || target->height != height || !target->textureMemory) {
+        resetArena(&renderTarget->arena);
+        target->width         = width;
+        target->height        = height;
+        target->bytesPerPixel = gameBuffer->bytesPerPixel;
+        target->pitch         = alignPow2U32(target->bytesPerPixel * width,
+                                             GAMEBUFFER_PITCH_ALIGNMENT    );
+        target->textureMemory = pushSize(&renderTarget->arena, (uint64_t)target->pitch * height,
+                                         GAMEBUFFER_PITCH_ALIGNMENT                            );
+        target->tileHashes    = renderTarget->tileHashes;
+        target->tileHashCount = RENDER_TILE_COUNT_MAX;
+        target->keepsContents = false;
+    }
+
+    GameRect viewport = { 0, 0, gameBuffer->width, gameBuffer->height };
+    if (renderTarget->filter == UPSCALE_FILTER_INTEGER) {
+        int32_t factor = maxI32(minI32(gameBuffer->width / width, gameBuffer->height / height), 1);
+        viewport.startX = (gameBuffer->width  - factor * width)  / 2;
+        viewport.startY = (gameBuffer->height - factor * height) / 2;
+        viewport.endX   = viewport.startX + factor * width;
+        viewport.endY   = viewport.startY + factor * height;
+    }
+    renderTarget->viewport = viewport;
+    return target;
+}
+
+void endRenderTarget(RenderTarget *renderTarget, GameBuffer *gameBuffer,
+                     WorkQueues *workQueues, MemoryArena *arena         )
+{
+    if (!renderTarget->active) { return; }
+
+    GameBuffer *target = &renderTarget->gameBuffer;
+    target->keepsContents = true;
+
+    // black bars around a frame that does not cover the window (integer scaling)
+    GameRect viewport = renderTarget->viewport;
+    float    width    = (float)gameBuffer->width;
+    float    height   = (float)gameBuffer->height;
+    uint32_t black    = 0xFF000000; // AARRGGBB
+    RenderCommands *renderCommands = beginRenderCommands(arena, gameBuffer, 5);
+    pushRectangle(renderCommands, 0.0f, 0.0f, width, (float)viewport.startY, black);
+    pushRectangle(renderCommands, 0.0f, (float)viewport.endY, width, height, black);
+    pushRectangle(renderCommands, 0.0f, (float)viewport.startY,
+                  (float)viewport.startX, (float)viewport.endY, black);
+    pushRectangle(renderCommands, (float)viewport.endX, (float)viewport.startY,
+                  width, (float)viewport.endY, black                          );
+    pushUpscale(renderCommands, target, viewport.startX, viewport.startY,
+                viewport.endX - viewport.startX, viewport.endY - viewport.startY,
+                renderTarget->filter                                            );
+    executeRenderCommands(renderCommands, gameBuffer, workQueues, arena);
+}
+
+void mapToRenderTarget(RenderTarget *renderTarget, int32_t windowX, int32_t windowY,
+                       float *x, float *y                                           )
+{
+    *x = (float)windowX;
+    *y = (float)windowY;
+    if (renderTarget->active) {
+        GameRect viewport = renderTarget->viewport;
+        *x = (float)(windowX - viewport.startX) * (float)renderTarget->gameBuffer.width
+           / (float)(viewport.endX - viewport.startX);
+        *y = (float)(windowY - viewport.startY) * (float)renderTarget->gameBuffer.height
+           / (float)(viewport.endY - viewport.startY);
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef XBRENDER_H // include guard begin
+#define XBRENDER_H // include guard
+
+#include "constants.h"
+#include "xbEngine.h"
+#include "xbMemory.h"
+
+#include <stdint.h> // defines fixed size types, C++ version is <cstdint>
+
+//NOTE[ALEX]: game code does not write to the GameBuffer directly, it pushes commands that are
+//            executed at the end of the frame (see executeRenderCommands); the GameBuffer is
+//            split into tiles of RENDER_TILE_SIZE, every command is sorted into the tiles it
+//            touches and the tiles are rasterized in parallel, each tile executes its commands
+//            in the order they were pushed, so later commands are drawn on top of earlier ones
+
+enum RenderCommandType {
+    RENDER_COMMAND_CLEAR,
+    RENDER_COMMAND_RECTANGLE,
+    RENDER_COMMAND_BITMAP,
+    RENDER_COMMAND_GRADIENT_DEBUG,
+    RENDER_COMMAND_UPSCALE,
+};
+
+struct RenderCommand {
+    RenderCommandType  type;
+    // covered pixels, from start up to but not including end, clipped to the target
+    int32_t            startX;
+    int32_t            startY;
+    int32_t            endX;
+    int32_t            endY;
+    uint32_t           color;   // premultiplied
+    // rectangle only, exact edges for the coverage of the border pixels
+    float              startXF;
+    float              startYF;
+    float              endXF;
+    float              endYF;
+    RenderBitmap      *bitmap;  // bitmap only, has to stay valid until the frame is rendered
+    int32_t            originX; // bitmap only, position of its top left pixel
+    int32_t            originY;
+    int32_t            offsetY; // gradient only
+    // upscale only, source gets scaled to cover the unclipped rectangle starting at origin
+    GameBuffer        *source;
+    UpscaleFilter      filter;
+    int32_t            stepX;   // source pixels per destination pixel (16.16 fixed point)
+    int32_t            stepY;
+};
+
+struct RenderCommands {
+    int32_t        width;  // of the target, commands get clipped to it
+    int32_t        height;
+    RenderCommand *commands;
+    uint32_t       commandCount;
+    uint32_t       maxCommandCount;
+};
+
+//NOTE[ALEX]: colors are passed in as straight alpha AARRGGBB and blended premultiplied,
+//            rectangles cover pixels partially at fractional edges (blended by coverage)
+
+// the commands live in arena, which has to stay valid until executeRenderCommands is done
+RenderCommands *beginRenderCommands(MemoryArena *arena, GameBuffer *gameBuffer,
+                                    uint32_t maxCommandCount                    );
+void pushClear(RenderCommands *renderCommands, uint32_t color);
+void pushRectangle(RenderCommands *renderCommands, float startXF, float startYF,
+                   float endXF, float endYF, uint32_t color                     );
+void pushBitmap(RenderCommands *renderCommands, RenderBitmap *bitmap, int32_t x, int32_t y);
+void pushGradientDEBUG(RenderCommands *renderCommands, int32_t offsetY);
+// source has to be rendered by executeRenderCommands first, only the tiles of the target that
+// sample changed tiles of source are scaled again
+void pushUpscale(RenderCommands *renderCommands, GameBuffer *source, int32_t x, int32_t y,
+                 int32_t width, int32_t height, UpscaleFilter filter                      );
+// bins the commands into tiles (bins come from arena) and rasterizes the tiles that changed,
+// runs on the calling thread only if workQueues is 0
+void executeRenderCommands(RenderCommands *renderCommands, GameBuffer *gameBuffer,
+                           WorkQueues *workQueues, MemoryArena *arena             );
+
+// adjusts the scale of a dynamic resolution target to the cpu time of the last frame
+void updateRenderScale(RenderTarget *renderTarget, GameClocks *gameClocks,
+                       float targetTimePerFrame                           );
+// returns the buffer to render the frame into, which is gameBuffer itself at full resolution
+GameBuffer *beginRenderTarget(RenderTarget *renderTarget, GameBuffer *gameBuffer);
+// upscales the frame into gameBuffer if it was rendered into the RenderTarget
+void endRenderTarget(RenderTarget *renderTarget, GameBuffer *gameBuffer,
+                     WorkQueues *workQueues, MemoryArena *arena         );
+// window coordinates to coordinates of the buffer returned by beginRenderTarget
+void mapToRenderTarget(RenderTarget *renderTarget, int32_t windowX, int32_t windowY,
+                       float *x, float *y                                           );
+
+#endif // include guard end
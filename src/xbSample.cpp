@@ -0,0 +1,360 @@
+#include "xbSample.h"
+#include "xbPixel.h"
+#include "constants.h"
+
+#include <math.h> // for lrintf
+
+#if defined(__x86_64__) || defined(__i386__)
+#define XB_SAMPLE_X86 1
+#include <immintrin.h> // for SSE2 and AVX2 intrinsics
+#endif
+
+//NOTE[ALEX]: samples only have to be aligned to their own size, the SIMD kernels use unaligned
+//            loads and stores and finish the remaining samples of a span like the scalar kernel;
+//            the scalar kernels do the same float operations in the same order as the SIMD
+//            lanes (no fused multiply-add), so every level gives the same bits
+
+void mixSpanScalar(float *bus, float *source, uint32_t count, float gain, float gainStep)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        float sampleGain = gain + gainStep * (float)(i + 1);
+        bus[i] = bus[i] + source[i] * sampleGain;
+    }
+}
+
+void fromS16SpanScalar(float *destination, int16_t *source, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        destination[i] = (float)source[i];
+    }
+}
+
+// comparisons like minps/maxps, rounding like cvtps2dq (to nearest even by default)
+void toS16SpanScalar(int16_t *destination, float *source, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        float sample = source[i] < 32767.0f ? source[i] : 32767.0f;
+        sample = sample > -32768.0f ? sample : -32768.0f;
+        destination[i] = (int16_t)lrintf(sample);
+    }
+}
+
+void interleaveSpanScalar(float *destination, float *left, float *right, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        destination[2*i    ] = left[i];
+        destination[2*i + 1] = right[i];
+    }
+}
+
+void deinterleaveSpanScalar(float *left, float *right, float *source, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        left[i]  = source[2*i    ];
+        right[i] = source[2*i + 1];
+    }
+}
+
+void resampleSpanScalar(float *destination, float *source, uint32_t count,
+                        float position, float step                        )
+{
+    for (uint32_t i = 0; i < count; i++) {
+        float   samplePosition = position + step * (float)i;
+        int32_t index          = (int32_t)samplePosition;
+        float   t              = samplePosition - (float)index;
+        destination[i] = source[index] + t * (source[index + 1] - source[index]);
+    }
+}
+
+#ifdef XB_SAMPLE_X86
+__attribute__((target("sse2")))
+void mixSpanSSE2(float *bus, float *source, uint32_t count, float gain, float gainStep)
+{
+    __m128 gain4     = _mm_set1_ps(gain);
+    __m128 gainStep4 = _mm_set1_ps(gainStep);
+    __m128 steps     = _mm_setr_ps(1.0f, 2.0f, 3.0f, 4.0f); // i + 1 of every lane
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 sampleGain = _mm_add_ps(gain4, _mm_mul_ps(gainStep4, steps));
+        __m128 mixed = _mm_add_ps(_mm_loadu_ps(bus + i),
+                                  _mm_mul_ps(_mm_loadu_ps(source + i), sampleGain));
+        _mm_storeu_ps(bus + i, mixed);
+        steps = _mm_add_ps(steps, _mm_set1_ps(4.0f));
+    }
+    for (; i < count; i++) {
+        float sampleGain = gain + gainStep * (float)(i + 1);
+        bus[i] = bus[i] + source[i] * sampleGain;
+    }
+}
+
+__attribute__((target("sse2")))
+void fromS16SpanSSE2(float *destination, int16_t *source, uint32_t count)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i samples = _mm_loadu_si128((__m128i *)(source + i));
+        // sign extended by moving the samples into the upper half and shifting them back down
+        __m128i low  = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+        __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+        _mm_storeu_ps(destination + i,     _mm_cvtepi32_ps(low));
+        _mm_storeu_ps(destination + i + 4, _mm_cvtepi32_ps(high));
+    }
+    fromS16SpanScalar(destination + i, source + i, count - i);
+}
+
+__attribute__((target("sse2")))
+void toS16SpanSSE2(int16_t *destination, float *source, uint32_t count)
+{
+    __m128 maximum = _mm_set1_ps(32767.0f);
+    __m128 minimum = _mm_set1_ps(-32768.0f);
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128 a = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(source + i),     maximum), minimum);
+        __m128 b = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(source + i + 4), maximum), minimum);
+        __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+        _mm_storeu_si128((__m128i *)(destination + i), packed);
+    }
+    toS16SpanScalar(destination + i, source + i, count - i);
+}
+
+__attribute__((target("sse2")))
+void interleaveSpanSSE2(float *destination, float *left, float *right, uint32_t count)
+{
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 l = _mm_loadu_ps(left + i);
+        __m128 r = _mm_loadu_ps(right + i);
+        _mm_storeu_ps(destination + 2*i,     _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(destination + 2*i + 4, _mm_unpackhi_ps(l, r));
+    }
+    interleaveSpanScalar(destination + 2*i, left + i, right + i, count - i);
+}
+
+__attribute__((target("sse2")))
+void deinterleaveSpanSSE2(float *left, float *right, float *source, uint32_t count)
+{
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 a = _mm_loadu_ps(source + 2*i);
+        __m128 b = _mm_loadu_ps(source + 2*i + 4);
+        _mm_storeu_ps(left + i,  _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    deinterleaveSpanScalar(left + i, right + i, source + 2*i, count - i);
+}
+
+// there is no gather before AVX2, so the two samples of every lane are picked one by one
+__attribute__((target("sse2")))
+void resampleSpanSSE2(float *destination, float *source, uint32_t count,
+                      float position, float step                        )
+{
+    __m128 position4 = _mm_set1_ps(position);
+    __m128 step4     = _mm_set1_ps(step);
+    __m128 lanes     = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128  samplePosition = _mm_add_ps(position4, _mm_mul_ps(step4, lanes));
+        __m128i index          = _mm_cvttps_epi32(samplePosition);
+        __m128  t              = _mm_sub_ps(samplePosition, _mm_cvtepi32_ps(index));
+        int32_t indices[4];
+        _mm_storeu_si128((__m128i *)indices, index);
+        __m128 a = _mm_setr_ps(source[indices[0]],     source[indices[1]],
+                               source[indices[2]],     source[indices[3]]    );
+        __m128 b = _mm_setr_ps(source[indices[0] + 1], source[indices[1] + 1],
+                               source[indices[2] + 1], source[indices[3] + 1]);
+        _mm_storeu_ps(destination + i, _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a))));
+        lanes = _mm_add_ps(lanes, _mm_set1_ps(4.0f));
+    }
+    for (; i < count; i++) {
+        float   samplePosition = position + step * (float)i;
+        int32_t index          = (int32_t)samplePosition;
+        float   t              = samplePosition - (float)index;
+        destination[i] = source[index] + t * (source[index + 1] - source[index]);
+    }
+}
+
+__attribute__((target("avx2")))
+void mixSpanAVX2(float *bus, float *source, uint32_t count, float gain, float gainStep)
+{
+    __m256 gain8     = _mm256_set1_ps(gain);
+    __m256 gainStep8 = _mm256_set1_ps(gainStep);
+    __m256 steps     = _mm256_setr_ps(1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f);
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 sampleGain = _mm256_add_ps(gain8, _mm256_mul_ps(gainStep8, steps));
+        __m256 mixed = _mm256_add_ps(_mm256_loadu_ps(bus + i),
+                                     _mm256_mul_ps(_mm256_loadu_ps(source + i), sampleGain));
+        _mm256_storeu_ps(bus + i, mixed);
+        steps = _mm256_add_ps(steps, _mm256_set1_ps(8.0f));
+    }
+    for (; i < count; i++) {
+        float sampleGain = gain + gainStep * (float)(i + 1);
+        bus[i] = bus[i] + source[i] * sampleGain;
+    }
+}
+
+__attribute__((target("avx2")))
+void fromS16SpanAVX2(float *destination, int16_t *source, uint32_t count)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i samples = _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *)(source + i)));
+        _mm256_storeu_ps(destination + i, _mm256_cvtepi32_ps(samples));
+    }
+    fromS16SpanScalar(destination + i, source + i, count - i);
+}
+
+__attribute__((target("avx2")))
+void toS16SpanAVX2(int16_t *destination, float *source, uint32_t count)
+{
+    __m256 maximum = _mm256_set1_ps(32767.0f);
+    __m256 minimum = _mm256_set1_ps(-32768.0f);
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256 a = _mm256_max_ps(_mm256_min_ps(_mm256_loadu_ps(source + i), maximum), minimum);
+        __m256 b = _mm256_max_ps(_mm256_min_ps(_mm256_loadu_ps(source + i + 8), maximum),
+                                 minimum                                                  );
+        // packing works within 128 bit halves, the permute puts the quarters back in order
+        __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+        packed = _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i *)(destination + i), packed);
+    }
+    toS16SpanScalar(destination + i, source + i, count - i);
+}
+
+__attribute__((target("avx2")))
+void interleaveSpanAVX2(float *destination, float *left, float *right, uint32_t count)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 l    = _mm256_loadu_ps(left + i);
+        __m256 r    = _mm256_loadu_ps(right + i);
+        __m256 low  = _mm256_unpacklo_ps(l, r); // frames 0, 1, 4, 5
+        __m256 high = _mm256_unpackhi_ps(l, r); // frames 2, 3, 6, 7
+        _mm256_storeu_ps(destination + 2*i,     _mm256_permute2f128_ps(low, high, 0x20));
+        _mm256_storeu_ps(destination + 2*i + 8, _mm256_permute2f128_ps(low, high, 0x31));
+    }
+    interleaveSpanScalar(destination + 2*i, left + i, right + i, count - i);
+}
+
+__attribute__((target("avx2")))
+void deinterleaveSpanAVX2(float *left, float *right, float *source, uint32_t count)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 a = _mm256_loadu_ps(source + 2*i);
+        __m256 b = _mm256_loadu_ps(source + 2*i + 8);
+        // shuffling works within 128 bit halves, the permute puts the quarters back in order
+        __m256 l = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 r = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        l = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(l), _MM_SHUFFLE(3, 1, 2, 0)));
+        r = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(r), _MM_SHUFFLE(3, 1, 2, 0)));
+        _mm256_storeu_ps(left + i,  l);
+        _mm256_storeu_ps(right + i, r);
+    }
+    deinterleaveSpanScalar(left + i, right + i, source + 2*i, count - i);
+}
+
+__attribute__((target("avx2")))
+void resampleSpanAVX2(float *destination, float *source, uint32_t count,
+                      float position, float step                        )
+{
+    __m256 position8 = _mm256_set1_ps(position);
+    __m256 step8     = _mm256_set1_ps(step);
+    __m256 lanes     = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256  samplePosition = _mm256_add_ps(position8, _mm256_mul_ps(step8, lanes));
+        __m256i index          = _mm256_cvttps_epi32(samplePosition);
+        __m256  t              = _mm256_sub_ps(samplePosition, _mm256_cvtepi32_ps(index));
+        __m256  a = _mm256_i32gather_ps(source,     index, sizeof(float));
+        __m256  b = _mm256_i32gather_ps(source + 1, index, sizeof(float));
+        _mm256_storeu_ps(destination + i,
+                         _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a))));
+        lanes = _mm256_add_ps(lanes, _mm256_set1_ps(8.0f));
+    }
+    for (; i < count; i++) {
+        float   samplePosition = position + step * (float)i;
+        int32_t index          = (int32_t)samplePosition;
+        float   t              = samplePosition - (float)index;
+        destination[i] = source[index] + t * (source[index + 1] - source[index]);
+    }
+}
+#endif
+
+// level has to be supported by the cpu (see getSupportedPixelKernelLevel)
+void getSampleKernels(SampleKernels *sampleKernels, PixelKernelLevel level)
+{
+    sampleKernels->level            = PIXEL_KERNELS_SCALAR;
+    sampleKernels->mixSpan          = mixSpanScalar;
+    sampleKernels->fromS16Span      = fromS16SpanScalar;
+    sampleKernels->toS16Span        = toS16SpanScalar;
+    sampleKernels->interleaveSpan   = interleaveSpanScalar;
+    sampleKernels->deinterleaveSpan = deinterleaveSpanScalar;
+    sampleKernels->resampleSpan     = resampleSpanScalar;
+#ifdef XB_SAMPLE_X86
+    if (level == PIXEL_KERNELS_SSE2) {
+        sampleKernels->level            = PIXEL_KERNELS_SSE2;
+        sampleKernels->mixSpan          = mixSpanSSE2;
+        sampleKernels->fromS16Span      = fromS16SpanSSE2;
+        sampleKernels->toS16Span        = toS16SpanSSE2;
+        sampleKernels->interleaveSpan   = interleaveSpanSSE2;
+        sampleKernels->deinterleaveSpan = deinterleaveSpanSSE2;
+        sampleKernels->resampleSpan     = resampleSpanSSE2;
+    } else if (level == PIXEL_KERNELS_AVX2) {
+        sampleKernels->level            = PIXEL_KERNELS_AVX2;
+        sampleKernels->mixSpan          = mixSpanAVX2;
+        sampleKernels->fromS16Span      = fromS16SpanAVX2;
+        sampleKernels->toS16Span        = toS16SpanAVX2;
+        sampleKernels->interleaveSpan   = interleaveSpanAVX2;
+        sampleKernels->deinterleaveSpan = deinterleaveSpanAVX2;
+        sampleKernels->resampleSpan     = resampleSpanAVX2;
+    }
+#endif
+}
+
+//NOTE[ALEX]: only written by initializeSampleKernels before the audio thread starts,
+//            the scalar kernels are used until then
+static SampleKernels activeSampleKernels = { PIXEL_KERNELS_SCALAR,
+                                             mixSpanScalar, fromS16SpanScalar, toS16SpanScalar,
+                                             interleaveSpanScalar, deinterleaveSpanScalar,
+                                             resampleSpanScalar                               };
+
+PixelKernelLevel initializeSampleKernels(PixelKernelLevel maxLevel)
+{
+    PixelKernelLevel level = getSupportedPixelKernelLevel();
+    if (level > maxLevel) { level = maxLevel; }
+    getSampleKernels(&activeSampleKernels, level);
+    return activeSampleKernels.level;
+}
+
+void mixSamples(float *bus, float *source, uint32_t count, float gain, float gainStep)
+{
+    activeSampleKernels.mixSpan(bus, source, count, gain, gainStep);
+}
+
+void convertSamplesFromS16(float *destination, int16_t *source, uint32_t count)
+{
+    activeSampleKernels.fromS16Span(destination, source, count);
+}
+
+void convertSamplesToS16(int16_t *destination, float *source, uint32_t count)
+{
+    activeSampleKernels.toS16Span(destination, source, count);
+}
+
+void interleaveSamples(float *destination, float *left, float *right, uint32_t count)
+{
+    activeSampleKernels.interleaveSpan(destination, left, right, count);
+}
+
+void deinterleaveSamples(float *left, float *right, float *source, uint32_t count)
+{
+    activeSampleKernels.deinterleaveSpan(left, right, source, count);
+}
+
+void resampleSamples(float *destination, float *source, uint32_t count,
+                     float position, float step                        )
+{
+    activeSampleKernels.resampleSpan(destination, source, count, position, step);
+}
@@ -0,0 +1,54 @@
+#ifndef XBSAMPLE_H // include guard begin
+#define XBSAMPLE_H // include guard
+
+#include "constants.h"
+#include "xbPixel.h" // for PixelKernelLevel
+
+#include <stdint.h> // defines fixed size types, C++ version is <cstdint>
+
+//NOTE[ALEX]: sample kernels process runs of float samples for the mixer, they are picked once
+//            at startup with the same levels as the pixel kernels (see initializeSampleKernels),
+//            every level produces exactly the same samples, only the speed differs
+//NOTE[ALEX]: the mixer keeps one float bus per channel (planar), samples are only interleaved
+//            and converted to 16 bit (AUDIO_S16LSB) once everything has been mixed
+
+// bus[i] += source[i] * (gain + gainStep*(i + 1)), the gain ramps linearly over the span
+typedef void SampleMixFunction(float *bus, float *source, uint32_t count,
+                               float gain, float gainStep                );
+typedef void SampleFromS16Function(float *destination, int16_t *source, uint32_t count);
+// rounded to the nearest value and saturated to the 16 bit range
+typedef void SampleToS16Function(int16_t *destination, float *source, uint32_t count);
+typedef void SampleInterleaveFunction(float *destination, float *left, float *right,
+                                      uint32_t count                                );
+typedef void SampleDeinterleaveFunction(float *left, float *right, float *source,
+                                        uint32_t count                           );
+//NOTE[ALEX]: resampling reads source at position + i*step and interpolates linearly between
+//            the two closest samples, source has to hold every sample up to the last position
+//            plus one; a looping table read this way is a wavetable oscillator
+typedef void SampleResampleFunction(float *destination, float *source, uint32_t count,
+                                    float position, float step                        );
+
+struct SampleKernels {
+    PixelKernelLevel            level;
+    SampleMixFunction          *mixSpan;
+    SampleFromS16Function      *fromS16Span;
+    SampleToS16Function        *toS16Span;
+    SampleInterleaveFunction   *interleaveSpan;
+    SampleDeinterleaveFunction *deinterleaveSpan;
+    SampleResampleFunction     *resampleSpan;
+};
+
+void getSampleKernels(SampleKernels *sampleKernels, PixelKernelLevel level);
+// uses the best supported level up to maxLevel, returns the level in use
+PixelKernelLevel initializeSampleKernels(PixelKernelLevel maxLevel);
+
+// these go through the kernels picked by initializeSampleKernels
+void mixSamples(float *bus, float *source, uint32_t count, float gain, float gainStep);
+void convertSamplesFromS16(float *destination, int16_t *source, uint32_t count);
+void convertSamplesToS16(int16_t *destination, float *source, uint32_t count);
+void interleaveSamples(float *destination, float *left, float *right, uint32_t count);
+void deinterleaveSamples(float *left, float *right, float *source, uint32_t count);
+void resampleSamples(float *destination, float *source, uint32_t count,
+                     float position, float step                        );
+
+#endif // include guard end
@@ -0,0 +1,325 @@
+#include "xbStream.h"
+#include "xbAudio.h"
+#include "xbEngine.h"
+#include "xbMath.h"
+#include "constants.h"
+
+#include <cstdio> // for printf
+#include <cstring> // for memcmp
+
+#define WAV_FORMAT_PCM 0x0001
+#define WAV_FORMAT_IMA_ADPCM 0x0011
+
+uint16_t readU16LE(uint8_t *bytes)
+{
+    return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+uint32_t readU32LE(uint8_t *bytes)
+{
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16)
+           | ((uint32_t)bytes[3] << 24);
+}
+
+int32_t readAudioStreamBytes(AudioStream *stream, uint64_t offset, void *memory, uint32_t size)
+{
+    return stream->fileIO->platformReadFile(&stream->file, offset, memory, size) == size;
+}
+
+// walks the RIFF chunks for the format and the data, the samples stay on disk
+const char *readWavHeader(AudioStream *stream)
+{
+    uint8_t riff[12];
+    if (!readAudioStreamBytes(stream, 0, riff, sizeof(riff))) { return "too small"; }
+    if (memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        return "not a WAV file";
+    }
+
+    uint8_t  format[20] = {};
+    int32_t  foundFormat = 0;
+    int32_t  foundData   = 0;
+    uint64_t offset      = sizeof(riff);
+    while (!foundData && offset + 8 <= stream->file.size) {
+        uint8_t chunkHeader[8];
+        if (!readAudioStreamBytes(stream, offset, chunkHeader, sizeof(chunkHeader))) { break; }
+        uint64_t chunkSize = readU32LE(chunkHeader + 4);
+        offset += sizeof(chunkHeader);
+        if (memcmp(chunkHeader, "fmt ", 4) == 0) {
+            uint32_t formatSize = chunkSize < sizeof(format) ? (uint32_t)chunkSize
+                                                             : sizeof(format);
+            if (formatSize < 16 || !readAudioStreamBytes(stream, offset, format, formatSize)) {
+                return "broken format";
+            }
+            foundFormat = 1;
+        } else if (memcmp(chunkHeader, "data", 4) == 0) {
+            stream->dataOffset = offset;
+            stream->dataSize   = stream->file.size - offset; // the size is often wrong when
+            if (chunkSize < stream->dataSize) {               // the writer was interrupted
+                stream->dataSize = chunkSize;
+            }
+            foundData = 1;
+        }
+        offset += chunkSize + (chunkSize & 1); // chunks are padded to an even size
+    }
+    if (!foundFormat || !foundData) { return "no format or data"; }
+
+    uint16_t formatTag     = readU16LE(format);
+    uint16_t bitsPerSample = readU16LE(format + 14);
+    stream->channelCount = readU16LE(format + 2);
+    stream->sampleRate   = readU32LE(format + 4);
+    stream->blockAlign   = readU16LE(format + 12);
+    if (stream->channelCount < 1 || stream->channelCount > 2) { return "not mono or stereo"; }
+    if (   stream->sampleRate == 0
+        || (float)stream->sampleRate > AUDIO_SAMPLES_PER_SECOND * AUDIO_RATE_MAX) {
+        return "unsupported sample rate";
+    }
+
+    uint32_t headerSize = 4 * stream->channelCount; // per block, for every channel
+    if (formatTag == WAV_FORMAT_PCM && bitsPerSample == 16) {
+        if (stream->blockAlign != 2 * stream->channelCount) { return "broken block size"; }
+        stream->codec       = AUDIO_CODEC_PCM16;
+        stream->blockFrames = 1;
+        stream->dataSize   -= stream->dataSize % stream->blockAlign;
+    } else if (formatTag == WAV_FORMAT_IMA_ADPCM && bitsPerSample == 4) {
+        // a header with the first sample per channel, then 8 samples per channel every 4 bytes
+        if (   stream->blockAlign <= headerSize
+            || (stream->blockAlign - headerSize) % headerSize) {
+            return "broken block size";
+        }
+        stream->codec       = AUDIO_CODEC_IMA_ADPCM;
+        stream->blockFrames = 1 + (stream->blockAlign - headerSize) * 2 / stream->channelCount;
+    } else {
+        return "not 16 bit PCM or 4 bit IMA ADPCM";
+    }
+
+    stream->chunkBlocks = AUDIO_STREAM_CHUNK_FRAMES / stream->blockFrames;
+    if (stream->codec == AUDIO_CODEC_IMA_ADPCM) {
+        uint32_t encodedBlocks = sizeof(stream->chunks[0].encoded) / stream->blockAlign;
+        stream->chunkBlocks = (uint32_t)minI32(stream->chunkBlocks, encodedBlocks);
+    }
+    if (stream->chunkBlocks == 0)      { return "blocks too large"; }
+    if (stream->dataSize < headerSize) { return "no samples"; }
+    return 0;
+}
+
+int32_t openAudioStream(AudioStream *stream, FileIO *fileIO, const char *fileName,
+                        float volume, int32_t loop                                )
+{
+    *stream = {};
+    stream->fileIO = fileIO;
+    if (!fileIO->platformOpenFile(fileName, &stream->file)) { return 0; }
+
+    const char *error = readWavHeader(stream);
+    if (error) {
+        printf("%s %s: %s\n", __FUNCTION__, fileName, error);
+        closeAudioStream(stream);
+        return 0;
+    }
+
+    stream->nextOffset = stream->dataOffset;
+    stream->loop       = loop;
+    stream->volume     = volume;
+    for (uint32_t i = 0; i < AUDIO_STREAM_CHUNKS; i++) {
+        AudioStreamChunk *chunk = &stream->chunks[i];
+        chunk->stream             = stream;
+        chunk->state              = AUDIO_CHUNK_FREE;
+        chunk->sound.samples      = chunk->samples;
+        chunk->sound.channelCount = stream->channelCount;
+    }
+    printf("%s %s: %s, %u channels, %uHz, %lu bytes of samples\n", __FUNCTION__, fileName,
+           stream->codec == AUDIO_CODEC_PCM16 ? "pcm" : "ima adpcm",
+           stream->channelCount, stream->sampleRate, stream->dataSize                  );
+    return 1;
+}
+
+void closeAudioStream(AudioStream *stream)
+{
+    if (stream->file.isOpen) {
+        stream->fileIO->platformCloseFile(&stream->file);
+    }
+    stream->finished = true;
+}
+
+static const int16_t imaStepTable[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66,
+    73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408,
+    449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630,
+    9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+static const int8_t imaIndexTable[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+struct ImaChannel {
+    int32_t predictor;
+    int32_t stepIndex;
+};
+
+inline int16_t decodeImaNibble(ImaChannel *channel, uint8_t nibble)
+{
+    int32_t step       = imaStepTable[channel->stepIndex];
+    int32_t difference = step >> 3;
+    if (nibble & 1) { difference += step >> 2; }
+    if (nibble & 2) { difference += step >> 1; }
+    if (nibble & 4) { difference += step; }
+    if (nibble & 8) { difference = -difference; }
+    channel->predictor = clampI32(channel->predictor + difference, -32768, 32767);
+    channel->stepIndex = clampI32(channel->stepIndex + imaIndexTable[nibble], 0, 88);
+    return (int16_t)channel->predictor;
+}
+
+// decodes a (possibly shortened last) block, returns the frames written
+uint32_t decodeImaAdpcmBlock(int16_t *samples, uint8_t *block, uint32_t size,
+                             uint32_t channelCount                           )
+{
+    uint32_t headerSize = 4 * channelCount;
+    if (size < headerSize) { return 0; }
+
+    ImaChannel channels[2];
+    for (uint32_t c = 0; c < channelCount; c++) {
+        channels[c].predictor = (int16_t)readU16LE(block + 4*c);
+        channels[c].stepIndex = clampI32(block[4*c + 2], 0, 88);
+        samples[c] = (int16_t)channels[c].predictor;
+    }
+    block += headerSize;
+
+    uint32_t groupCount = (size - headerSize) / headerSize; // 8 frames each
+    for (uint32_t group = 0; group < groupCount; group++) {
+        int16_t *groupSamples = samples + (1 + 8*group) * channelCount;
+        for (uint32_t c = 0; c < channelCount; c++) {
+            for (uint32_t i = 0; i < 4; i++) { // low nibble first
+                uint8_t byte = *block++;
+                groupSamples[(2*i    ) * channelCount + c] = decodeImaNibble(&channels[c],
+                                                                             byte & 0x0F );
+                groupSamples[(2*i + 1) * channelCount + c] = decodeImaNibble(&channels[c],
+                                                                             byte >> 4   );
+            }
+        }
+    }
+    return 1 + 8 * groupCount;
+}
+
+// runs on the low priority queue, only touches its own chunk
+void doDecodeAudioChunk(void *data, uint32_t logicalThreadID)
+{
+    AudioStreamChunk *chunk  = (AudioStreamChunk *)data;
+    AudioStream      *stream = chunk->stream;
+    FileIO           *fileIO = stream->fileIO;
+    uint32_t          frameBytes = stream->channelCount * sizeof(int16_t);
+
+    if (stream->codec == AUDIO_CODEC_PCM16) { // already the format of the mixer
+        uint32_t bytesRead = fileIO->platformReadFile(&stream->file, chunk->fileOffset,
+                                                      chunk->samples, chunk->encodedSize);
+        chunk->sound.frameCount = bytesRead / frameBytes;
+    } else {
+        uint32_t bytesRead = fileIO->platformReadFile(&stream->file, chunk->fileOffset,
+                                                      chunk->encoded, chunk->encodedSize);
+        uint32_t frameCount = 0;
+        for (uint32_t offset = 0; offset < bytesRead; offset += stream->blockAlign) {
+            uint32_t blockSize = (uint32_t)minI32(stream->blockAlign, bytesRead - offset);
+            frameCount += decodeImaAdpcmBlock(chunk->samples + frameCount * stream->channelCount,
+                                              chunk->encoded + offset, blockSize,
+                                              stream->channelCount                             );
+        }
+        chunk->sound.frameCount = frameCount;
+    }
+    if (chunk->sound.frameCount == 0) {
+        printf("%s could not read %u bytes at %lu\n", __FUNCTION__, chunk->encodedSize,
+               chunk->fileOffset                                                       );
+    }
+}
+
+//NOTE[ALEX]: every decode job signals WORK_COUNTER_AUDIO, decoded chunks are only queued once
+//            the counter is back at 0, that way no chunk is read while its job might still run
+//            (and streams wait for each other, which is fine for a handful of them);
+//            only worker threads take low priority work, without any the chunks get decoded
+//            right here on the main thread
+void updateAudioStream(AudioStream *stream, GameSound *gameSound, WorkQueues *workQueues)
+{
+    if (stream->finished) { return; }
+    PlatformWorkQueue *queue = workQueues->lowPriorityQueue;
+    if (workQueues->platformGetWorkCounter(queue, WORK_COUNTER_AUDIO) != 0) { return; }
+
+    int32_t allFree = true;
+    for (uint32_t i = 0; i < AUDIO_STREAM_CHUNKS; i++) {
+        AudioStreamChunk *chunk = &stream->chunks[i];
+        if (chunk->state == AUDIO_CHUNK_DECODING) { chunk->state = AUDIO_CHUNK_DECODED; }
+        if (chunk->state != AUDIO_CHUNK_FREE)     { allFree = false; }
+    }
+
+    // in the order they were decoded, the first one starts the voice
+    while (stream->chunks[stream->nextQueue].state == AUDIO_CHUNK_DECODED) {
+        AudioStreamChunk *chunk = &stream->chunks[stream->nextQueue];
+        if (!stream->voiceID) {
+            float rate = (float)stream->sampleRate / (float)AUDIO_SAMPLES_PER_SECOND;
+            stream->voiceID = playStream(gameSound, &chunk->sound, stream->volume, 0.0f, rate);
+            if (!stream->voiceID) { break; } // the command ring is full, again next frame
+        } else if (!queueStreamBuffer(gameSound, stream->voiceID, &chunk->sound)) {
+            break;
+        }
+        chunk->state      = AUDIO_CHUNK_QUEUED;
+        stream->nextQueue = (stream->nextQueue + 1) % AUDIO_STREAM_CHUNKS;
+    }
+
+    if (stream->decodedAll && !stream->endSent) {
+        int32_t allQueued = true;
+        for (uint32_t i = 0; i < AUDIO_STREAM_CHUNKS; i++) {
+            if (stream->chunks[i].state == AUDIO_CHUNK_DECODED) { allQueued = false; }
+        }
+        if (allQueued && stream->voiceID) {
+            stream->endSent = endStream(gameSound, stream->voiceID);
+        } else if (allFree && !stream->voiceID) { // the voice is gone with nothing left to play
+            stream->finished = true;
+        }
+        return;
+    }
+
+    uint64_t dataEnd = stream->dataOffset + stream->dataSize;
+    while (   !stream->decodedAll
+           && stream->chunks[stream->nextDecode].state == AUDIO_CHUNK_FREE) {
+        AudioStreamChunk *chunk = &stream->chunks[stream->nextDecode];
+        uint64_t chunkSize = (uint64_t)stream->chunkBlocks * stream->blockAlign;
+        if (chunkSize > dataEnd - stream->nextOffset) { chunkSize = dataEnd - stream->nextOffset; }
+        chunk->fileOffset  = stream->nextOffset;
+        chunk->encodedSize = (uint32_t)chunkSize;
+        chunk->state       = AUDIO_CHUNK_DECODING;
+        if (!workQueues->workerCount) {
+            doDecodeAudioChunk(chunk, 0);
+            chunk->state = AUDIO_CHUNK_DECODED; // queued with the next update
+        } else if (!workQueues->platformAddDependentWork(queue, WORK_COUNTER_NONE,
+                                                         WORK_COUNTER_AUDIO,
+                                                         doDecodeAudioChunk, chunk)) {
+            chunk->state = AUDIO_CHUNK_FREE;
+            break;
+        }
+        stream->nextDecode  = (stream->nextDecode + 1) % AUDIO_STREAM_CHUNKS;
+        stream->nextOffset += chunkSize;
+        if (stream->nextOffset >= dataEnd) {
+            if (stream->loop) {
+                stream->nextOffset = stream->dataOffset;
+            } else {
+                stream->decodedAll = true;
+            }
+        }
+    }
+}
+
+int32_t handleAudioStreamEvent(AudioStream *stream, AudioEvent *event)
+{
+    if (event->type == AUDIO_EVENT_BUFFER_DONE) {
+        for (uint32_t i = 0; i < AUDIO_STREAM_CHUNKS; i++) {
+            if (event->sound == &stream->chunks[i].sound) {
+                stream->chunks[i].state = AUDIO_CHUNK_FREE;
+                return 1;
+            }
+        }
+    } else if (event->type == AUDIO_EVENT_STREAM_DONE) {
+        if (event->voiceID && event->voiceID == stream->voiceID) {
+            stream->voiceID = 0; // started again with the next decoded chunk
+            if (stream->endSent) { stream->finished = true; }
+            return 1;
+        }
+    }
+    return 0;
+}
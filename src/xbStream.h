@@ -0,0 +1,76 @@
+#ifndef XBSTREAM_H // include guard begin
+#define XBSTREAM_H // include guard
+
+#include "constants.h"
+#include "xbEngine.h"
+
+#include <stdint.h> // defines fixed size types, C++ version is <cstdint>
+
+//NOTE[ALEX]: long sounds (music) are streamed from disk instead of being loaded, a stream owns
+//            AUDIO_STREAM_CHUNKS chunks that get decoded ahead on the low priority queue and are
+//            queued as the buffers of a streaming voice (see xbAudio.h); a chunk is decoded again
+//            once the mixer is done with it, so the memory of a stream is the same for a jingle
+//            and for an hour of music
+//NOTE[ALEX]: WAV files with 16 bit PCM or 4 bit IMA ADPCM (as written by sox or ffmpeg), mono
+//            or stereo, at any sample rate up to AUDIO_RATE_MAX times the output rate
+
+enum AudioCodec {
+    AUDIO_CODEC_PCM16,
+    AUDIO_CODEC_IMA_ADPCM,
+};
+
+enum AudioChunkState {
+    AUDIO_CHUNK_FREE,
+    AUDIO_CHUNK_DECODING, // owned by its decode job
+    AUDIO_CHUNK_DECODED,
+    AUDIO_CHUNK_QUEUED,   // owned by the mixer until it reports the buffer as done
+};
+
+struct AudioStream;
+
+struct AudioStreamChunk {
+    AudioSound       sound;       // the decoded frames, a buffer of the streaming voice
+    AudioChunkState  state;
+    AudioStream     *stream;
+    uint64_t         fileOffset;  // of the encoded blocks
+    uint32_t         encodedSize;
+    int16_t          samples[AUDIO_STREAM_CHUNK_FRAMES*2];
+    uint8_t          encoded[AUDIO_STREAM_CHUNK_FRAMES*2]; // compressed blocks as read (ADPCM)
+};
+
+//NOTE[ALEX]: chunks are decoded, queued and given back by the mixer in ring order, the data is
+//            split into blocks that decode on their own (single frames for PCM), so every chunk
+//            is a whole number of blocks and its job does not depend on any other chunk
+struct AudioStream {
+    FileIO           *fileIO;
+    PlatformFile      file;
+    AudioCodec        codec;
+    uint32_t          channelCount;
+    uint32_t          sampleRate;
+    uint32_t          blockAlign;  // bytes per block, the last block of the file can be shorter
+    uint32_t          blockFrames;
+    uint32_t          chunkBlocks;
+    uint64_t          dataOffset;  // of the first block
+    uint64_t          dataSize;
+    uint64_t          nextOffset;  // of the next block to decode
+    int32_t           loop;
+    int32_t           decodedAll;  // every block was handed to a decode job (never if looping)
+    int32_t           endSent;
+    int32_t           finished;    // the voice played everything
+    float             volume;
+    uint32_t          voiceID;     // 0 until the first chunk is decoded
+    uint32_t          nextDecode;  // chunk that gets decoded next
+    uint32_t          nextQueue;   // chunk that gets queued next
+    AudioStreamChunk  chunks[AUDIO_STREAM_CHUNKS];
+};
+
+int32_t openAudioStream(AudioStream *stream, FileIO *fileIO, const char *fileName,
+                        float volume, int32_t loop                                );
+// only once no decode job is running anymore and the mixer has stopped
+void closeAudioStream(AudioStream *stream);
+// once per frame, queues what was decoded and starts decoding into the free chunks
+void updateAudioStream(AudioStream *stream, GameSound *gameSound, WorkQueues *workQueues);
+// every event of the mixer has to be passed on, returns 1 if it was for this stream
+int32_t handleAudioStreamEvent(AudioStream *stream, AudioEvent *event);
+
+#endif // include guard end